@@ -0,0 +1,42 @@
+// Host stand-in for the FreeRTOS kernel headers.
+// The real FreeRTOSConfig.h from src/ is used so that the host build sees the same
+// configuration as the target, but the kernel itself is replaced by the small
+// cooperative, simulated-time scheduler in host/port/rtos.cpp.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef long            BaseType_t;
+typedef unsigned long   UBaseType_t;
+typedef uint32_t        TickType_t;
+typedef uint32_t        StackType_t;
+
+// Like the RP2040/RP2350 port, the host port claims to be the SMP kernel
+#define FREE_RTOS_KERNEL_SMP    1
+
+#include "FreeRTOSConfig.h"
+
+#define pdFALSE         ( ( BaseType_t ) 0 )
+#define pdTRUE          ( ( BaseType_t ) 1 )
+#define pdPASS          ( pdTRUE )
+#define pdFAIL          ( pdFALSE )
+
+// Memory for a statically allocated task or semaphore. The host port keeps its own bookkeeping,
+// so these only need to be the right kind of thing to point at.
+typedef struct { void *pvDummy[8]; } StaticTask_t;
+typedef struct { void *pvDummy[4]; } StaticSemaphore_t;
+
+#define portMAX_DELAY   ( ( TickType_t ) 0xffffffffUL )
+#define portTICK_PERIOD_MS  ( ( TickType_t ) 1000 / configTICK_RATE_HZ )
+
+#ifndef configEXPECTED_IDLE_TIME_BEFORE_SLEEP
+    #define configEXPECTED_IDLE_TIME_BEFORE_SLEEP   2
+#endif
+
+#ifndef configTASK_NOTIFICATION_ARRAY_ENTRIES
+    #define configTASK_NOTIFICATION_ARRAY_ENTRIES   1
+#endif
+
+#define pdMS_TO_TICKS( xTimeInMs ) \
+    ( ( TickType_t ) ( ( ( uint64_t ) ( xTimeInMs ) * ( uint64_t ) configTICK_RATE_HZ ) / ( uint64_t ) 1000U ) )
@@ -0,0 +1,23 @@
+// Host stand-in for SEGGER RTT, covering the extra up-buffers used for binary telemetry.
+// Console output (up-buffer 0) goes through printf to stdout instead.
+//
+// Whatever gets written to up-buffer 1 is appended to the file named by PTWD_SIM_TELEMETRY,
+// which makes a capture that the host decoder can read. Up-buffer 2 (the flash log dumps) goes
+// to the file named by PTWD_SIM_LOG, and up-buffer 3 (the binary trace) to the one named by
+// PTWD_SIM_TRACE. Without them, the data is discarded.
+#pragma once
+
+#define SEGGER_RTT_MODE_NO_BLOCK_SKIP           (0)
+#define SEGGER_RTT_MODE_NO_BLOCK_TRIM           (1)
+#define SEGGER_RTT_MODE_BLOCK_IF_FIFO_FULL      (2)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int SEGGER_RTT_ConfigUpBuffer (unsigned BufferIndex, const char *sName, void *pBuffer, unsigned BufferSize, unsigned Flags);
+unsigned SEGGER_RTT_Write (unsigned BufferIndex, const void *pBuffer, unsigned NumBytes);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,51 @@
+// Host stand-in for the Pico SDK's "hardware/clocks.h".
+// The simulated system clock starts out at the RP2350 default of 150 MHz, and can be switched
+// between its sources like the real one. Switching to a PLL that is not running is an error.
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#define KHZ     1000
+#define MHZ     1000000
+
+#define SYS_CLK_HZ              (150 * MHZ)
+
+// The PLL settings for the default clocks: 150 MHz from the system PLL, 48 MHz from the USB PLL
+#define PLL_SYS_REFDIV          1
+#define PLL_SYS_VCO_FREQ_HZ     (1500 * MHZ)
+#define PLL_SYS_POSTDIV1        5
+#define PLL_SYS_POSTDIV2        2
+#define PLL_USB_REFDIV          1
+#define PLL_USB_VCO_FREQ_HZ     (1440 * MHZ)
+#define PLL_USB_POSTDIV1        6
+#define PLL_USB_POSTDIV2        5
+
+enum clock_index {
+    clk_gpout0 = 0,
+    clk_ref    = 4,
+    clk_sys    = 5,
+    clk_peri   = 6,
+};
+
+#define CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX    0x1
+#define CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS     0x0
+#define CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB     0x1
+#define CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_XOSC_CLKSRC        0x4
+#define CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS           0x0
+#define CLOCKS_CLK_GPOUT0_CTRL_AUXSRC_VALUE_XOSC_CLKSRC     0x5
+#define CLOCKS_FC0_SRC_VALUE_CLK_SYS                        0x09
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool clock_configure (enum clock_index clk, uint32_t src, uint32_t auxsrc, uint32_t src_freq, uint32_t freq);
+uint32_t clock_get_hz (enum clock_index clk);
+uint32_t frequency_count_khz (uint src);
+void clock_gpio_init (uint gpio, uint src, float div);
+
+#ifdef __cplusplus
+}
+#endif
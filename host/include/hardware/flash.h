@@ -0,0 +1,30 @@
+// Host stand-in for the Pico SDK's "hardware/flash.h".
+// Flash is an array in host memory, mapped at XIP_BASE like the real thing.
+// If PTWD_SIM_FLASH names a file, the flash contents are loaded from it at startup and
+// written back after every erase or program, so that they survive from one run to the next.
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FLASH_PAGE_SIZE         (1u << 8)
+#define FLASH_SECTOR_SIZE       (1u << 12)
+
+#ifndef PICO_FLASH_SIZE_BYTES
+    #define PICO_FLASH_SIZE_BYTES   (4 * 1024 * 1024)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+
+#define XIP_BASE    ((uintptr_t)host_flash)
+
+void flash_range_erase (uint32_t flash_offs, size_t count);
+void flash_range_program (uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
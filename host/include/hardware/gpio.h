@@ -0,0 +1,24 @@
+// Host stand-in for the Pico SDK's "hardware/gpio.h".
+// GPIO outputs are remembered so that they can be read back, but drive nothing.
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#define GPIO_OUT    1
+#define GPIO_IN     0
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void gpio_init (uint gpio);
+void gpio_set_dir (uint gpio, bool out);
+void gpio_put (uint gpio, bool value);
+bool gpio_get (uint gpio);
+void gpio_set_pulls (uint gpio, bool up, bool down);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,88 @@
+// Host stand-in for the Pico SDK's "hardware/pio.h".
+// The PIO blocks only keep track of instruction memory and state machine allocation.
+// The actual Onewire signalling is performed by the simulated bus behind onewire_library.
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#define NUM_PIOS                3
+#define NUM_PIO_STATE_MACHINES  4
+#define PIO_INSTRUCTION_COUNT   32
+
+typedef struct pio_hw {
+    uint32_t used_instruction_count;
+    uint32_t claimed_sm_mask;
+    uint32_t clkdiv[NUM_PIO_STATE_MACHINES];    // in 1/256ths
+} pio_hw_t;
+
+typedef pio_hw_t *PIO;
+
+typedef struct pio_program {
+    const uint16_t *instructions;
+    uint8_t length;
+    int8_t origin;
+} pio_program_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern pio_hw_t host_pio_hw[NUM_PIOS];
+
+#define pio0    (&host_pio_hw[0])
+#define pio1    (&host_pio_hw[1])
+#define pio2    (&host_pio_hw[2])
+
+static inline PIO pio_get_instance (uint instance) { return &host_pio_hw[instance]; }
+
+bool pio_can_add_program (PIO pio, const pio_program_t *program);
+uint pio_add_program (PIO pio, const pio_program_t *program);
+int pio_claim_unused_sm (PIO pio, bool required);
+void pio_sm_unclaim (PIO pio, uint sm);
+
+static inline void pio_sm_set_clkdiv_int_frac (PIO pio, uint sm, uint16_t div_int, uint8_t div_frac)
+{
+    pio->clkdiv[sm] = ((uint32_t)div_int << 8) | div_frac;
+}
+
+// A state machine configuration only holds what the simulation looks at
+typedef struct {
+    uint32_t clkdiv;        // in 1/256ths
+    uint32_t shift_bits;
+} pio_sm_config;
+
+static inline void sm_config_set_in_shift (pio_sm_config *c, bool shift_right, bool autopush, uint push_threshold)
+{
+    (void)c; (void)shift_right; (void)autopush; (void)push_threshold;
+}
+
+static inline void sm_config_set_out_shift (pio_sm_config *c, bool shift_right, bool autopull, uint pull_threshold)
+{
+    (void)shift_right; (void)autopull;
+    c->shift_bits = pull_threshold;
+}
+
+static inline void sm_config_set_in_pins (pio_sm_config *c, uint in_base)          { (void)c; (void)in_base; }
+static inline void sm_config_set_sideset_pins (pio_sm_config *c, uint sideset_base) { (void)c; (void)sideset_base; }
+
+static inline void sm_config_set_clkdiv_int_frac (pio_sm_config *c, uint16_t div_int, uint8_t div_frac)
+{
+    c->clkdiv = ((uint32_t)div_int << 8) | div_frac;
+}
+
+// Only the onewire program gets started this way (see host/sim/onewire_library.cpp)
+void pio_sm_init (PIO pio, uint sm, uint initial_pc, const pio_sm_config *config);
+static inline void pio_sm_set_enabled (PIO pio, uint sm, bool enabled) { (void)pio; (void)sm; (void)enabled; }
+
+// Host only: how fast a state machine is running, given the current clk_sys
+uint32_t host_pio_sm_hz (PIO pio, uint sm);
+
+// Only the triplet program's FIFOs are simulated (see host/sim/onewire_triplet.cpp)
+void pio_sm_put_blocking (PIO pio, uint sm, uint32_t data);
+uint32_t pio_sm_get_blocking (PIO pio, uint sm);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,27 @@
+// Host stand-in for the Pico SDK's "hardware/pll.h".
+// The PLLs only keep track of whether they are running, so that switching clk_sys
+// over to one that is not can be caught.
+#pragma once
+
+#include <sys/types.h>
+
+typedef struct pll_hw {
+    bool running;
+} pll_hw_t;
+typedef pll_hw_t *PLL;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern pll_hw_t host_pll_hw[2];
+
+#define pll_sys     (&host_pll_hw[0])
+#define pll_usb     (&host_pll_hw[1])
+
+void pll_init (PLL pll, uint ref_div, uint vco_freq, uint post_div1, uint post_div2);
+void pll_deinit (PLL pll);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,25 @@
+// Host stand-in for the Pico SDK's "hardware/structs/m33.h": just the DWT cycle counter.
+// The simulated RP2350 counts clk_sys cycles of simulated time, whatever speed the clock was
+// switched to along the way. Simulated time only passes on the bus and while tasks wait, so code
+// that only computes costs no cycles at all: host/tools/ptwd-bench times that instead.
+#pragma once
+
+#include <stdint.h>
+
+#define M33_DEMCR_TRCENA_BITS           (1u << 24)
+#define M33_DWT_CTRL_CYCCNTENA_BITS     (1u << 0)
+
+// Reads as the cycles since power-on, or 0 until the counter gets turned on
+struct host_cycle_count {
+    operator uint32_t () const;
+};
+
+typedef struct {
+    volatile uint32_t dwt_ctrl;
+    host_cycle_count dwt_cyccnt;
+    volatile uint32_t demcr;
+} m33_hw_t;
+
+extern m33_hw_t host_m33_hw;
+
+#define m33_hw  (&host_m33_hw)
@@ -0,0 +1,22 @@
+// Host stand-in for the Pico SDK's "hardware/structs/scb.h".
+// No exception is ever pending on the host.
+#pragma once
+
+#include <stdint.h>
+
+typedef struct {
+    volatile uint32_t cpuid;
+    volatile uint32_t icsr;
+} host_scb_hw_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern host_scb_hw_t host_scb_hw;
+
+#define scb_hw  (&host_scb_hw)
+
+#ifdef __cplusplus
+}
+#endif
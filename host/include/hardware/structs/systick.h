@@ -0,0 +1,25 @@
+// Host stand-in for the Pico SDK's "hardware/structs/systick.h".
+// The host scheduler turns SysTick on when it starts, and sets the count before every tickless
+// sleep. The tick count itself always comes from the simulated clock: stopping SysTick only
+// decides whether a waiting core gets woken up by the tick.
+#pragma once
+
+#include <stdint.h>
+
+// Writing the count clears it, and SysTick reloads it from RVR on its next clock: on the host, right away
+struct host_systick_count {
+    uint32_t value;
+    operator uint32_t () const { return value; }
+    host_systick_count &operator= (uint32_t v);
+};
+
+typedef struct {
+    volatile uint32_t csr;
+    volatile uint32_t rvr;
+    host_systick_count cvr;
+    volatile uint32_t calib;
+} systick_hw_t;
+
+extern systick_hw_t host_systick_hw;
+
+#define systick_hw  (&host_systick_hw)
@@ -0,0 +1,14 @@
+// Host stand-in for the Pico SDK's "hardware/structs/xip_ctrl.h": just the cache counters.
+// The host runs nothing from flash, so they never count anything.
+#pragma once
+
+#include <stdint.h>
+
+typedef struct {
+    volatile uint32_t ctr_hit;
+    volatile uint32_t ctr_acc;
+} xip_ctrl_hw_t;
+
+extern xip_ctrl_hw_t host_xip_ctrl_hw;
+
+#define xip_ctrl_hw (&host_xip_ctrl_hw)
@@ -0,0 +1,24 @@
+// Host stand-in for the Pico SDK's "hardware/sync.h".
+// Nothing interrupts anything on the host: simulated interrupts only run from the scheduler.
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline uint32_t save_and_disable_interrupts (void) { return 0; }
+static inline void restore_interrupts (uint32_t status) { (void)status; }
+
+static inline void __dsb (void) {}
+static inline void __isb (void) {}
+
+// Wait for an interrupt. Only the scheduler's idle path really waits: the simulated clock moves
+// on to the next tick (while SysTick is running), the next simulated interrupt, or the next time
+// another core could ready a task, whichever comes first.
+void __wfi (void);
+
+#ifdef __cplusplus
+}
+#endif
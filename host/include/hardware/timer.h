@@ -0,0 +1,28 @@
+// Host stand-in for the Pico SDK's "hardware/timer.h".
+// The alarms are events on the simulated clock.
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+typedef uint64_t absolute_time_t;
+
+typedef void (*hardware_alarm_callback_t) (uint alarm_num);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static inline absolute_time_t from_us_since_boot (uint64_t us) { return us; }
+
+int hardware_alarm_claim_unused (bool required);
+void hardware_alarm_set_callback (uint alarm_num, hardware_alarm_callback_t callback);
+
+// Returns true, without arming the alarm, if 't' has already gone by
+bool hardware_alarm_set_target (uint alarm_num, absolute_time_t t);
+void hardware_alarm_cancel (uint alarm_num);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,28 @@
+// Host stand-in for the pico-examples onewire_library.
+// Same API as the real library, but every transaction is clocked through a simulated
+// bus of DS18B20 sensors (see host/sim/SimBus.h) instead of a PIO state machine.
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "hardware/pio.h"
+#include "onewire_library.pio.h"
+
+typedef struct {
+    PIO pio;
+    uint sm;
+    uint jmp_reset;
+    int offset;
+    int gpio;
+
+    // Host only: the simulated bus attached to 'gpio'
+    void *bus;
+} OW;
+
+bool ow_init (OW *ow, PIO pio, uint offset, uint gpio);
+void ow_send (OW *ow, uint data);
+uint8_t ow_read (OW *ow);
+bool ow_reset (OW *ow);
+int ow_romsearch (OW *ow, uint64_t *romcodes, int maxdevs, uint command);
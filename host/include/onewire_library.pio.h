@@ -0,0 +1,30 @@
+// Host stand-in for the pioasm-generated "onewire_library.pio.h".
+#pragma once
+
+#include "hardware/pio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const pio_program_t onewire_program;
+
+#define onewire_offset_fetch_bit 0u
+
+static inline pio_sm_config onewire_program_get_default_config (uint offset)
+{
+    (void)offset;
+    pio_sm_config c = {0, 32};
+    return c;
+}
+
+// (Re)configure a state machine to run the onewire program, shifting 'bits_per_word' bits
+// per FIFO word: 8 for whole bytes, 1 for single time slots.
+void onewire_sm_init (PIO pio, uint sm, uint offset, uint pin_num, uint bits_per_word);
+
+// Host only: the shift width that the state machine is currently configured for
+uint onewire_sm_bits (PIO pio, uint sm);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,19 @@
+// Host stand-in for the pioasm-generated "onewire_triplet.pio.h".
+#pragma once
+
+#include "hardware/pio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const pio_program_t onewire_triplet_program;
+
+// Switch a state machine over to the triplet program (see src/onewire_triplet.pio).
+// Each word written to the TX FIFO runs one triplet, using bit 0 as the preferred direction.
+// Each word read back from the RX FIFO holds the bit in bit 30 and its complement in bit 31.
+void onewire_triplet_sm_init (PIO pio, uint sm, uint offset, uint pin_num);
+
+#ifdef __cplusplus
+}
+#endif
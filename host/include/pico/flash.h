@@ -0,0 +1,18 @@
+// Host stand-in for the Pico SDK's "pico/flash.h".
+// There is no XIP to protect on the host, so the function simply gets called.
+#pragma once
+
+#include <stdint.h>
+
+// The real header pulls in the SDK error codes
+#include "pico/stdlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int flash_safe_execute (void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,60 @@
+// Host stand-in for the Pico SDK's "pico/stdlib.h".
+// Only the small subset of the SDK that the ptwd sources actually use is provided.
+// Time is simulated: it only advances when a task blocks or when the simulated
+// Onewire bus spends time clocking out reset pulses and time slots.
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "hardware/gpio.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
+
+#define PICO_OK                 0
+#define PICO_ERROR_TIMEOUT      -1
+#define PICO_DEFAULT_LED_PIN    25
+
+// The simulated chip is an RP2350 (see hardware/clocks.h)
+#define PICO_RP2350             1
+
+// There is no flash to run code from: everything already runs from RAM
+#define __not_in_flash_func(func_name)  func_name
+
+#define __force_inline                  inline __attribute__((always_inline))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t time_us_32 (void);
+uint64_t time_us_64 (void);
+void sleep_ms (uint32_t ms);
+void sleep_us (uint64_t us);
+void busy_wait_us (uint64_t us);
+
+uint get_core_num (void);
+
+// stdio goes straight to the host's stdout.
+// On the target, output costs CPU time on the core that prints it. PTWD_SIM_PRINTF_US sets how many
+// uSec each character costs (0 by default): 87 is a 115200 baud UART that printf waits on.
+// PTWD_SIM_CONSOLE="<seconds>:<text>" types 'text' at the console once that many seconds have gone by.
+int host_printf (const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+#define printf host_printf
+
+static inline bool stdio_init_all (void) { return true; }
+int getchar_timeout_us (uint32_t timeout_us);
+
+void panic (const char *fmt, ...) __attribute__((noreturn));
+
+static inline void __breakpoint (void) {}
+
+#define hard_assert(x)      do { if (!(x)) panic("hard_assert failed: %s", #x); } while (0)
+
+#ifdef __cplusplus
+}
+#endif
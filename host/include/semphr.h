@@ -0,0 +1,23 @@
+// Host stand-in for the FreeRTOS "semphr.h" API (mutexes only).
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef struct HostMutex *SemaphoreHandle_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if configSUPPORT_DYNAMIC_ALLOCATION
+SemaphoreHandle_t xSemaphoreCreateMutex (void);
+#endif
+#if configSUPPORT_STATIC_ALLOCATION
+SemaphoreHandle_t xSemaphoreCreateMutexStatic (StaticSemaphore_t *pxMutexBuffer);
+#endif
+BaseType_t xSemaphoreTake (SemaphoreHandle_t xSemaphore, TickType_t xBlockTime);
+BaseType_t xSemaphoreGive (SemaphoreHandle_t xSemaphore);
+
+#ifdef __cplusplus
+}
+#endif
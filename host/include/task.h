@@ -0,0 +1,100 @@
+// Host stand-in for the FreeRTOS "task.h" API.
+#pragma once
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+typedef struct HostTask *TaskHandle_t;
+
+typedef enum {
+    eRunning = 0,
+    eReady,
+    eBlocked,
+    eSuspended,
+    eDeleted,
+    eInvalid
+} eTaskState;
+
+typedef enum {
+    eAbortSleep = 0,
+    eStandardSleep,
+    eNoTasksWaitingTimeout
+} eSleepModeStatus;
+
+// Run time stats. A task's run time is the simulated time it spent busy, which is mostly time
+// spent clocking the simulated bus. Stack high-water marks are measured on the much bigger
+// host stacks, so they are only good for spotting changes.
+typedef struct {
+    TaskHandle_t xHandle;
+    const char *pcTaskName;
+    UBaseType_t xTaskNumber;
+    eTaskState eCurrentState;
+    UBaseType_t uxCurrentPriority;
+    UBaseType_t uxBasePriority;
+    configRUN_TIME_COUNTER_TYPE ulRunTimeCounter;
+    StackType_t *pxStackBase;
+    configSTACK_DEPTH_TYPE usStackHighWaterMark;
+} TaskStatus_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Like the real kernel, only the allocation schemes that FreeRTOSConfig.h turns on are available.
+// Static tasks still run on a big host stack: 'puxStackBuffer' is only checked, not used.
+#if configSUPPORT_DYNAMIC_ALLOCATION
+BaseType_t xTaskCreate (TaskFunction_t pxTaskCode, const char *pcName, configSTACK_DEPTH_TYPE uxStackDepth,
+                        void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask);
+#endif
+#if configSUPPORT_STATIC_ALLOCATION
+TaskHandle_t xTaskCreateStatic (TaskFunction_t pxTaskCode, const char *pcName, configSTACK_DEPTH_TYPE uxStackDepth,
+                                void *pvParameters, UBaseType_t uxPriority, StackType_t *puxStackBuffer,
+                                StaticTask_t *pxTaskBuffer);
+#endif
+void vTaskDelay (TickType_t xTicksToDelay);
+void vTaskDelayUntil (TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement);
+BaseType_t xTaskDelayUntil (TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement);
+TickType_t xTaskGetTickCount (void);
+TaskHandle_t xTaskGetCurrentTaskHandle (void);
+void vTaskStartScheduler (void);
+UBaseType_t uxTaskGetSystemState (TaskStatus_t *pxTaskStatusArray, UBaseType_t uxArraySize,
+                                  configRUN_TIME_COUNTER_TYPE *pulTotalRunTime);
+
+// SMP: tasks never really run in parallel on the host, but each one reports the core it is pinned to
+void vTaskCoreAffinitySet (const TaskHandle_t xTask, UBaseType_t uxCoreAffinityMask);
+TaskHandle_t xTaskGetCurrentTaskHandleForCore (BaseType_t xCoreID);
+TaskHandle_t xTaskGetIdleTaskHandleForCore (BaseType_t xCoreID);
+
+// Tickless idle. The scheduler calls portSUPPRESS_TICKS_AND_SLEEP when the tick core has nothing
+// to do for at least configEXPECTED_IDLE_TIME_BEFORE_SLEEP ticks, and checks that the ticks that
+// got stepped over add up to the time that went by.
+eSleepModeStatus eTaskConfirmSleepModeStatus (void);
+void vTaskStepTick (TickType_t xTicksToJump);
+
+// Direct to task notifications (counting semaphore style)
+uint32_t ulTaskNotifyTakeIndexed (UBaseType_t uxIndexToWaitOn, BaseType_t xClearCountOnExit, TickType_t xTicksToWait);
+BaseType_t xTaskNotifyGiveIndexed (TaskHandle_t xTaskToNotify, UBaseType_t uxIndexToNotify);
+void vTaskNotifyGiveIndexedFromISR (TaskHandle_t xTaskToNotify, UBaseType_t uxIndexToNotify,
+                                    BaseType_t *pxHigherPriorityTaskWoken);
+uint32_t ulTaskNotifyValueClearIndexed (TaskHandle_t xTask, UBaseType_t uxIndexToClear, uint32_t ulBitsToClear);
+
+#define ulTaskNotifyTake( xClearCountOnExit, xTicksToWait ) \
+    ulTaskNotifyTakeIndexed( 0, ( xClearCountOnExit ), ( xTicksToWait ) )
+#define xTaskNotifyGive( xTaskToNotify ) \
+    xTaskNotifyGiveIndexed( ( xTaskToNotify ), 0 )
+#define vTaskNotifyGiveFromISR( xTaskToNotify, pxHigherPriorityTaskWoken ) \
+    vTaskNotifyGiveIndexedFromISR( ( xTaskToNotify ), 0, ( pxHigherPriorityTaskWoken ) )
+
+// Nothing ever runs in parallel on the host, so there is nothing to keep out
+#define taskENTER_CRITICAL()        ( ( void ) 0 )
+#define taskEXIT_CRITICAL()         ( ( void ) 0 )
+
+// There is no preemption in the host scheduler, so yielding from an "ISR" is a no-op
+#define portYIELD_FROM_ISR( x )     ( ( void ) ( x ) )
+
+// Application hooks
+void vApplicationIdleHook (void);
+
+#ifdef __cplusplus
+}
+#endif
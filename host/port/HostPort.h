@@ -0,0 +1,26 @@
+// Internal interface between the pieces of the host port.
+#pragma once
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// The simulated clock, in uSec since power-on
+uint64_t host_now_us ();
+
+// Account for time spent busy (e.g. clocking bits onto the simulated Onewire bus).
+// No other task gets to run while the time passes, just as if the core were spinning.
+void host_busy_us (uint64_t us);
+
+// Block the calling task (or the boot code if the scheduler is not running yet)
+// until the simulated clock reaches 'wake_us'.
+void host_sleep_until_us (uint64_t wake_us);
+
+// The core that the current task is pinned to (0 if it is free to run anywhere)
+uint host_current_core ();
+
+// Run 'fn' from the scheduler once the simulated clock reaches 'when_us'.
+// This stands in for a hardware interrupt: 'fn' may use the FreeRTOS ...FromISR() calls.
+void host_call_at (uint64_t when_us, void (*fn)(void *), void *arg);
+
+// Called once when the simulation run ends. Returns the process exit status.
+int host_sim_finish ();
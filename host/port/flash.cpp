@@ -0,0 +1,79 @@
+// Host implementation of the flash API, backed by a RAM array and optionally a file
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+#include "HostPort.h"
+
+uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+
+// Erasing and programming take real time on the target (the data sheet typical values)
+static const uint32_t sector_erase_us = 45000;
+static const uint32_t page_program_us = 400;
+
+// --------------------------------------------------------------------------------------------
+static const char *flash_file ()
+{
+    return getenv("PTWD_SIM_FLASH");
+}
+
+// Erased flash reads as all 1's. Load the saved contents (if any) before main() runs.
+static struct FlashLoader {
+    FlashLoader ()
+    {
+        memset(host_flash, 0xFF, sizeof(host_flash));
+        const char *name = flash_file();
+        FILE *f = name ? fopen(name, "rb") : nullptr;
+        if (f) {
+            size_t n = fread(host_flash, 1, sizeof(host_flash), f);
+            (void)n;
+            fclose(f);
+        }
+    }
+} loader;
+
+static void flash_save ()
+{
+    const char *name = flash_file();
+    FILE *f = name ? fopen(name, "wb") : nullptr;
+    if (f) {
+        fwrite(host_flash, 1, sizeof(host_flash), f);
+        fclose(f);
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+void flash_range_erase (uint32_t flash_offs, size_t count)
+{
+    if ((flash_offs % FLASH_SECTOR_SIZE) || (count % FLASH_SECTOR_SIZE) || (flash_offs + count > sizeof(host_flash))) {
+        panic("flash_range_erase: bad range 0x%x/0x%x", flash_offs, (uint32_t)count);
+    }
+    memset(&host_flash[flash_offs], 0xFF, count);
+    host_busy_us((uint64_t)sector_erase_us * (count / FLASH_SECTOR_SIZE));
+    flash_save();
+}
+
+void flash_range_program (uint32_t flash_offs, const uint8_t *data, size_t count)
+{
+    if ((flash_offs % FLASH_PAGE_SIZE) || (count % FLASH_PAGE_SIZE) || (flash_offs + count > sizeof(host_flash))) {
+        panic("flash_range_program: bad range 0x%x/0x%x", flash_offs, (uint32_t)count);
+    }
+
+    // Programming can only clear bits
+    for (size_t i = 0; i < count; i++) {
+        host_flash[flash_offs + i] &= data[i];
+    }
+    host_busy_us((uint64_t)page_program_us * (count / FLASH_PAGE_SIZE));
+    flash_save();
+}
+
+int flash_safe_execute (void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms)
+{
+    (void)enter_exit_timeout_ms;
+    func(param);
+    return PICO_OK;
+}
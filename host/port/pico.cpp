@@ -0,0 +1,264 @@
+// Host implementations of the few Pico SDK functions that the ptwd sources use.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hardware/pll.h"
+#include "hardware/structs/m33.h"
+#include "hardware/structs/xip_ctrl.h"
+#include "HostPort.h"
+
+// --------------------------------------------------------------------------------------------
+uint32_t time_us_32 (void)
+{
+    return (uint32_t)host_now_us();
+}
+
+uint64_t time_us_64 (void)
+{
+    return host_now_us();
+}
+
+void sleep_us (uint64_t us)
+{
+    host_sleep_until_us(host_now_us() + us);
+}
+
+void sleep_ms (uint32_t ms)
+{
+    sleep_us((uint64_t)ms * 1000);
+}
+
+void busy_wait_us (uint64_t us)
+{
+    host_busy_us(us);
+}
+
+uint get_core_num (void)
+{
+    return host_current_core();
+}
+
+int host_printf (const char *fmt, ...)
+{
+    static const char *s = getenv("PTWD_SIM_PRINTF_US");
+    static const uint32_t us_per_char = s ? atoi(s) : 0;
+
+    va_list args;
+    va_start(args, fmt);
+    int n = vprintf(fmt, args);
+    va_end(args);
+    if ((n > 0) && (us_per_char > 0)) {
+        host_busy_us((uint64_t)n * us_per_char);
+    }
+    return n;
+}
+
+// The text in PTWD_SIM_CONSOLE comes out one character per call, once its time has come
+int getchar_timeout_us (uint32_t timeout_us)
+{
+    (void)timeout_us;
+    static const char *s = getenv("PTWD_SIM_CONSOLE");
+    static const uint64_t at_us = s ? (uint64_t)atoi(s) * 1000000 : 0;
+    static const char *text = (s && strchr(s, ':')) ? strchr(s, ':') + 1 : nullptr;
+
+    if (text && (*text != '\0') && (host_now_us() >= at_us)) {
+        return *text++;
+    }
+    return PICO_ERROR_TIMEOUT;
+}
+
+void panic (const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    fputs("*** PANIC ***\n", stdout);
+    vprintf(fmt, args);
+    fputs("\n", stdout);
+    va_end(args);
+    exit(2);
+}
+
+// --------------------------------------------------------------------------------------------
+// Cancelling an alarm leaves its event queued: the event only fires the alarm if it is still the latest one set
+static const uint NUM_ALARMS = 4;
+
+static struct {
+    bool claimed;
+    bool armed;
+    uint32_t generation;
+    hardware_alarm_callback_t callback;
+} alarms[NUM_ALARMS];
+
+static void alarm_event (void *arg)
+{
+    uintptr_t packed = (uintptr_t)arg;
+    uint alarm_num = packed % NUM_ALARMS;
+    if (alarms[alarm_num].armed && (alarms[alarm_num].generation == packed / NUM_ALARMS)) {
+        alarms[alarm_num].armed = false;
+        if (alarms[alarm_num].callback) {
+            alarms[alarm_num].callback(alarm_num);
+        }
+    }
+}
+
+int hardware_alarm_claim_unused (bool required)
+{
+    for (uint i = 0; i < NUM_ALARMS; i++) {
+        if (!alarms[i].claimed) {
+            alarms[i].claimed = true;
+            return i;
+        }
+    }
+    if (required) {
+        panic("No timer alarms are available");
+    }
+    return -1;
+}
+
+void hardware_alarm_set_callback (uint alarm_num, hardware_alarm_callback_t callback)
+{
+    alarms[alarm_num].callback = callback;
+}
+
+bool hardware_alarm_set_target (uint alarm_num, absolute_time_t t)
+{
+    alarms[alarm_num].generation++;
+    if (t <= host_now_us()) {
+        alarms[alarm_num].armed = false;
+        return true;
+    }
+    alarms[alarm_num].armed = true;
+    host_call_at(t, alarm_event, (void *)(uintptr_t)(alarms[alarm_num].generation * NUM_ALARMS + alarm_num));
+    return false;
+}
+
+void hardware_alarm_cancel (uint alarm_num)
+{
+    alarms[alarm_num].armed = false;
+}
+
+// --------------------------------------------------------------------------------------------
+static uint8_t gpio_out_state[48];
+
+void gpio_init (uint gpio)                          { gpio_out_state[gpio] = 0; }
+void gpio_set_dir (uint gpio, bool out)             { (void)gpio; (void)out; }
+void gpio_put (uint gpio, bool value)               { gpio_out_state[gpio] = value; }
+void gpio_set_pulls (uint gpio, bool up, bool down) { (void)gpio; (void)up; (void)down; }
+
+bool gpio_get (uint gpio)
+{
+    // Nothing is wired to the inputs: they read as if their pullups were enabled
+    (void)gpio;
+    return true;
+}
+
+// --------------------------------------------------------------------------------------------
+static uint32_t clk_sys_hz = SYS_CLK_HZ;
+
+// Both PLLs are running when the boot code is done
+pll_hw_t host_pll_hw[2] = {{true}, {true}};
+
+void pll_init (PLL pll, uint ref_div, uint vco_freq, uint post_div1, uint post_div2)
+{
+    (void)ref_div; (void)vco_freq; (void)post_div1; (void)post_div2;
+    pll->running = true;
+}
+
+void pll_deinit (PLL pll)
+{
+    pll->running = false;
+}
+
+// The cycles counted at the speeds that clk_sys ran at before its last change
+static uint64_t cycles_before;
+static uint64_t cycles_since_us;
+
+static uint64_t host_cycles ()
+{
+    return cycles_before + (host_now_us() - cycles_since_us) * clk_sys_hz / MHZ;
+}
+
+m33_hw_t host_m33_hw;
+xip_ctrl_hw_t host_xip_ctrl_hw;
+
+host_cycle_count::operator uint32_t () const
+{
+    bool counting = (host_m33_hw.demcr & M33_DEMCR_TRCENA_BITS) && (host_m33_hw.dwt_ctrl & M33_DWT_CTRL_CYCCNTENA_BITS);
+    return counting ? (uint32_t)host_cycles() : 0;
+}
+
+bool clock_configure (enum clock_index clk, uint32_t src, uint32_t auxsrc, uint32_t src_freq, uint32_t freq)
+{
+    (void)src_freq;
+    if (clk == clk_sys) {
+        if ((src == CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX) &&
+            (((auxsrc == CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS) && !pll_sys->running) ||
+             ((auxsrc == CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB) && !pll_usb->running))) {
+            panic("clk_sys switched over to a PLL that is not running");
+        }
+        cycles_before = host_cycles();
+        cycles_since_us = host_now_us();
+        clk_sys_hz = freq;
+    }
+    return true;
+}
+
+uint32_t clock_get_hz (enum clock_index clk)
+{
+    return (clk == clk_sys) ? clk_sys_hz : 12 * MHZ;
+}
+
+uint32_t frequency_count_khz (uint src)
+{
+    (void)src;
+    return clk_sys_hz / KHZ;
+}
+
+void clock_gpio_init (uint gpio, uint src, float div)
+{
+    (void)gpio; (void)src; (void)div;
+}
+
+// --------------------------------------------------------------------------------------------
+pio_hw_t host_pio_hw[NUM_PIOS];
+
+uint32_t host_pio_sm_hz (PIO pio, uint sm)
+{
+    return pio->clkdiv[sm] ? (uint32_t)(((uint64_t)clk_sys_hz << 8) / pio->clkdiv[sm]) : clk_sys_hz;
+}
+
+bool pio_can_add_program (PIO pio, const pio_program_t *program)
+{
+    return pio->used_instruction_count + program->length <= PIO_INSTRUCTION_COUNT;
+}
+
+uint pio_add_program (PIO pio, const pio_program_t *program)
+{
+    uint offset = pio->used_instruction_count;
+    pio->used_instruction_count += program->length;
+    return offset;
+}
+
+int pio_claim_unused_sm (PIO pio, bool required)
+{
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+        if ((pio->claimed_sm_mask & (1u << sm)) == 0) {
+            pio->claimed_sm_mask |= (1u << sm);
+            return sm;
+        }
+    }
+    if (required) {
+        panic("No PIO state machines are available");
+    }
+    return -1;
+}
+
+void pio_sm_unclaim (PIO pio, uint sm)
+{
+    pio->claimed_sm_mask &= ~(1u << sm);
+}
@@ -0,0 +1,628 @@
+// A minimal stand-in for the FreeRTOS SMP scheduler, used by the host build.
+//
+// Tasks are ucontext coroutines scheduled against a simulated clock. Each of the simulated
+// cores has its own clock. The core that is furthest behind in time always goes next: it runs
+// the highest priority task that is ready (and allowed to run on it) until that task blocks,
+// or until a tick boundary goes by while the task is busy, which gives equal priority tasks a
+// time slice just like the real kernel. When no core has anything to do, the clocks jump
+// forward to the next wakeup. Nothing depends on how fast the host machine is, so every run
+// with the same settings produces identical timing.
+//
+// With tickless idle, the tick core's idle path calls portSUPPRESS_TICKS_AND_SLEEP just like the
+// kernel's idle task. While SysTick is stopped, only a simulated interrupt wakes the core up, so an
+// alarm set for the wrong time shows up as a late task. Each time, the ticks that the application
+// steps over must add up to the time that went by.
+//
+// The simulation ends after PTWD_SIM_SECONDS of simulated time (default 10).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+
+#include <new>
+#include <vector>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "hardware/sync.h"
+#include "hardware/structs/scb.h"
+#include "hardware/structs/systick.h"
+#include "HostPort.h"
+
+struct HostTask {
+    ucontext_t ctx;
+    std::vector<uint8_t> stack;
+    TaskFunction_t code;
+    void *params;
+    const char *name;
+    UBaseType_t priority;
+    uint64_t wake_us;
+    uint64_t last_run;
+    bool deleted;
+    uint64_t run_time_us;
+    uint32_t notify_count[configTASK_NOTIFICATION_ARRAY_ENTRIES];
+    UBaseType_t affinity;
+};
+
+struct HostEvent {
+    uint64_t when_us;
+    void (*fn)(void *);
+    void *arg;
+};
+
+static const uint32_t host_cores = configNUMBER_OF_CORES;
+static const uint64_t tick_us = 1000000 / configTICK_RATE_HZ;
+
+static std::vector<HostTask *> tasks;
+static std::vector<HostEvent> events;
+static HostTask *current;
+static uint32_t current_core;
+static ucontext_t scheduler_ctx;
+static bool scheduler_running;
+static uint64_t now_us;
+static uint64_t core_now_us[host_cores];
+static uint64_t run_count;
+
+// What each core is running: a task, or its idle task
+static HostTask *core_task[host_cores];
+static HostTask idle_tasks[host_cores];
+
+systick_hw_t host_systick_hw;
+
+host_systick_count &host_systick_count::operator= (uint32_t v)
+{
+    (void)v;
+    value = host_systick_hw.rvr;
+    return *this;
+}
+host_scb_hw_t host_scb_hw;
+static const uint32_t systick_enable = 1u << 0;
+static const uint32_t systick_tickint = 1u << 1;
+
+// Whether the current tickless sleep waited with SysTick stopped, the ticks it stepped over,
+// and the sleeps that got them wrong
+static bool tick_stopped;
+static uint64_t stepped_ticks;
+static uint64_t tick_errors;
+
+// Host stacks need to be much bigger than the target stacks: printf alone on glibc uses several KB
+static const size_t host_min_stack_bytes = 256 * 1024;
+
+// New stacks get filled with this, like the kernel does, so that the high-water mark can be found
+static const uint8_t stack_fill_byte = 0xa5;
+
+// --------------------------------------------------------------------------------------------
+uint64_t host_now_us ()
+{
+    return now_us;
+}
+
+static void yield_to_scheduler ()
+{
+    swapcontext(&current->ctx, &scheduler_ctx);
+}
+
+void host_busy_us (uint64_t us)
+{
+    uint64_t before = now_us;
+    now_us += us;
+    if (current) {
+        current->run_time_us += us;
+    }
+
+    // A tick interrupt went by: let the scheduler decide if someone else gets a time slice
+    if (scheduler_running && current && (before / tick_us) != (now_us / tick_us)) {
+        current->wake_us = now_us;
+        yield_to_scheduler();
+    }
+}
+
+void host_sleep_until_us (uint64_t wake_us)
+{
+    if (!scheduler_running || !current) {
+        // Boot code running before the scheduler starts simply burns the time
+        if (wake_us > now_us) {
+            now_us = wake_us;
+        }
+        return;
+    }
+
+    current->wake_us = wake_us;
+    yield_to_scheduler();
+}
+
+void host_call_at (uint64_t when_us, void (*fn)(void *), void *arg)
+{
+    events.push_back({when_us, fn, arg});
+}
+
+// Run every event that has come due, in time order
+static void run_due_events ()
+{
+    while (true) {
+        size_t next = events.size();
+        for (size_t i = 0; i < events.size(); i++) {
+            if (events[i].when_us <= now_us && (next == events.size() || events[i].when_us < events[next].when_us)) {
+                next = i;
+            }
+        }
+        if (next == events.size()) {
+            return;
+        }
+        HostEvent e = events[next];
+        events.erase(events.begin() + next);
+        e.fn(e.arg);
+    }
+}
+
+uint host_current_core ()
+{
+    return current_core;
+}
+
+// --------------------------------------------------------------------------------------------
+static void task_entry (void)
+{
+    current->code(current->params);
+
+    // FreeRTOS tasks must never return, but if one does, treat it like vTaskDelete(NULL)
+    current->deleted = true;
+    yield_to_scheduler();
+}
+
+static HostTask *create_task (TaskFunction_t pxTaskCode, const char *pcName, configSTACK_DEPTH_TYPE uxStackDepth,
+                              void *pvParameters, UBaseType_t uxPriority)
+{
+    HostTask *t = new HostTask();
+    size_t stack_bytes = uxStackDepth * sizeof(StackType_t);
+    if (stack_bytes < host_min_stack_bytes) {
+        stack_bytes = host_min_stack_bytes;
+    }
+    t->stack.resize(stack_bytes, stack_fill_byte);
+    t->code = pxTaskCode;
+    t->params = pvParameters;
+    t->name = pcName;
+    t->priority = uxPriority;
+    t->wake_us = now_us;
+
+    getcontext(&t->ctx);
+    t->ctx.uc_stack.ss_sp = t->stack.data();
+    t->ctx.uc_stack.ss_size = t->stack.size();
+    t->ctx.uc_link = nullptr;
+    makecontext(&t->ctx, task_entry, 0);
+
+    tasks.push_back(t);
+    return t;
+}
+
+#if configSUPPORT_DYNAMIC_ALLOCATION
+BaseType_t xTaskCreate (TaskFunction_t pxTaskCode, const char *pcName, configSTACK_DEPTH_TYPE uxStackDepth,
+                        void *pvParameters, UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask)
+{
+    HostTask *t = create_task(pxTaskCode, pcName, uxStackDepth, pvParameters, uxPriority);
+    if (pxCreatedTask) {
+        *pxCreatedTask = t;
+    }
+    return pdPASS;
+}
+#endif
+
+#if configSUPPORT_STATIC_ALLOCATION
+TaskHandle_t xTaskCreateStatic (TaskFunction_t pxTaskCode, const char *pcName, configSTACK_DEPTH_TYPE uxStackDepth,
+                                void *pvParameters, UBaseType_t uxPriority, StackType_t *puxStackBuffer,
+                                StaticTask_t *pxTaskBuffer)
+{
+    if (!puxStackBuffer || !pxTaskBuffer) {
+        return nullptr;
+    }
+    return create_task(pxTaskCode, pcName, uxStackDepth, pvParameters, uxPriority);
+}
+#endif
+
+// --------------------------------------------------------------------------------------------
+TickType_t xTaskGetTickCount (void)
+{
+    return (TickType_t)(now_us / tick_us);
+}
+
+static uint64_t tick_to_us (uint64_t tick)
+{
+    return tick * tick_us;
+}
+
+void vTaskDelay (TickType_t xTicksToDelay)
+{
+    host_sleep_until_us(tick_to_us((uint64_t)xTaskGetTickCount() + xTicksToDelay));
+}
+
+BaseType_t xTaskDelayUntil (TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement)
+{
+    TickType_t wake = *pxPreviousWakeTime + xTimeIncrement;
+    *pxPreviousWakeTime = wake;
+
+    // If the deadline already passed, FreeRTOS returns without blocking
+    if ((int32_t)(wake - xTaskGetTickCount()) <= 0) {
+        return pdFALSE;
+    }
+    host_sleep_until_us(tick_to_us(wake));
+    return pdTRUE;
+}
+
+void vTaskDelayUntil (TickType_t *pxPreviousWakeTime, TickType_t xTimeIncrement)
+{
+    xTaskDelayUntil(pxPreviousWakeTime, xTimeIncrement);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle (void)
+{
+    return current;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandleForCore (BaseType_t xCoreID)
+{
+    if (current && (current_core == (uint32_t)xCoreID)) {
+        return current;
+    }
+
+    // A core that is ahead of the others is still busy with whatever it ran last
+    return (core_now_us[xCoreID] > now_us) ? core_task[xCoreID] : &idle_tasks[xCoreID];
+}
+
+TaskHandle_t xTaskGetIdleTaskHandleForCore (BaseType_t xCoreID)
+{
+    return &idle_tasks[xCoreID];
+}
+
+void vTaskCoreAffinitySet (const TaskHandle_t xTask, UBaseType_t uxCoreAffinityMask)
+{
+    HostTask *t = xTask ? xTask : current;
+    t->affinity = uxCoreAffinityMask;
+
+    // Like the real kernel, a running task that is no longer allowed on its core moves right away
+    if (scheduler_running && (t == current) && !(uxCoreAffinityMask & (1u << current_core))) {
+        current->wake_us = now_us;
+        yield_to_scheduler();
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+eSleepModeStatus eTaskConfirmSleepModeStatus (void)
+{
+    for (HostTask *t : tasks) {
+        if (!t->deleted && (t->wake_us <= now_us)) {
+            return eAbortSleep;
+        }
+    }
+    return eStandardSleep;
+}
+
+void vTaskStepTick (TickType_t xTicksToJump)
+{
+    stepped_ticks += xTicksToJump;
+}
+
+void __wfi (void)
+{
+    // Tasks never wait for interrupts, and neither does the boot code
+    if (!scheduler_running || current) {
+        return;
+    }
+
+    uint64_t wake_us = UINT64_MAX;
+    if (host_systick_hw.csr & systick_enable) {
+        wake_us = (now_us / tick_us + 1) * tick_us;
+    }
+    else {
+        tick_stopped = true;
+    }
+    for (HostEvent &e : events) {
+        if (e.when_us < wake_us) {
+            wake_us = e.when_us;
+        }
+    }
+    for (uint32_t c = 0; c < host_cores; c++) {
+        if ((core_now_us[c] > now_us) && (core_now_us[c] < wake_us)) {
+            wake_us = core_now_us[c];
+        }
+    }
+
+    // Nothing at all would wake the core up: leave it to the scheduler to end the run
+    if (wake_us == UINT64_MAX) {
+        return;
+    }
+    if (wake_us > now_us) {
+        now_us = wake_us;
+    }
+    run_due_events();
+}
+
+#if configUSE_TICKLESS_IDLE
+// The tick core is idle: like the kernel's idle task, hand over to the application if no task
+// is due for a while. A task that is due at tick T waits until T * tick_us.
+static void idle_sleep ()
+{
+    uint64_t next_us = UINT64_MAX;
+    for (HostTask *t : tasks) {
+        if (!t->deleted && t->wake_us < next_us) {
+            next_us = t->wake_us;
+        }
+    }
+    TickType_t now_tick = xTaskGetTickCount();
+    uint64_t next_tick = (next_us == UINT64_MAX) ? (uint64_t)now_tick + portMAX_DELAY :
+                         (next_us + tick_us - 1) / tick_us;
+    if ((next_tick <= now_tick) || ((next_tick - now_tick) < configEXPECTED_IDLE_TIME_BEFORE_SLEEP)) {
+        return;
+    }
+    TickType_t expected = (TickType_t)(((next_tick - now_tick) > portMAX_DELAY) ? portMAX_DELAY : (next_tick - now_tick));
+
+    host_systick_hw.cvr.value = tick_us - (now_us % tick_us);
+    tick_stopped = false;
+    stepped_ticks = 0;
+    portSUPPRESS_TICKS_AND_SLEEP(expected);
+
+    // Without a tickless sleep, the tick interrupts counted the ticks as usual
+    TickType_t counted = tick_stopped ? (TickType_t)(now_tick + stepped_ticks) : xTaskGetTickCount();
+    if (!(host_systick_hw.csr & systick_enable) || (counted != xTaskGetTickCount()) ||
+        (!tick_stopped && stepped_ticks)) {
+        tick_errors++;
+    }
+}
+#endif
+
+// --------------------------------------------------------------------------------------------
+// Stacks grow down, so the bytes at the bottom that still hold the fill pattern were never used
+static configSTACK_DEPTH_TYPE stack_high_water_mark (const HostTask *t)
+{
+    size_t unused = 0;
+    while ((unused < t->stack.size()) && (t->stack[unused] == stack_fill_byte)) {
+        unused++;
+    }
+    return unused / sizeof(StackType_t);
+}
+
+UBaseType_t uxTaskGetSystemState (TaskStatus_t *pxTaskStatusArray, UBaseType_t uxArraySize,
+                                  configRUN_TIME_COUNTER_TYPE *pulTotalRunTime)
+{
+    if (uxArraySize < tasks.size()) {
+        return 0;
+    }
+
+    UBaseType_t n = 0;
+    for (HostTask *t : tasks) {
+        TaskStatus_t &s = pxTaskStatusArray[n];
+        s.xHandle = t;
+        s.pcTaskName = t->name;
+        s.xTaskNumber = ++n;
+        s.eCurrentState = t->deleted ? eDeleted : (t == current) ? eRunning : (t->wake_us > now_us) ? eBlocked : eReady;
+        s.uxCurrentPriority = t->priority;
+        s.uxBasePriority = t->priority;
+        s.ulRunTimeCounter = t->run_time_us;
+        s.pxStackBase = (StackType_t *)t->stack.data();
+        s.usStackHighWaterMark = stack_high_water_mark(t);
+    }
+    if (pulTotalRunTime) {
+        *pulTotalRunTime = now_us;
+    }
+    return n;
+}
+
+// --------------------------------------------------------------------------------------------
+uint32_t ulTaskNotifyTakeIndexed (UBaseType_t uxIndexToWaitOn, BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+{
+    uint32_t &count = current->notify_count[uxIndexToWaitOn];
+    if (count == 0 && xTicksToWait != 0) {
+        // Givers wake us early by pulling our wakeup time in to 'now'
+        uint64_t timeout_us = (xTicksToWait == portMAX_DELAY) ? UINT64_MAX :
+                              tick_to_us((uint64_t)xTaskGetTickCount() + xTicksToWait);
+        host_sleep_until_us(timeout_us);
+    }
+
+    uint32_t value = count;
+    if (value) {
+        count = xClearCountOnExit ? 0 : count - 1;
+    }
+    return value;
+}
+
+BaseType_t xTaskNotifyGiveIndexed (TaskHandle_t xTaskToNotify, UBaseType_t uxIndexToNotify)
+{
+    xTaskToNotify->notify_count[uxIndexToNotify]++;
+    if (xTaskToNotify->wake_us > now_us) {
+        xTaskToNotify->wake_us = now_us;
+    }
+    return pdPASS;
+}
+
+void vTaskNotifyGiveIndexedFromISR (TaskHandle_t xTaskToNotify, UBaseType_t uxIndexToNotify,
+                                    BaseType_t *pxHigherPriorityTaskWoken)
+{
+    xTaskNotifyGiveIndexed(xTaskToNotify, uxIndexToNotify);
+    if (pxHigherPriorityTaskWoken) {
+        *pxHigherPriorityTaskWoken = pdTRUE;
+    }
+}
+
+uint32_t ulTaskNotifyValueClearIndexed (TaskHandle_t xTask, UBaseType_t uxIndexToClear, uint32_t ulBitsToClear)
+{
+    HostTask *t = xTask ? xTask : current;
+    uint32_t value = t->notify_count[uxIndexToClear];
+    t->notify_count[uxIndexToClear] &= ~ulBitsToClear;
+    return value;
+}
+
+// --------------------------------------------------------------------------------------------
+struct HostMutex {
+    HostTask *holder;
+};
+
+#if configSUPPORT_DYNAMIC_ALLOCATION
+SemaphoreHandle_t xSemaphoreCreateMutex (void)
+{
+    return new HostMutex();
+}
+#endif
+
+#if configSUPPORT_STATIC_ALLOCATION
+SemaphoreHandle_t xSemaphoreCreateMutexStatic (StaticSemaphore_t *pxMutexBuffer)
+{
+    static_assert(sizeof(HostMutex) <= sizeof(StaticSemaphore_t), "StaticSemaphore_t is too small");
+    return new (pxMutexBuffer) HostMutex();
+}
+#endif
+
+// Waiters simply check back every tick
+BaseType_t xSemaphoreTake (SemaphoreHandle_t xSemaphore, TickType_t xBlockTime)
+{
+    TickType_t start = xTaskGetTickCount();
+    while (xSemaphore->holder) {
+        if ((xBlockTime != portMAX_DELAY) && ((xTaskGetTickCount() - start) >= xBlockTime)) {
+            return pdFALSE;
+        }
+        vTaskDelay(1);
+    }
+    xSemaphore->holder = current;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive (SemaphoreHandle_t xSemaphore)
+{
+    if (xSemaphore->holder != current) {
+        return pdFALSE;
+    }
+    xSemaphore->holder = nullptr;
+    return pdTRUE;
+}
+
+// --------------------------------------------------------------------------------------------
+static bool can_run_on (const HostTask *t, uint32_t core)
+{
+    return (t->affinity == 0) || (t->affinity & (1u << core));
+}
+
+// Pick the highest priority ready task for 'core'. Tasks of equal priority take turns.
+static HostTask *pick_ready_task (uint32_t core)
+{
+    HostTask *best = nullptr;
+    for (HostTask *t : tasks) {
+        if (t->deleted || t->wake_us > now_us || !can_run_on(t, core)) {
+            continue;
+        }
+        if (!best || t->priority > best->priority ||
+            (t->priority == best->priority && t->last_run < best->last_run)) {
+            best = t;
+        }
+    }
+    return best;
+}
+
+// The earliest time after 'now_us' at which anything could happen
+static uint64_t next_activity_us ()
+{
+    uint64_t next_us = UINT64_MAX;
+    for (HostTask *t : tasks) {
+        if (!t->deleted && t->wake_us > now_us && t->wake_us < next_us) {
+            next_us = t->wake_us;
+        }
+    }
+    for (HostEvent &e : events) {
+        if (e.when_us > now_us && e.when_us < next_us) {
+            next_us = e.when_us;
+        }
+    }
+    for (uint32_t c = 0; c < host_cores; c++) {
+        if (core_now_us[c] > now_us && core_now_us[c] < next_us) {
+            next_us = core_now_us[c];
+        }
+    }
+    return next_us;
+}
+
+void vTaskStartScheduler (void)
+{
+    const char *s = getenv("PTWD_SIM_SECONDS");
+    uint64_t end_us = (uint64_t)(s ? atoi(s) : 10) * 1000000;
+
+    for (uint32_t c = 0; c < host_cores; c++) {
+        core_now_us[c] = now_us;
+    }
+
+    host_systick_hw.rvr = tick_us - 1;
+    host_systick_hw.csr = systick_enable | systick_tickint;
+
+    scheduler_running = true;
+    while (true) {
+        uint64_t tmin = UINT64_MAX;
+        for (uint32_t c = 0; c < host_cores; c++) {
+            if (core_now_us[c] < tmin) {
+                tmin = core_now_us[c];
+            }
+        }
+        if (tmin >= end_us) {
+            break;
+        }
+
+        // Give every core that is furthest behind a chance to run something
+        bool ran = false;
+        for (uint32_t c = 0; c < host_cores && !ran; c++) {
+            if (core_now_us[c] != tmin) {
+                continue;
+            }
+            now_us = tmin;
+            run_due_events();
+
+            HostTask *t = pick_ready_task(c);
+            if (t) {
+                t->last_run = ++run_count;
+                current = t;
+                current_core = c;
+                core_task[c] = t;
+                swapcontext(&scheduler_ctx, &t->ctx);
+                current = nullptr;
+                current_core = 0;
+                core_now_us[c] = now_us;
+                ran = true;
+            }
+        }
+
+        if (!ran) {
+            // Those cores are idle until the next thing happens anywhere
+            now_us = tmin;
+            vApplicationIdleHook();
+            #if configUSE_TICKLESS_IDLE
+                if (core_now_us[configTICK_CORE] == tmin) {
+                    idle_sleep();
+                }
+            #endif
+
+            // The idle cores waited for an interrupt, and something came in
+            if (now_us > tmin) {
+                for (uint32_t c = 0; c < host_cores; c++) {
+                    if (core_now_us[c] == tmin) {
+                        core_now_us[c] = now_us;
+                    }
+                }
+                continue;
+            }
+
+            uint64_t next_us = next_activity_us();
+            if (next_us == UINT64_MAX) {
+                break;
+            }
+            for (uint32_t c = 0; c < host_cores; c++) {
+                if (core_now_us[c] == tmin) {
+                    core_now_us[c] = next_us;
+                }
+            }
+        }
+    }
+    scheduler_running = false;
+
+    int status = host_sim_finish();
+    if (tick_errors) {
+        printf("sim: FAIL: %llu tickless sleeps lost track of the tick\n", (unsigned long long)tick_errors);
+        status = 1;
+    }
+    fflush(stdout);
+    exit(status);
+}
@@ -0,0 +1,37 @@
+// Host replacement for the SEGGER RTT up-buffers beyond the console (see host/include/SEGGER_RTT.h)
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SEGGER_RTT.h"
+
+// The file that captures each up-buffer, by the environment variable that names it
+static const char *capture_names[] = {nullptr, "PTWD_SIM_TELEMETRY", "PTWD_SIM_LOG", "PTWD_SIM_TRACE"};
+static const unsigned capture_count = sizeof(capture_names) / sizeof(capture_names[0]);
+static FILE *capture[capture_count];
+
+int SEGGER_RTT_ConfigUpBuffer (unsigned BufferIndex, const char *sName, void *pBuffer, unsigned BufferSize, unsigned Flags)
+{
+    (void)sName; (void)pBuffer; (void)BufferSize; (void)Flags;
+
+    if ((BufferIndex < capture_count) && capture_names[BufferIndex]) {
+        const char *name = getenv(capture_names[BufferIndex]);
+        if (name) {
+            capture[BufferIndex] = fopen(name, "wb");
+            if (!capture[BufferIndex]) {
+                perror(name);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+unsigned SEGGER_RTT_Write (unsigned BufferIndex, const void *pBuffer, unsigned NumBytes)
+{
+    if ((BufferIndex < capture_count) && capture[BufferIndex]) {
+        fwrite(pBuffer, 1, NumBytes, capture[BufferIndex]);
+        fflush(capture[BufferIndex]);
+    }
+    return NumBytes;
+}
@@ -0,0 +1,57 @@
+// Host replacement for the Onewire DMA engine (src/OnewireDma.cpp).
+//
+// The whole transaction gets clocked through the simulated bus the moment it starts, but on
+// the bus's own clock instead of the CPU's. Completion is signalled from a simulated interrupt
+// when that bus time has elapsed, so the calling task really does sleep through the transfer
+// and other tasks get to run, just like on the target.
+
+#include "Onewire.h"
+
+#include "SimBus.h"
+#include "../port/HostPort.h"
+
+// The RP2350 has 16 DMA channels. Running out of them is part of what gets simulated.
+static const int host_dma_channels = 16;
+static int host_dma_claimed;
+
+bool Onewire::initDma ()
+{
+    waiter = nullptr;
+    if (host_dma_claimed + 2 > host_dma_channels) {
+        return false;
+    }
+    dma_tx = host_dma_claimed++;
+    dma_rx = host_dma_claimed++;
+    return true;
+}
+
+void Onewire::startDma ()
+{
+    SimBus *bus = static_cast<SimBus *>(ow.bus);
+
+    bus->beginAsync();
+
+    // Same format as the PIO RX FIFO: the pin state from the presence window,
+    // then one word per byte with the bits that were read back in 31..24
+    rxbuf[0] = bus->reset() ? 0 : 1;
+    for (uint32_t i = 0; i < txcount; i++) {
+        uint32_t in = 0;
+        for (int b = 0; b < 8; b++) {
+            in = (in >> 1) | (bus->slot(txbuf[i] >> b) << 31);
+        }
+        rxbuf[1 + i] = in;
+    }
+
+    // The simulated "DMA complete" interrupt
+    host_call_at(bus->endAsync(), [](void *arg) {
+        Onewire *o = static_cast<Onewire *>(arg);
+        if (o->waiter) {
+            vTaskNotifyGiveIndexedFromISR(o->waiter, NOTIFY_INDEX, nullptr);
+        }
+    }, this);
+}
+
+void Onewire::abortDma ()
+{
+    // Nothing to stop: a late completion gets discarded by the next start()
+}
@@ -0,0 +1,604 @@
+#include "SimBus.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+
+#include "../port/HostPort.h"
+#include "ds18b20.h"
+#include "ow_rom.h"
+
+// Power-on contents of a DS18B20 (or DS1822) scratchpad: 85C, TH/TL from EEPROM, 12-bit resolution
+static const uint8_t POWER_ON_SCRATCHPAD[9] = {0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10, 0x00};
+
+// A DS18S20's: 85C in half degrees, TH/TL from EEPROM, and no configuration register
+static const uint8_t DS18S20_POWER_ON_SCRATCHPAD[9] = {0xAA, 0x00, 0x4B, 0x46, 0xFF, 0xFF, 0x0C, 0x10, 0x00};
+
+// Time taken by a COPY_SCRATCHPAD to write the EEPROM
+static const uint32_t COPY_SCRATCHPAD_US = 10000;
+
+static std::map<uint, SimBus *> buses;
+
+// --------------------------------------------------------------------------------------------
+// Dallas/Maxim CRC8, polynomial x^8 + x^5 + x^4 + 1, as used for ROM codes and scratchpads
+uint8_t SimBus::crc8 (const uint8_t *data, uint32_t len)
+{
+    uint8_t crc = 0;
+    while (len--) {
+        uint8_t b = *data++;
+        for (int i = 0; i < 8; i++) {
+            uint8_t mix = (crc ^ b) & 0x01;
+            crc >>= 1;
+            if (mix) {
+                crc ^= 0x8C;
+            }
+            b >>= 1;
+        }
+    }
+    return crc;
+}
+
+// --------------------------------------------------------------------------------------------
+SimBus *SimBus::forGpio (uint gpio)
+{
+    auto it = buses.find(gpio);
+    if (it != buses.end()) {
+        return it->second;
+    }
+
+    const char *s = getenv("PTWD_SIM_SENSORS");
+    SimBus *bus = new SimBus(gpio, s ? atoi(s) : 4);
+    buses[gpio] = bus;
+    return bus;
+}
+
+SimBus::SimBus (uint gpio, uint32_t deviceCount)
+    : gpio(gpio), pio(nullptr), sm(0), resets(0), slots(0), bus_us(0), spin_us(0), searches(0), search_slots(0), search_us(0),
+      scans(0), first_scan_slots(0), last_scan_slots(0), first_scan_bus_us(0), last_scan_bus_us(0),
+      clock_errors(0), data_bits(0), bit_errors(0), bit_error_period(0), async(false), async_us(0), in_search(false), rom_cmd_bits(0), rom_cmd(0)
+{
+    // A cheap deterministic hash turns (gpio, index) into a 48-bit serial number
+    uint64_t seed = 0x9E3779B97F4A7C15ull * (gpio + 1);
+
+    const char *arrive = getenv("PTWD_SIM_ARRIVE_S");
+    const char *depart = getenv("PTWD_SIM_DEPART_S");
+    const char *brownout = getenv("PTWD_SIM_BROWNOUT_S");
+    const char *errors = getenv("PTWD_SIM_BIT_ERRORS");
+    bit_error_period = errors ? atoi(errors) : 0;
+    uint32_t total = deviceCount + (arrive ? 1 : 0);
+
+    std::vector<uint8_t> families;
+    for (const char *f = getenv("PTWD_SIM_FAMILIES"); f && *f; ) {
+        char *end;
+        families.push_back(strtoul(f, &end, 16));
+        f = (*end == ',') ? end + 1 : nullptr;
+    }
+    if (families.empty()) {
+        families.push_back(DS18B20_FAMILY);
+    }
+
+    for (uint32_t i = 0; i < total; i++) {
+        Ds18b20 d = {};
+
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+
+        d.family = families[i % families.size()];
+        uint8_t rom[8];
+        rom[0] = d.family;
+        for (int b = 1; b < 7; b++) {
+            rom[b] = seed >> (8 * b);
+        }
+        rom[7] = crc8(rom, 7);
+        for (int b = 0; b < 8; b++) {
+            d.rom |= (uint64_t)rom[b] << (8 * b);
+        }
+
+        const uint8_t *power_on = (d.family == DS18S20_FAMILY) ? DS18S20_POWER_ON_SCRATCHPAD : POWER_ON_SCRATCHPAD;
+        memcpy(d.eeprom, &power_on[2], sizeof(d.eeprom));
+        powerOn(d);
+
+        // Mostly room-temperature sensors, but every fifth one lives in a freezer
+        d.base_raw = (i % 5 == 4) ? (-18 * 16) : (20 * 16 + (int16_t)(i * 8));
+        d.period_s = 60 + 7 * i;
+        d.state = IDLE;
+
+        d.present_from_us = (i == deviceCount) ? (uint64_t)atoi(arrive) * 1000000 : 0;
+        d.present_until_us = (depart && (i == 0)) ? (uint64_t)atoi(depart) * 1000000 : UINT64_MAX;
+        d.brownout_us = (brownout && (i == 0)) ? (uint64_t)(atof(brownout) * 1000000) : UINT64_MAX;
+        devices.push_back(d);
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+void SimBus::attach (PIO pio, uint sm)
+{
+    this->pio = pio;
+    this->sm = sm;
+}
+
+void SimBus::busTime (uint32_t us)
+{
+    // The bus timing is only right if the state machine's divider matches clk_sys: 1% is plenty close
+    if (pio) {
+        uint32_t hz = host_pio_sm_hz(pio, sm);
+        if ((hz < 990000) || (hz > 1010000)) {
+            clock_errors++;
+        }
+    }
+
+    bus_us += us;
+    if (in_search) {
+        search_us += us;
+    }
+
+    if (async) {
+        async_us += us;
+    }
+    else {
+        spin_us += us;
+        host_busy_us(us);
+    }
+}
+
+uint64_t SimBus::now ()
+{
+    return async ? async_us : host_now_us();
+}
+
+void SimBus::beginAsync ()
+{
+    async = true;
+    async_us = host_now_us();
+}
+
+uint64_t SimBus::endAsync ()
+{
+    async = false;
+    return async_us;
+}
+
+int16_t SimBus::temperature (const Ds18b20 &d, uint64_t t_us)
+{
+    // PTWD_SIM_FLICKER: every sensor holds steady right on the edge between two 1/16 C steps,
+    // and each conversion comes out as one or the other at random
+    static const bool flicker = (getenv("PTWD_SIM_FLICKER") != nullptr);
+    if (flicker) {
+        uint64_t h = (d.rom ^ t_us) * 0x9E3779B97F4A7C15ull;
+        return d.base_raw + (int16_t)(h >> 63);
+    }
+
+    // A slow +/-2C sine wave around the sensor's base temperature
+    double phase = (2.0 * M_PI * (double)t_us) / (1e6 * d.period_s);
+    return d.base_raw + (int16_t)lround(32.0 * sin(phase));
+}
+
+// --------------------------------------------------------------------------------------------
+bool SimBus::isPresent (const Ds18b20 &d)
+{
+    uint64_t t = now();
+    return (t >= d.present_from_us) && (t < d.present_until_us);
+}
+
+// Anything else on the bus only has its ROM code, and ignores every function command
+bool SimBus::isSensor (const Ds18b20 &d)
+{
+    return (d.family == DS18B20_FAMILY) || (d.family == DS1822_FAMILY) || (d.family == DS18S20_FAMILY);
+}
+
+bool SimBus::reset ()
+{
+    resets++;
+    in_search = false;
+    rom_cmd_bits = 0;
+    rom_cmd = 0;
+
+    // A presence pulse is seen if anything is on the bus
+    bool presence = false;
+    for (Ds18b20 &d : devices) {
+        finishBusy(d);
+        d.state = isPresent(d) ? ROM_CMD : IDLE;
+        d.bitpos = 0;
+        d.shift = 0;
+        presence |= isPresent(d);
+    }
+    busTime(RESET_US);
+
+    return presence;
+}
+
+void SimBus::writeBit (uint bit)
+{
+    slot(bit);
+}
+
+uint SimBus::readBit ()
+{
+    // A read slot is a write slot of '1' that the devices are free to pull low
+    return slot(1);
+}
+
+uint SimBus::slot (uint bit, uint32_t us)
+{
+    bit &= 1;
+
+    // Watch the ROM command go by so that the statistics can tell searches from everything else
+    if (rom_cmd_bits < 8) {
+        rom_cmd |= bit << rom_cmd_bits;
+        if (++rom_cmd_bits == 8) {
+            startTransaction(rom_cmd);
+        }
+    }
+
+    slots++;
+    if (in_search) {
+        search_slots++;
+    }
+
+    // The bus is a wired-AND: the master or any device sending a 0 wins
+    uint level = bit;
+    for (Ds18b20 &d : devices) {
+        finishBusy(d);
+        if (!isPresent(d)) {
+            // Unplugged mid-transaction: it will have lost its place when it comes back
+            d.state = IDLE;
+            continue;
+        }
+        if (isReceiving(d)) {
+            receiveBit(d, bit);
+        }
+        else {
+            level &= sendBit(d);
+        }
+    }
+    busTime(us);
+    return level;
+}
+
+bool SimBus::isReceiving (const Ds18b20 &d)
+{
+    switch (d.state) {
+        case ROM_CMD:
+        case FUNC_CMD:
+        case WRITE_DATA:
+        case MATCH_ROM:
+            return true;
+
+        case SEARCH:
+            return (d.bitpos % 3) == 2;
+
+        default:
+            return false;
+    }
+}
+
+void SimBus::startTransaction (uint8_t romCommand)
+{
+    if (romCommand == OW_SEARCH_ROM || romCommand == OW_ALARM_SEARCH) {
+        // The first 7 bits of the command byte already went by, but they belong to the search too
+        searches++;
+        in_search = true;
+        search_slots += 7;
+        search_us += 7 * SLOT_US;
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+void SimBus::receiveBit (Ds18b20 &d, uint bit)
+{
+    switch (d.state) {
+        case ROM_CMD:
+        case FUNC_CMD:
+        case WRITE_DATA:
+            d.shift |= bit << (d.bitpos & 7);
+            if ((++d.bitpos & 7) == 0) {
+                uint8_t byte = d.shift;
+                d.shift = 0;
+                if (d.state == ROM_CMD) {
+                    romCommand(d, byte);
+                }
+                else if (d.state == FUNC_CMD) {
+                    functionCommand(d, byte);
+                }
+                else {
+                    // WRITE_SCRATCHPAD data: TH, TL, then config (only the resolution bits are writable).
+                    // A DS18S20 has no config, and stops listening after TL.
+                    uint32_t idx = 2 + (d.bitpos / 8) - 1;
+                    d.scratchpad[idx] = (idx == 4) ? ((byte & 0x60) | 0x1F) : byte;
+                    d.scratchpad[8] = crc8(d.scratchpad, 8);
+                    if (idx == ((d.family == DS18S20_FAMILY) ? 3u : 4u)) {
+                        d.state = IDLE;
+                    }
+                }
+            }
+            break;
+
+        case MATCH_ROM:
+            if (((d.rom >> d.bitpos) & 1) != bit) {
+                d.state = IDLE;
+            }
+            else if (++d.bitpos == 64) {
+                d.state = FUNC_CMD;
+                d.bitpos = 0;
+            }
+            break;
+
+        case SEARCH:
+            // Every search step is: read the ROM bit, read its complement, write the chosen direction
+            if ((d.bitpos % 3) == 2) {
+                if (((d.rom >> (d.bitpos / 3)) & 1) != bit) {
+                    d.state = IDLE;
+                }
+                else if (++d.bitpos == 3 * 64) {
+                    d.state = FUNC_CMD;
+                    d.bitpos = 0;
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+uint SimBus::sendBit (Ds18b20 &d)
+{
+    switch (d.state) {
+        case SEARCH: {
+            uint phase = d.bitpos % 3;
+            uint romBit = (d.rom >> (d.bitpos / 3)) & 1;
+            d.bitpos++;
+            return (phase == 0) ? romBit : romBit ^ 1;
+        }
+
+        case READ_DATA:
+            if (d.bitpos < d.txlen * 8) {
+                uint bit = (d.tx[d.bitpos / 8] >> (d.bitpos & 7)) & 1;
+                d.bitpos++;
+                if (bit_error_period && ((++data_bits % bit_error_period) == 0)) {
+                    bit ^= 1;
+                    bit_errors++;
+                }
+                return bit;
+            }
+            return 1;
+
+        case BUSY:
+            return 0;
+
+        default:
+            return 1;
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+void SimBus::romCommand (Ds18b20 &d, uint8_t cmd)
+{
+    d.bitpos = 0;
+    switch (cmd) {
+        case OW_SKIP_ROM:
+            d.state = FUNC_CMD;
+            break;
+
+        case OW_MATCH_ROM:
+            d.state = MATCH_ROM;
+            break;
+
+        case OW_SEARCH_ROM:
+            d.state = SEARCH;
+            break;
+
+        case OW_ALARM_SEARCH:
+            d.state = d.alarm ? SEARCH : IDLE;
+            break;
+
+        case OW_READ_ROM:
+            memcpy(d.tx, &d.rom, 8);
+            d.txlen = 8;
+            d.state = READ_DATA;
+            break;
+
+        default:
+            d.state = IDLE;
+            break;
+    }
+}
+
+void SimBus::functionCommand (Ds18b20 &d, uint8_t cmd)
+{
+    uint64_t t = now();
+
+    d.bitpos = 0;
+    if (!isSensor(d)) {
+        d.state = IDLE;
+        return;
+    }
+    switch (cmd) {
+        case DS18B20_CONVERT_T: {
+            // 93.75 mSec at 9 bits, doubling for every extra bit of resolution.
+            // A DS18S20's byte 4 always reads 0xFF, which makes 750 mSec.
+            uint32_t resolution = (d.scratchpad[4] >> 5) & 3;
+            // A scan starts with the first conversion of a cycle: a broadcast, or the first of a
+            // run of addressed ones
+            if (rom_cmd_bits == 8 && !in_search && !anyConverting()) {
+                if (scans == 0) {
+                    first_scan_slots = slots;
+                    first_scan_bus_us = bus_us;
+                }
+                last_scan_slots = slots;
+                last_scan_bus_us = bus_us;
+                scans++;
+            }
+
+            d.busy_until_us = t + (750000 >> (3 - resolution));
+            d.busy = true;
+            d.converting = true;
+            d.state = BUSY;
+            break;
+        }
+
+        case DS18B20_READ_SCRATCHPAD:
+            memcpy(d.tx, d.scratchpad, sizeof(d.scratchpad));
+            d.txlen = sizeof(d.scratchpad);
+            d.state = READ_DATA;
+            break;
+
+        case DS18B20_WRITE_SCRATCHPAD:
+            d.state = WRITE_DATA;
+            break;
+
+        case DS18B20_COPY_SCRATCHPAD:
+            d.busy_until_us = t + COPY_SCRATCHPAD_US;
+            d.busy = true;
+            d.converting = false;
+            d.state = BUSY;
+            break;
+
+        case DS18B20_RECALL_EE:
+            memcpy(&d.scratchpad[2], d.eeprom, sizeof(d.eeprom));
+            d.scratchpad[8] = crc8(d.scratchpad, 8);
+            d.state = IDLE;
+            break;
+
+        case DS18B20_READ_POWER_SUPPLY:
+            // Every simulated sensor is externally powered: read slots return 1
+            d.state = IDLE;
+            break;
+
+        default:
+            d.state = IDLE;
+            break;
+    }
+}
+
+// The scratchpad comes back from EEPROM, with the power-on reading of 85 C
+void SimBus::powerOn (Ds18b20 &d)
+{
+    memcpy(d.scratchpad, (d.family == DS18S20_FAMILY) ? DS18S20_POWER_ON_SCRATCHPAD : POWER_ON_SCRATCHPAD, sizeof(d.scratchpad));
+    memcpy(&d.scratchpad[2], d.eeprom, sizeof(d.eeprom));
+    d.scratchpad[8] = crc8(d.scratchpad, 8);
+    d.busy = false;
+    d.converting = false;
+    d.state = IDLE;
+}
+
+// Complete a conversion or EEPROM copy once its time is up. Either one carries on through a reset,
+// so that several sensors can be told to convert one after the other. A brownout loses it.
+void SimBus::finishBusy (Ds18b20 &d)
+{
+    if (now() >= d.brownout_us) {
+        d.brownout_us = UINT64_MAX;
+        powerOn(d);
+    }
+    if (!d.busy || now() < d.busy_until_us) {
+        return;
+    }
+
+    if (d.converting) {
+        int8_t whole;
+        if (d.family == DS18S20_FAMILY) {
+            // The nearest half degree, and a COUNT_REMAIN that gives back the whole 1/16 C reading:
+            // TEMP_READ - 0.25 + (16 - COUNT_REMAIN) / 16, where TEMP_READ drops the half degree bit
+            int16_t raw = temperature(d, d.busy_until_us);
+            int16_t half_degrees = (raw + 4) >> 3;
+            whole = half_degrees >> 1;
+            d.scratchpad[0] = half_degrees & 0xFF;
+            d.scratchpad[1] = (half_degrees >> 8) & 0xFF;
+            d.scratchpad[6] = whole * 16 + 12 - raw;
+        }
+        else {
+            // Lower resolutions leave the low bits of the result undefined: the simulation clears them
+            uint32_t resolution = (d.scratchpad[4] >> 5) & 3;
+            int16_t raw = temperature(d, d.busy_until_us) & ~((1 << (3 - resolution)) - 1);
+            whole = raw >> 4;
+            d.scratchpad[0] = raw & 0xFF;
+            d.scratchpad[1] = (raw >> 8) & 0xFF;
+            d.scratchpad[6] = 0x10 - (raw & 0x0F);
+        }
+        d.scratchpad[8] = crc8(d.scratchpad, 8);
+
+        d.alarm = (whole >= (int8_t)d.scratchpad[2]) || (whole <= (int8_t)d.scratchpad[3]);
+    }
+    else {
+        memcpy(d.eeprom, &d.scratchpad[2], sizeof(d.eeprom));
+    }
+
+    d.busy = false;
+    d.converting = false;
+    if (d.state == BUSY) {
+        d.state = IDLE;
+    }
+}
+
+bool SimBus::anyConverting ()
+{
+    for (const Ds18b20 &d : devices) {
+        if (d.busy && d.converting && (now() < d.busy_until_us)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// --------------------------------------------------------------------------------------------
+int SimBus::report ()
+{
+    const char *s = getenv("PTWD_SIM_MAX_SLOTS_PER_SCAN");
+    uint64_t budget = s ? strtoull(s, nullptr, 0) : 0;
+    s = getenv("PTWD_SIM_MIN_SCANS");
+    uint64_t min_scans = s ? strtoull(s, nullptr, 0) : 0;
+    int status = 0;
+
+    for (auto &entry : buses) {
+        SimBus *b = entry.second;
+        uint32_t n = b->devices.size();
+
+        printf("sim: bus on gpio %u: %u sensors, %llu resets, %llu slots, %llu uSec of bus time (CPU spinning for %llu)\n",
+               b->gpio, n, (unsigned long long)b->resets, (unsigned long long)b->slots,
+               (unsigned long long)b->bus_us, (unsigned long long)b->spin_us);
+        printf("sim:   searches: %llu, %llu slots, %llu uSec\n",
+               (unsigned long long)b->searches, (unsigned long long)b->search_slots,
+               (unsigned long long)b->search_us);
+        if (b->bit_errors) {
+            printf("sim:   %llu bit errors\n", (unsigned long long)b->bit_errors);
+        }
+        if (b->clock_errors) {
+            printf("sim:   FAIL: %llu resets and time slots with the state machine not running at 1 MHz\n",
+                   (unsigned long long)b->clock_errors);
+            status = 1;
+        }
+
+        // Only complete scans count: a scan runs from one CONVERT_T to the next
+        if (b->scans < min_scans) {
+            printf("sim:   FAIL: %llu scans, expected at least %llu\n",
+                   (unsigned long long)b->scans, (unsigned long long)min_scans);
+            status = 1;
+        }
+        if (b->scans < 2) {
+            printf("sim:   scans: %llu (need at least 2 to measure scan cost)\n", (unsigned long long)b->scans);
+            continue;
+        }
+        uint64_t complete = b->scans - 1;
+        uint64_t per_scan = (b->last_scan_slots - b->first_scan_slots) / complete;
+        uint64_t per_scan_us = (b->last_scan_bus_us - b->first_scan_bus_us) / complete;
+        printf("sim:   scans: %llu, %llu slots/scan (%llu per sensor), %llu uSec of bus time/scan\n",
+               (unsigned long long)b->scans, (unsigned long long)per_scan,
+               (unsigned long long)(n ? per_scan / n : 0), (unsigned long long)per_scan_us);
+
+        if (budget && per_scan > budget) {
+            printf("sim:   FAIL: %llu slots/scan exceeds the budget of %llu\n",
+                   (unsigned long long)per_scan, (unsigned long long)budget);
+            status = 1;
+        }
+    }
+    return status;
+}
+
+int host_sim_finish ()
+{
+    return SimBus::report();
+}
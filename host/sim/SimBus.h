@@ -0,0 +1,139 @@
+// A simulated Onewire bus populated with virtual DS18B20 temperature sensors, or their DS1822 and
+// DS18S20 relatives.
+//
+// The bus is modelled at the time slot level. The host replacement for onewire_library
+// drives it with reset pulses and individual write/read slots, exactly like the PIO program
+// drives a real bus, so every ROM and function command goes through the same protocol
+// state machine that a real DS18B20 implements.
+//
+// Every slot advances the simulated clock and gets counted. That makes the cost of a scan
+// (in slots and in uSec of bus time) measurable per sensor count, without hardware.
+//
+// Environment variables:
+//   PTWD_SIM_SENSORS               number of sensors on each simulated bus (default 4)
+//   PTWD_SIM_MAX_SLOTS_PER_SCAN    if set, the run fails when a scan cycle averages more slots than this
+//   PTWD_SIM_ARRIVE_S              if set, one extra sensor gets plugged into each bus at this many seconds
+//   PTWD_SIM_DEPART_S              if set, the first sensor on each bus gets unplugged at this many seconds
+//   PTWD_SIM_BROWNOUT_S            if set, the first sensor on each bus loses power for a moment at this many seconds
+//   PTWD_SIM_BIT_ERRORS            if set to N, every Nth bit that a sensor sends from its scratchpad gets flipped
+//   PTWD_SIM_FAMILIES              the family codes of the devices, in hex, handed out in turn (default 28: all DS18B20's)
+//                                  Any family but 10, 22 and 28 is a device with nothing but a ROM code, like a DS2401.
+#pragma once
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "hardware/pio.h"
+
+#include <vector>
+
+class SimBus {
+    public:
+        // Standard speed bus timing, in uSec
+        static const uint32_t RESET_US = 960;       // reset pulse plus presence detect window
+        static const uint32_t SLOT_US  = 70;        // one read or write time slot including recovery
+
+        // Each GPIO gets its own bus, created the first time someone asks for it
+        static SimBus *forGpio (uint gpio);
+
+        // Print the bus statistics for every bus. Returns non-zero if a slot budget was exceeded.
+        static int report ();
+
+        // The PIO state machine that drives this bus. Every reset and time slot checks that it is
+        // running at the 1 MHz that the onewire programs are written for.
+        void attach (PIO pio, uint sm);
+
+        bool reset ();
+        void writeBit (uint bit);
+        uint readBit ();
+
+        // One time slot in which the master sends 'bit'. Returns the level seen on the bus.
+        uint slot (uint bit, uint32_t us = SLOT_US);
+
+        // Bus activity between beginAsync() and endAsync() does not keep the CPU busy: it is
+        // timed by the bus's own clock, like a DMA transfer. endAsync() returns the time at
+        // which the bus activity completes.
+        void beginAsync ();
+        uint64_t endAsync ();
+
+        static uint8_t crc8 (const uint8_t *data, uint32_t len);
+
+    private:
+        SimBus (uint gpio, uint32_t deviceCount);
+
+        enum State {
+            IDLE,               // not selected: ignore everything until the next reset
+            ROM_CMD,            // receiving a ROM command byte
+            MATCH_ROM,          // receiving a 64-bit ROM code
+            SEARCH,             // taking part in a ROM search
+            FUNC_CMD,           // selected: receiving a function command byte
+            WRITE_DATA,         // receiving the 3 bytes of a WRITE_SCRATCHPAD
+            READ_DATA,          // sending the bytes in 'tx'
+            BUSY,               // selected for a CONVERT_T or COPY_SCRATCHPAD: read slots return 0 until it is done
+        };
+
+        struct Ds18b20 {
+            uint64_t rom;
+            uint8_t family;
+            uint8_t scratchpad[9];
+            uint8_t eeprom[3];              // TH, TL, config (always 0xFF on a DS18S20)
+            int16_t base_raw;               // temperature profile of this sensor, in 1/16 C
+            uint32_t period_s;
+            bool alarm;
+            uint64_t present_from_us;       // when the sensor is plugged in...
+            uint64_t present_until_us;      // ...and unplugged
+            uint64_t brownout_us;           // when it loses power for a moment
+
+            State state;
+            uint32_t bitpos;
+            uint8_t shift;
+            uint8_t tx[9];
+            uint32_t txlen;
+            uint64_t busy_until_us;
+            bool busy;                      // converting or copying until busy_until_us
+            bool converting;
+        };
+
+        void startTransaction (uint8_t romCommand);
+        bool isPresent (const Ds18b20 &d);
+        static bool isSensor (const Ds18b20 &d);
+        static bool isReceiving (const Ds18b20 &d);
+        void receiveBit (Ds18b20 &d, uint bit);
+        void romCommand (Ds18b20 &d, uint8_t cmd);
+        void functionCommand (Ds18b20 &d, uint8_t cmd);
+        uint sendBit (Ds18b20 &d);
+        void finishBusy (Ds18b20 &d);
+        void powerOn (Ds18b20 &d);
+        bool anyConverting ();
+        int16_t temperature (const Ds18b20 &d, uint64_t t_us);
+        void busTime (uint32_t us);
+        uint64_t now ();
+
+        uint gpio;
+        std::vector<Ds18b20> devices;
+        PIO pio;
+        uint sm;
+
+        // Statistics
+        uint64_t resets;
+        uint64_t slots;
+        uint64_t bus_us;
+        uint64_t spin_us;                   // bus time spent with the CPU waiting on the bus
+        uint64_t searches;
+        uint64_t search_slots;
+        uint64_t search_us;
+        uint64_t scans;
+        uint64_t first_scan_slots, last_scan_slots;
+        uint64_t first_scan_bus_us, last_scan_bus_us;
+        uint64_t clock_errors;              // bus activity with the state machine not running at 1 MHz
+        uint64_t data_bits;                 // scratchpad bits sent by the sensors
+        uint64_t bit_errors;
+        uint32_t bit_error_period;
+
+        bool async;
+        uint64_t async_us;
+
+        bool in_search;
+        uint32_t rom_cmd_bits;
+        uint8_t rom_cmd;
+};
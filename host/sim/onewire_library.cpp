@@ -0,0 +1,159 @@
+// Host replacement for the pico-examples onewire_library.
+//
+// The API and the ROM search algorithm match the real library. Instead of pushing data through
+// a PIO state machine, the bits get clocked through the simulated bus attached to the GPIO.
+// Like the real PIO program, the driver works in either 8-bit mode (whole bytes, LSB first)
+// or 1-bit mode (single slots, used by the ROM search).
+
+#include "SimBus.h"
+
+#include "hardware/clocks.h"
+
+extern "C" {
+    #include "onewire_library.h"
+}
+
+const pio_program_t onewire_program = {nullptr, 17, -1};
+
+static uint sm_bits[NUM_PIOS][NUM_PIO_STATE_MACHINES];
+
+void onewire_sm_init (PIO pio, uint sm, uint offset, uint pin_num, uint bits_per_word)
+{
+    (void)offset;
+    (void)pin_num;
+    sm_bits[pio - pio0][sm] = bits_per_word;
+
+    // Like the real program: 1 MHz, whatever clk_sys is at the time
+    uint32_t div = ((uint64_t)clock_get_hz(clk_sys) << 8) / 1000000;
+    pio_sm_set_clkdiv_int_frac(pio, sm, div >> 8, div & 0xff);
+}
+
+void pio_sm_init (PIO pio, uint sm, uint initial_pc, const pio_sm_config *config)
+{
+    (void)initial_pc;
+    sm_bits[pio - pio0][sm] = config->shift_bits;
+    pio_sm_set_clkdiv_int_frac(pio, sm, config->clkdiv >> 8, config->clkdiv & 0xff);
+}
+
+uint onewire_sm_bits (PIO pio, uint sm)
+{
+    return sm_bits[pio - pio0][sm];
+}
+
+static SimBus *bus (OW *ow)
+{
+    return static_cast<SimBus *>(ow->bus);
+}
+
+bool ow_init (OW *ow, PIO pio, uint offset, uint gpio)
+{
+    int sm = pio_claim_unused_sm(pio, false);
+    if (sm == -1) {
+        return false;
+    }
+
+    ow->pio = pio;
+    ow->sm = sm;
+    ow->jmp_reset = offset;
+    ow->offset = offset;
+    ow->gpio = gpio;
+    ow->bus = SimBus::forGpio(gpio);
+    SimBus::forGpio(gpio)->attach(pio, sm);
+    onewire_sm_init(pio, sm, offset, gpio, 8);
+    return true;
+}
+
+void ow_send (OW *ow, uint data)
+{
+    uint bits = onewire_sm_bits(ow->pio, ow->sm);
+    for (uint i = 0; i < bits; i++) {
+        bus(ow)->writeBit(data >> i);
+    }
+}
+
+uint8_t ow_read (OW *ow)
+{
+    // The real PIO program shifts right into the ISR, so a 1-bit read lands in bit 7
+    uint8_t data = 0;
+    uint bits = onewire_sm_bits(ow->pio, ow->sm);
+    for (uint i = 0; i < bits; i++) {
+        data = (data >> 1) | (bus(ow)->readBit() << 7);
+    }
+    return data;
+}
+
+bool ow_reset (OW *ow)
+{
+    return bus(ow)->reset();
+}
+
+int ow_romsearch (OW *ow, uint64_t *romcodes, int maxdevs, uint command)
+{
+    int index;
+    uint64_t romcode = 0ull;
+    int branch_point;
+    int next_branch_point = -1;
+    int num_found = 0;
+    bool finished = false;
+
+    onewire_sm_init(ow->pio, ow->sm, ow->offset, ow->gpio, 1);
+
+    while (finished == false && (maxdevs == 0 || num_found < maxdevs)) {
+        finished = true;
+        branch_point = next_branch_point;
+        if (ow_reset(ow) == 0) {
+            // no devices present
+            num_found = 0;
+            break;
+        }
+        for (int i = 0; i < 8; i += 1) {
+            ow_send(ow, command >> i);
+        }
+        for (index = 0; index < 64; index += 1) {
+            uint a = ow_read(ow);
+            uint b = ow_read(ow);
+            if (a == 0 && b == 0) {
+                // Devices disagree on this bit: decide which branch to follow
+                if (index == branch_point) {
+                    ow_send(ow, 1);
+                    romcode |= (1ull << index);
+                }
+                else {
+                    if (index > branch_point || (romcode & (1ull << index)) == 0) {
+                        ow_send(ow, 0);
+                        finished = false;
+                        romcode &= ~(1ull << index);
+                        next_branch_point = index;
+                    }
+                    else {
+                        ow_send(ow, 1);
+                    }
+                }
+            }
+            else if (a != 0 && b != 0) {
+                // Nobody answered (e.g. a device got disconnected mid-search)
+                num_found = -2;
+                finished = true;
+                break;
+            }
+            else {
+                if (a == 0) {
+                    ow_send(ow, 0);
+                    romcode &= ~(1ull << index);
+                }
+                else {
+                    ow_send(ow, 1);
+                    romcode |= (1ull << index);
+                }
+            }
+        }
+
+        if (romcodes != nullptr && num_found >= 0) {
+            romcodes[num_found] = romcode;
+        }
+        num_found += 1;
+    }
+
+    onewire_sm_init(ow->pio, ow->sm, ow->offset, ow->gpio, 8);
+    return num_found;
+}
@@ -0,0 +1,65 @@
+// Host replacement for the onewire_triplet PIO program.
+//
+// A state machine running the triplet program turns every word written to its TX FIFO into
+// 3 time slots on the simulated bus, with the same slot timing and the same choice of direction
+// as src/onewire_triplet.pio. The result waits in a one word RX FIFO.
+
+#include "SimBus.h"
+
+extern "C" {
+    #include "onewire_triplet.pio.h"
+}
+
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+
+const pio_program_t onewire_triplet_program = {nullptr, 15, -1};
+
+// Slot lengths of the triplet program, in uSec. The write slot includes the 'out' that waits
+// for the next direction.
+static const uint32_t READ_SLOT_US = 62;
+static const uint32_t WRITE_SLOT_US = 64;
+
+struct TripletSm {
+    SimBus *bus;
+    bool rx_full;
+    uint32_t rx;
+};
+
+static TripletSm triplet_sm[NUM_PIOS][NUM_PIO_STATE_MACHINES];
+
+void onewire_triplet_sm_init (PIO pio, uint sm, uint offset, uint pin_num)
+{
+    (void)offset;
+    triplet_sm[pio - pio0][sm] = {SimBus::forGpio(pin_num), false, 0};
+
+    uint32_t div = ((uint64_t)clock_get_hz(clk_sys) << 8) / 1000000;
+    pio_sm_set_clkdiv_int_frac(pio, sm, div >> 8, div & 0xff);
+}
+
+void pio_sm_put_blocking (PIO pio, uint sm, uint32_t data)
+{
+    TripletSm &t = triplet_sm[pio - pio0][sm];
+    if (!t.bus || t.rx_full) {
+        // With a single word of simulated FIFO, this would deadlock on a real state machine too
+        panic("%s: state machine is not running the triplet program, or its RX FIFO is full", __FUNCTION__);
+    }
+
+    uint bit = t.bus->slot(1, READ_SLOT_US);
+    uint comp = t.bus->slot(1, READ_SLOT_US);
+    uint dir = bit ? 1 : (comp ? 0 : (data & 1));
+    t.bus->slot(dir, WRITE_SLOT_US);
+
+    t.rx = (bit << 30) | (comp << 31);
+    t.rx_full = true;
+}
+
+uint32_t pio_sm_get_blocking (PIO pio, uint sm)
+{
+    TripletSm &t = triplet_sm[pio - pio0][sm];
+    if (!t.rx_full) {
+        panic("%s: nothing in the RX FIFO", __FUNCTION__);
+    }
+    t.rx_full = false;
+    return t.rx;
+}
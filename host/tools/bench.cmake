@@ -0,0 +1,40 @@
+# Runs both halves of the benchmark suite: ptwd-bench's host microbenchmarks, and the firmware's
+# BENCHMARK build on the simulated bus. Their 'bench,' lines go to the console and to OUTPUT.
+# If the file BASE exists, it gets compared against OUTPUT, so keep a copy of OUTPUT from the
+# commit to compare against. Real target numbers come from the firmware's 'bench' target, over RTT, and
+# compare the same way: ptwd-bench --compare base new.
+#   cmake -DBENCH=<ptwd-bench> -DFIRMWARE=<ptwd-host-bench> -DOUTPUT=<file> [-DBASE=<file>] -P bench.cmake
+
+execute_process(
+  COMMAND ${BENCH}
+  OUTPUT_VARIABLE host_out
+  RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "${BENCH} failed: ${result}\n${host_out}")
+endif()
+
+# Long enough for bus 0 to find its sensors and get through every benchmark
+execute_process(
+  COMMAND ${CMAKE_COMMAND} -E env PTWD_SIM_SENSORS=20 PTWD_SIM_SECONDS=10 ${FIRMWARE}
+  OUTPUT_VARIABLE sim_out
+  RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "${FIRMWARE} failed: ${result}\n${sim_out}")
+endif()
+
+string(REGEX MATCHALL "bench,[^\n]*\n" lines "${host_out}${sim_out}")
+string(JOIN "" results ${lines})
+file(WRITE ${OUTPUT} "${results}")
+message("${results}")
+
+if(BASE AND EXISTS ${BASE})
+  execute_process(
+    COMMAND ${BENCH} --compare ${BASE} ${OUTPUT}
+    RESULT_VARIABLE result
+  )
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${BENCH} --compare failed: ${result}")
+  endif()
+endif()
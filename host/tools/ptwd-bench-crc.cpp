@@ -0,0 +1,145 @@
+// ptwd-bench-crc: checks and times the CRC8 methods in src/Crc8.h.
+//
+//   ptwd-bench-crc [scratchpads]
+//
+// First, the table-driven methods must agree with the bitwise one on every single byte, on
+// some random data, and on the ROM code example from Maxim's application note 27, or the program
+// fails. Then each method checks 'scratchpads' 9-byte scratchpads (1000000 by default), and the
+// cost per scratchpad gets printed.
+//
+// That CPU time is the smaller part of what SCRATCHPAD_CRC adds to each reading: the 7 extra bytes
+// take 56 read slots on the bus. Build the firmware with -DCRC_BENCHMARK=1 to get the numbers for the target.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define HAVE_TSC 1
+#else
+    #define HAVE_TSC 0
+#endif
+
+#include "Crc8.h"
+
+// Standard speed read slots, in uSec
+static const uint32_t SLOT_US = 70;
+static const uint32_t SCRATCHPAD_SIZE = 9;
+
+typedef uint8_t (*crc_t)(const uint8_t *, uint32_t);
+
+static const struct {
+    const char *name;
+    crc_t crc;
+} methods[] = {
+    {"bitwise", crc8_bitwise},
+    {"nibble", crc8_nibble},
+    {"table", crc8_table},
+};
+
+// Stop the compiler from optimizing the work away
+static volatile uint8_t sink;
+
+// --------------------------------------------------------------------------------------------
+static bool check ()
+{
+    uint32_t failures = 0;
+
+    // Family code 0x02, serial number 0x1CB801000000, CRC 0xA2
+    static const uint8_t rom[8] = {0x02, 0x1C, 0xB8, 0x01, 0x00, 0x00, 0x00, 0xA2};
+
+    uint8_t data[64];
+    uint32_t seed = 12345;
+    for (uint32_t i = 0; i < sizeof(data); i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = seed >> 16;
+    }
+
+    for (const auto &m : methods) {
+        if ((m.crc(rom, 7) != rom[7]) || (m.crc(rom, 8) != 0)) {
+            fprintf(stderr, "ptwd-bench-crc: %s gets the application note's ROM code wrong\n", m.name);
+            failures++;
+        }
+        for (uint32_t b = 0; b < 256; b++) {
+            uint8_t byte = b;
+            if (m.crc(&byte, 1) != crc8_bitwise(&byte, 1)) {
+                fprintf(stderr, "ptwd-bench-crc: %s gets byte %02x wrong\n", m.name, b);
+                failures++;
+            }
+        }
+        for (uint32_t len = 0; len <= sizeof(data); len++) {
+            if (m.crc(data, len) != crc8_bitwise(data, len)) {
+                fprintf(stderr, "ptwd-bench-crc: %s gets %u bytes of random data wrong\n", m.name, len);
+                failures++;
+            }
+        }
+    }
+    return failures == 0;
+}
+
+// --------------------------------------------------------------------------------------------
+static void timeIt (const char *name, crc_t crc, const uint8_t *scratchpads, uint32_t count)
+{
+    // One run to warm up the caches
+    for (uint32_t i = 0; i < count; i++) {
+        sink = crc(&scratchpads[i * SCRATCHPAD_SIZE], SCRATCHPAD_SIZE);
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    #if HAVE_TSC
+        uint64_t c0 = __rdtsc();
+    #endif
+    for (uint32_t i = 0; i < count; i++) {
+        sink = crc(&scratchpads[i * SCRATCHPAD_SIZE], SCRATCHPAD_SIZE);
+    }
+    #if HAVE_TSC
+        uint64_t c1 = __rdtsc();
+    #endif
+    auto t1 = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / count;
+    #if HAVE_TSC
+        printf("%-8s %8.2f ns/scratchpad %8.2f cycles/scratchpad\n", name, ns, (double)(c1 - c0) / count);
+    #else
+        printf("%-8s %8.2f ns/scratchpad\n", name, ns);
+    #endif
+}
+
+// --------------------------------------------------------------------------------------------
+int main (int argc, char **argv)
+{
+    uint32_t count = (argc > 1) ? strtoul(argv[1], nullptr, 0) : 1000000;
+    if (count == 0) {
+        fprintf(stderr, "usage: %s [scratchpads]\n", argv[0]);
+        return 2;
+    }
+
+    if (!check()) {
+        return 1;
+    }
+
+    // Scratchpads of readings around room temperature, each with its own good CRC
+    uint8_t *scratchpads = new uint8_t[count * SCRATCHPAD_SIZE];
+    uint32_t seed = 12345;
+    for (uint32_t i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        uint16_t raw = 20 * 16 + ((seed >> 16) % 64);
+        uint8_t *s = &scratchpads[i * SCRATCHPAD_SIZE];
+        uint8_t fill[8] = {(uint8_t)raw, (uint8_t)(raw >> 8), 0x4B, 0x46, 0x7F, 0xFF, (uint8_t)(0x10 - (raw & 0x0F)), 0x10};
+        for (uint32_t b = 0; b < 8; b++) {
+            s[b] = fill[b];
+        }
+        s[8] = crc8_bitwise(s, 8);
+    }
+
+    for (const auto &m : methods) {
+        timeIt(m.name, m.crc, scratchpads, count);
+    }
+    printf("bus      %8u us/scratchpad for the 7 extra bytes\n", 7 * 8 * SLOT_US);
+
+    delete[] scratchpads;
+    return 0;
+}
@@ -0,0 +1,129 @@
+// ptwd-bench-temp: checks and times the integer temperature pipeline in src/Temperature.h
+// against the float arithmetic it replaced.
+//
+//   ptwd-bench-temp [samples]
+//
+// First, every possible raw reading gets converted both ways. The integer results must be within
+// rounding of the exact answer, or the program fails. Then each pipeline gets run over 'samples'
+// readings (1000000 by default), and the cost per sample gets printed.
+//
+// The pipelines themselves are in src/TemperatureBench.h.
+//
+// Keep in mind that the host has a hardware FPU, so the two come out about the same here. On an
+// RP2040, every float operation in the old pipeline is a soft-float library call. Build the firmware
+// with -DTEMPERATURE_BENCHMARK=1 to get the numbers for the target.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define HAVE_TSC 1
+#else
+    #define HAVE_TSC 0
+#endif
+
+#include "Temperature.h"
+#include "TemperatureBench.h"
+
+// Stop the compiler from optimizing the pipelines away
+static volatile int32_t sink_i;
+static volatile float sink_f;
+
+// --------------------------------------------------------------------------------------------
+// Every 16-bit raw value a sensor could send must convert to within half a hundredth of the exact temperature.
+// Ties are exactly 0.5 away, which the double arithmetic of the reference can overshoot by a hair.
+static const double TOLERANCE = 0.5 + 1e-6;
+
+static bool check ()
+{
+    uint32_t failures = 0;
+    for (int32_t raw = INT16_MIN; raw <= INT16_MAX; raw++) {
+        double c = raw / 16.0;
+        double f = c * 9.0 / 5.0 + 32.0;
+        int32_t centi_c = Temperature::RawToCentiC::apply(raw);
+        int32_t centi_f = Temperature::RawToCentiF::apply(raw);
+        if ((fabs(centi_c - c * 100.0) > TOLERANCE) || (fabs(centi_f - f * 100.0) > TOLERANCE)) {
+            if (failures++ < 10) {
+                fprintf(stderr, "ptwd-bench-temp: raw %d: got %d C %d F, expected %.4f C %.4f F\n",
+                        raw, centi_c, centi_f, c, f);
+            }
+        }
+    }
+
+    // And back again, for the thresholds
+    for (int32_t centi = -5500; centi <= 12500; centi++) {
+        if (fabs(Temperature::CentiCToRaw::apply(centi) - centi * 16.0 / 100.0) > TOLERANCE) {
+            if (failures++ < 10) {
+                fprintf(stderr, "ptwd-bench-temp: %d centi-C converts to raw %d\n", centi, Temperature::CentiCToRaw::apply(centi));
+            }
+        }
+    }
+
+    char buf[16];
+    static const struct { int32_t centi; const char *text; } formats[] = {
+        {0, "0.00"}, {6, "0.06"}, {-6, "-0.06"}, {-1800, "-18.00"}, {12500, "125.00"}, {-5512, "-55.12"},
+    };
+    for (const auto &t : formats) {
+        Temperature::formatCenti(buf, sizeof(buf), t.centi);
+        if (strcmp(buf, t.text) != 0) {
+            fprintf(stderr, "ptwd-bench-temp: %d centi-degrees formats as '%s' instead of '%s'\n", t.centi, buf, t.text);
+            failures++;
+        }
+    }
+
+    return failures == 0;
+}
+
+// --------------------------------------------------------------------------------------------
+template <typename F>
+static void timeIt (const char *name, F pipeline, const Temperature::raw_t *raw, uint32_t count)
+{
+    // One run to warm up the caches
+    pipeline(raw, count);
+
+    auto t0 = std::chrono::steady_clock::now();
+    #if HAVE_TSC
+        uint64_t c0 = __rdtsc();
+    #endif
+    pipeline(raw, count);
+    #if HAVE_TSC
+        uint64_t c1 = __rdtsc();
+    #endif
+    auto t1 = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / count;
+    #if HAVE_TSC
+        printf("%-8s %8.2f ns/sample %8.2f cycles/sample\n", name, ns, (double)(c1 - c0) / count);
+    #else
+        printf("%-8s %8.2f ns/sample\n", name, ns);
+    #endif
+}
+
+// --------------------------------------------------------------------------------------------
+int main (int argc, char **argv)
+{
+    uint32_t count = (argc > 1) ? strtoul(argv[1], nullptr, 0) : 1000000;
+    if (count == 0) {
+        fprintf(stderr, "usage: %s [samples]\n", argv[0]);
+        return 2;
+    }
+
+    if (!check()) {
+        return 1;
+    }
+
+    Temperature::raw_t *raw = new Temperature::raw_t[count];
+    TemperatureBench::makeReadings(raw, count);
+
+    timeIt("float", [](const Temperature::raw_t *r, uint32_t n) { TemperatureBench::floatPipeline(r, n, &sink_f); }, raw, count);
+    timeIt("integer", [](const Temperature::raw_t *r, uint32_t n) { TemperatureBench::integerPipeline(r, n, &sink_i); }, raw, count);
+
+    delete[] raw;
+    return 0;
+}
@@ -0,0 +1,318 @@
+// ptwd-bench: times the portable kernels of the firmware on the host, and compares benchmark results.
+//
+//   ptwd-bench
+//   ptwd-bench --compare base new
+//
+// The kernels are the same code that runs on the target, straight out of src/:
+//   crc8 bitwise/nibble/table  checking a 9-byte scratchpad (Crc8.h)
+//   rom search pass            one pass of the search algorithm, which finds one device (RomSearch.h)
+//                              on a model of a bus with 20 devices that costs next to nothing itself
+//   telemetry encode           one reading's delta, zig-zagged and varint encoded (Telemetry.h)
+//   temperature conversion     the report task's math on one reading (Temperature.h)
+// Every result is a line in the same format as the firmware's BENCHMARK build (see src/Bench.h),
+// with "host" as the platform. The unit is TSC ticks where there is a TSC, and nSec elsewhere.
+// The search has to find every device, or the program fails.
+//
+// --compare reads the 'bench,' lines out of two files, and ignores everything else in them. So the
+// input can be a capture of the firmware's console just as well as this program's output. It prints
+// how much each median changed from 'base' to 'new'.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define HAVE_TSC 1
+#else
+    #define HAVE_TSC 0
+#endif
+
+#include "Bench.h"
+#include "Crc8.h"
+#include "RomSearch.h"
+#include "Telemetry.h"
+#include "Temperature.h"
+#include "TemperatureBench.h"
+
+#if HAVE_TSC
+    static const char *UNIT = "tsc";
+#else
+    static const char *UNIT = "ns";
+#endif
+
+// Each run does the kernel this many times, so that it takes long enough to time
+static const uint32_t REPEAT = 10000;
+
+static const uint32_t SCRATCHPAD_SIZE = 9;
+static const uint32_t SEARCH_DEVICES = 20;
+static const uint32_t READINGS = 64;
+
+// Stop the compiler from optimizing the work away
+static volatile uint32_t sink;
+static volatile int32_t sink_i;
+
+static uint64_t now ()
+{
+    #if HAVE_TSC
+        return __rdtsc();
+    #else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    #endif
+}
+
+// One warm-up run to fill the caches, then Bench::MAX_RUNS timed ones of 'per' operations each
+template <typename RUN>
+static void timeIt (const char *name, uint32_t per, RUN run)
+{
+    Bench bench("host", name, UNIT, per);
+    run();
+    while (!bench.full()) {
+        uint64_t t0 = now();
+        run();
+        bench.add(now() - t0);
+    }
+    bench.print();
+}
+
+// --------------------------------------------------------------------------------------------
+static void benchCrc ()
+{
+    static const struct {
+        const char *name;
+        uint8_t (*crc)(const uint8_t *, uint32_t);
+    } methods[] = {
+        {"crc8 bitwise", crc8_bitwise},
+        {"crc8 nibble", crc8_nibble},
+        {"crc8 table", crc8_table},
+    };
+
+    uint8_t scratchpad[SCRATCHPAD_SIZE] = {0x50, 0x01, 0x4B, 0x46, 0x7F, 0xFF, 0x10, 0x10};
+    scratchpad[8] = crc8_bitwise(scratchpad, 8);
+    for (const auto &m : methods) {
+        timeIt(m.name, REPEAT, [&]() {
+            for (uint32_t r = 0; r < REPEAT; r++) {
+                sink = m.crc(scratchpad, sizeof(scratchpad));
+            }
+        });
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+// The bus model: ones[i] has a bit set for every device whose ROM code has bit i set. The devices
+// still taking part in a pass are the ones that agreed with every direction taken so far.
+// Like the wired-AND bus, the bit reads as 1 unless some device has a 0 there, and the complement
+// reads as 1 unless some device has a 1 there.
+struct SearchModel {
+    uint32_t ones[64];
+    uint32_t all;
+    uint32_t active;
+    uint32_t bit;
+
+    uint32_t triplet (uint32_t preferred)
+    {
+        uint32_t a = (active & ~ones[bit]) == 0;
+        uint32_t b = (active & ones[bit]) == 0;
+        uint32_t dir = a ? 1 : (b ? 0 : preferred);
+        active &= dir ? ones[bit] : ~ones[bit];
+        bit++;
+        return a | (b << 1);
+    }
+
+    // Returns how many devices a whole search found, or 0 if a pass went wrong
+    uint32_t search ()
+    {
+        RomSearch::state_t s = {};
+        uint32_t found = 0;
+        do {
+            active = all;
+            bit = 0;
+            uint64_t rom;
+            int last_zero;
+            if (!RomSearch::walk(s, [this](uint32_t preferred) { return triplet(preferred); }, rom, last_zero)) {
+                return 0;
+            }
+            RomSearch::advance(s, rom, last_zero);
+            found++;
+        } while (!s.done && (found <= SEARCH_DEVICES));
+        return found;
+    }
+};
+
+static bool benchSearch ()
+{
+    static SearchModel model;
+    uint64_t roms[SEARCH_DEVICES];
+    uint32_t seed = 12345;
+    for (uint32_t d = 0; d < SEARCH_DEVICES; d++) {
+        uint8_t bytes[8] = {0x28};
+        for (uint32_t b = 1; b < 7; b++) {
+            seed = seed * 1103515245 + 12345;
+            bytes[b] = seed >> 16;
+        }
+        bytes[7] = crc8_bitwise(bytes, 7);
+        roms[d] = 0;
+        for (uint32_t b = 0; b < 8; b++) {
+            roms[d] |= (uint64_t)bytes[b] << (8 * b);
+        }
+    }
+    model.all = (1u << SEARCH_DEVICES) - 1;
+    for (uint32_t i = 0; i < 64; i++) {
+        model.ones[i] = 0;
+        for (uint32_t d = 0; d < SEARCH_DEVICES; d++) {
+            model.ones[i] |= (uint32_t)((roms[d] >> i) & 1) << d;
+        }
+    }
+
+    uint32_t found = model.search();
+    if (found != SEARCH_DEVICES) {
+        fprintf(stderr, "ptwd-bench: the search found %u of %u devices\n", found, SEARCH_DEVICES);
+        return false;
+    }
+
+    const uint32_t searches = REPEAT / SEARCH_DEVICES;
+    timeIt("rom search pass", searches * SEARCH_DEVICES, [&]() {
+        for (uint32_t r = 0; r < searches; r++) {
+            sink = model.search();
+        }
+    });
+    return true;
+}
+
+// --------------------------------------------------------------------------------------------
+static void benchEncoding ()
+{
+    static Temperature::raw_t raw[READINGS];
+    static uint8_t frame[READINGS * 2 * 5];
+    TemperatureBench::makeReadings(raw, READINGS);
+
+    // What Telemetry::addSample() does with each reading that changed
+    const uint32_t rounds = REPEAT / READINGS;
+    timeIt("telemetry encode", rounds * READINGS, [&]() {
+        for (uint32_t r = 0; r < rounds; r++) {
+            uint32_t length = 0;
+            int32_t prev = 0;
+            for (uint32_t i = 0; i < READINGS; i++) {
+                length += Telemetry::putVarint(&frame[length], i << 1);
+                length += Telemetry::putVarint(&frame[length], Telemetry::zigzag(raw[i] - prev));
+                prev = raw[i];
+            }
+            sink = length;
+        }
+    });
+}
+
+static void benchConversion ()
+{
+    static Temperature::raw_t raw[READINGS];
+    TemperatureBench::makeReadings(raw, READINGS);
+
+    const uint32_t rounds = REPEAT / READINGS;
+    timeIt("temperature conversion", rounds * READINGS, [&]() {
+        for (uint32_t r = 0; r < rounds; r++) {
+            TemperatureBench::integerPipeline(raw, READINGS, &sink_i);
+        }
+    });
+}
+
+// --------------------------------------------------------------------------------------------
+typedef struct {
+    std::string unit;
+    uint32_t median;
+} result_t;
+
+// The results by platform and name, in the order they first appear
+typedef std::vector<std::pair<std::string, result_t>> results_t;
+
+static bool readResults (const char *name, results_t &results)
+{
+    FILE *f = fopen(name, "r");
+    if (!f) {
+        perror(name);
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "bench,", 6) != 0) {
+            continue;
+        }
+        std::vector<std::string> fields;
+        std::string field;
+        for (const char *p = line + 6; *p && (*p != '\n') && (*p != '\r'); p++) {
+            if (*p == ',') {
+                fields.push_back(field);
+                field.clear();
+            }
+            else {
+                field += *p;
+            }
+        }
+        fields.push_back(field);
+
+        // platform, name, unit, runs, min, median, max: a benchmark that did no runs has nothing to compare
+        if ((fields.size() != 7) || fields[5].empty()) {
+            continue;
+        }
+        results.push_back({fields[0] + "," + fields[1], {fields[2], (uint32_t)strtoul(fields[5].c_str(), nullptr, 10)}});
+    }
+    fclose(f);
+    return true;
+}
+
+static int compare (const char *base_name, const char *new_name)
+{
+    results_t base, results;
+    if (!readResults(base_name, base) || !readResults(new_name, results)) {
+        return 1;
+    }
+    std::map<std::string, result_t> before(base.begin(), base.end());
+
+    printf("%-8s %-24s %-7s %12s %12s %8s\n", "platform", "benchmark", "unit", "base", "new", "change");
+    for (const auto &r : results) {
+        std::string platform = r.first.substr(0, r.first.find(','));
+        std::string name = r.first.substr(r.first.find(',') + 1);
+        auto b = before.find(r.first);
+        if ((b == before.end()) || (b->second.unit != r.second.unit)) {
+            printf("%-8s %-24s %-7s %12s %12u %8s\n", platform.c_str(), name.c_str(), r.second.unit.c_str(), "-",
+                   r.second.median, "new");
+            continue;
+        }
+        uint32_t was = b->second.median;
+        if (was == 0) {
+            printf("%-8s %-24s %-7s %12u %12u %8s\n", platform.c_str(), name.c_str(), r.second.unit.c_str(), was,
+                   r.second.median, (r.second.median == 0) ? "+0.0%" : "-");
+        }
+        else {
+            printf("%-8s %-24s %-7s %12u %12u %+7.1f%%\n", platform.c_str(), name.c_str(), r.second.unit.c_str(), was,
+                   r.second.median, 100.0 * ((double)r.second.median - was) / was);
+        }
+    }
+    return 0;
+}
+
+// --------------------------------------------------------------------------------------------
+int main (int argc, char **argv)
+{
+    if ((argc == 4) && (strcmp(argv[1], "--compare") == 0)) {
+        return compare(argv[2], argv[3]);
+    }
+    if (argc != 1) {
+        fprintf(stderr, "usage: %s [--compare base new]\n", argv[0]);
+        return 2;
+    }
+
+    benchCrc();
+    if (!benchSearch()) {
+        return 1;
+    }
+    benchEncoding();
+    benchConversion();
+    return 0;
+}
@@ -0,0 +1,261 @@
+// ptwd-decode: turns a capture of the binary telemetry stream (RTT up-buffer 1) back into readings.
+//
+//   ptwd-decode [--json] [capture]
+//
+// Reads the capture file (or stdin), and writes one line per reading to stdout: CSV with a header
+// line by default, or one JSON object per line with --json. Anything unusual about the stream
+// (damaged frames, missing frames, dropped readings) gets reported on stderr, followed by a summary.
+//
+// After a damaged or missing frame, the decoder no longer knows the previous value of any sensor,
+// so readings sent as differences get skipped until each sensor gets an absolute reading again.
+// The firmware sends absolute readings for everything every few seconds.
+//
+// See src/Telemetry.h for the format.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "Telemetry.h"
+#include "Crc8.h"
+
+struct Stats {
+    uint32_t frames;
+    uint32_t samples;
+    uint32_t bad_frames;
+    uint32_t lost_frames;
+    uint32_t skipped_samples;
+    uint32_t junk_bytes;
+};
+
+static bool json;
+static Stats stats;
+
+// The previous raw value of every sensor, by (bus, index)
+static std::map<std::pair<uint32_t, uint32_t>, int32_t> prev_raw;
+
+// The ROM codes of the sensors on each bus, by index
+static std::map<uint32_t, std::vector<uint64_t>> roms;
+
+// --------------------------------------------------------------------------------------------
+static void printSample (uint8_t seq, uint32_t time_ms, uint32_t bus, uint32_t index, int32_t raw)
+{
+    // The sensors report 1/16ths of a degree C as a 16-bit two's complement number
+    int16_t raw16 = (int16_t)(uint16_t)raw;
+    double temp_c = raw16 / 16.0;
+
+    char rom[17] = "";
+    auto table = roms.find(bus);
+    bool known = (table != roms.end()) && (index < table->second.size()) && (table->second[index] != 0);
+    if (known) {
+        snprintf(rom, sizeof(rom), "%016llx", (unsigned long long)table->second[index]);
+    }
+
+    if (json) {
+        printf("{\"seq\":%u,\"time_ms\":%u,\"bus\":%u,\"sensor\":%u,\"rom\":%s%s%s,\"raw\":%d,\"temp_c\":%.4f}\n",
+               seq, time_ms, bus, index, known ? "\"" : "", known ? rom : "null", known ? "\"" : "", raw16, temp_c);
+    }
+    else {
+        printf("%u,%u,%u,%u,%s,%d,%.4f\n", seq, time_ms, bus, index, rom, raw16, temp_c);
+    }
+    stats.samples++;
+}
+
+// --------------------------------------------------------------------------------------------
+static void decodeSamples (uint8_t seq, const uint8_t *p, uint32_t len)
+{
+    if (len < 5) {
+        fprintf(stderr, "ptwd-decode: frame %u: samples frame too short\n", seq);
+        return;
+    }
+    uint32_t bus = p[0];
+    uint32_t time_ms = p[1] | (p[2] << 8) | (p[3] << 16) | ((uint32_t)p[4] << 24);
+
+    uint32_t pos = 5;
+    while (pos < len) {
+        uint32_t key, value, n;
+        if ((n = Telemetry::getVarint(&p[pos], len - pos, &key)) == 0) {
+            break;
+        }
+        pos += n;
+        if ((n = Telemetry::getVarint(&p[pos], len - pos, &value)) == 0) {
+            break;
+        }
+        pos += n;
+
+        uint32_t index = key >> 1;
+        auto prev = prev_raw.find({bus, index});
+        int32_t raw;
+        if (key & 1) {
+            raw = Telemetry::unzigzag(value);
+        }
+        else if (prev != prev_raw.end()) {
+            raw = prev->second + Telemetry::unzigzag(value);
+        }
+        else {
+            stats.skipped_samples++;
+            continue;
+        }
+
+        prev_raw[{bus, index}] = raw;
+        printSample(seq, time_ms, bus, index, raw);
+    }
+
+    if (pos != len) {
+        fprintf(stderr, "ptwd-decode: frame %u: truncated reading\n", seq);
+    }
+}
+
+static void decodeRoms (uint8_t seq, const uint8_t *p, uint32_t len)
+{
+    uint32_t first, n;
+    if ((len < 2) || ((n = Telemetry::getVarint(&p[1], len - 1, &first)) == 0)) {
+        fprintf(stderr, "ptwd-decode: frame %u: ROM frame too short\n", seq);
+        return;
+    }
+    uint32_t bus = p[0];
+    std::vector<uint64_t> &table = roms[bus];
+
+    // A ROM table that starts from index 0 replaces whatever we knew about the bus
+    if (first == 0) {
+        table.clear();
+    }
+    for (uint32_t pos = 1 + n, index = first; (pos + 8) <= len; pos += 8, index++) {
+        uint64_t rom = 0;
+        for (int b = 0; b < 8; b++) {
+            rom |= (uint64_t)p[pos + b] << (8 * b);
+        }
+        if (table.size() <= index) {
+            table.resize(index + 1);
+        }
+        table[index] = rom;
+    }
+}
+
+static void decodeOverflow (uint8_t seq, const uint8_t *p, uint32_t len)
+{
+    uint32_t total;
+    if ((len < 2) || (Telemetry::getVarint(&p[1], len - 1, &total) == 0)) {
+        fprintf(stderr, "ptwd-decode: frame %u: overflow frame too short\n", seq);
+        return;
+    }
+    fprintf(stderr, "ptwd-decode: frame %u: bus %u has dropped %u readings so far\n", seq, p[0], total);
+}
+
+// --------------------------------------------------------------------------------------------
+static void decode (const std::vector<uint8_t> &data)
+{
+    bool have_seq = false;
+    uint8_t expected_seq = 0;
+
+    size_t pos = 0;
+    while (pos < data.size()) {
+        if (data[pos] != Telemetry::SYNC) {
+            stats.junk_bytes++;
+            pos++;
+            continue;
+        }
+        if ((pos + Telemetry::HEADER_SIZE) > data.size()) {
+            fprintf(stderr, "ptwd-decode: capture ends in the middle of a frame\n");
+            break;
+        }
+
+        uint8_t type = data[pos + 1];
+        uint8_t seq = data[pos + 2];
+        uint32_t len = data[pos + 3];
+        size_t frame_size = Telemetry::HEADER_SIZE + len + 1;
+        if ((pos + frame_size) > data.size()) {
+            fprintf(stderr, "ptwd-decode: capture ends in the middle of a frame\n");
+            break;
+        }
+
+        // The CRC covers everything after the sync byte. Followed by the CRC itself, it comes out as 0.
+        if (crc8(&data[pos + 1], frame_size - 1) != 0) {
+            // Maybe that was not really a sync byte: keep looking from the next byte
+            stats.bad_frames++;
+            prev_raw.clear();
+            pos++;
+            continue;
+        }
+
+        if (have_seq && (seq != expected_seq)) {
+            uint8_t lost = seq - expected_seq;
+            fprintf(stderr, "ptwd-decode: frame %u: %u frames missing\n", seq, lost);
+            stats.lost_frames += lost;
+            prev_raw.clear();
+        }
+        have_seq = true;
+        expected_seq = seq + 1;
+        stats.frames++;
+
+        const uint8_t *payload = &data[pos + Telemetry::HEADER_SIZE];
+        switch (type) {
+            case Telemetry::TYPE_SAMPLES:
+                decodeSamples(seq, payload, len);
+                break;
+            case Telemetry::TYPE_ROMS:
+                decodeRoms(seq, payload, len);
+                break;
+            case Telemetry::TYPE_OVERFLOW:
+                decodeOverflow(seq, payload, len);
+                break;
+            default:
+                fprintf(stderr, "ptwd-decode: frame %u: unknown frame type %u\n", seq, type);
+                break;
+        }
+        pos += frame_size;
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+int main (int argc, char **argv)
+{
+    const char *name = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        }
+        else if ((argv[i][0] == '-') && (argv[i][1] != '\0')) {
+            fprintf(stderr, "usage: %s [--json] [capture]\n", argv[0]);
+            return 2;
+        }
+        else {
+            name = argv[i];
+        }
+    }
+
+    FILE *f = stdin;
+    if (name && strcmp(name, "-") != 0) {
+        f = fopen(name, "rb");
+        if (!f) {
+            perror(name);
+            return 1;
+        }
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+    if (f != stdin) {
+        fclose(f);
+    }
+
+    if (!json) {
+        printf("seq,time_ms,bus,sensor,rom,raw,temp_c\n");
+    }
+    decode(data);
+
+    fprintf(stderr, "ptwd-decode: %u frames, %u readings, %u damaged frames, %u missing frames, "
+                    "%u readings skipped, %u junk bytes\n",
+            stats.frames, stats.samples, stats.bad_frames, stats.lost_frames,
+            stats.skipped_samples, stats.junk_bytes);
+
+    return 0;
+}
@@ -0,0 +1,262 @@
+// ptwd-log: pulls the readings back out of the flash log.
+//
+//   ptwd-log [image]
+//
+// The image can be a dump of the log (RTT up-buffer 2, after typing 'l' in the RTT console), or a
+// copy of the whole flash, such as the file that PTWD_SIM_FLASH keeps for the host build. Any 4 KB
+// sector that starts with the log's magic number gets used, oldest first.
+//
+// Writes one CSV line per logged reading to stdout, with a header line. Anything unusual (missing
+// sectors, damaged records) gets reported on stderr, followed by a summary.
+//
+// Change records only carry differences, so the ones at the start of the oldest sector, from before
+// that sector's first keyframe, get skipped: the readings they are relative to have been overwritten.
+//
+// See src/LogFormat.h for the format.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "LogFormat.h"
+#include "Telemetry.h"
+
+static const uint32_t SECTOR_SIZE = 4096;
+static const uint32_t PAGE_SIZE = 256;
+
+struct Stats {
+    uint32_t sectors;
+    uint32_t missing_sectors;
+    uint32_t boots;
+    uint32_t records;
+    uint32_t readings;
+    uint32_t skipped_records;
+    uint32_t bad_records;
+};
+
+static Stats stats;
+
+// What the log has said so far about the sensors on each bus
+struct Bus {
+    bool known = false;                 // a keyframe has been seen since the last boot
+    uint32_t time_ms = 0;
+    std::vector<uint64_t> roms;
+    std::vector<int32_t> raw;
+};
+
+static std::map<uint32_t, Bus> buses;
+
+// --------------------------------------------------------------------------------------------
+static void printReading (uint32_t time_ms, uint32_t bus, uint32_t index)
+{
+    const Bus &b = buses[bus];
+    int32_t raw = b.raw[index];
+    if (raw == LogFormat::NO_READING) {
+        return;
+    }
+    printf("%u,%u,%u,%u,%016llx,%d,%.4f\n", stats.boots, time_ms, bus, index,
+           (unsigned long long)b.roms[index], raw, raw / 16.0);
+    stats.readings++;
+}
+
+// Returns the number of bytes used, or 0 if the record runs past the end of the page
+static uint32_t decodeKeyframe (uint32_t bus, const uint8_t *p, uint32_t len)
+{
+    uint32_t pos = 1;
+    uint32_t first, n;
+    if ((len < pos + 4) || ((n = Telemetry::getVarint(&p[pos + 4], len - pos - 4, &first)) == 0) ||
+        (len < pos + 4 + n + 1)) {
+        return 0;
+    }
+    uint32_t time_ms = p[1] | (p[2] << 8) | (p[3] << 16) | ((uint32_t)p[4] << 24);
+    pos += 4 + n;
+    uint32_t count = p[pos++];
+
+    Bus &b = buses[bus];
+    if (first == 0) {
+        b.roms.clear();
+        b.raw.clear();
+    }
+    b.known = true;
+    b.time_ms = time_ms;
+    for (uint32_t index = first; index < first + count; index++) {
+        uint32_t value;
+        if ((len < pos + 8) || ((n = Telemetry::getVarint(&p[pos + 8], len - pos - 8, &value)) == 0)) {
+            return 0;
+        }
+        uint64_t rom = 0;
+        for (int i = 0; i < 8; i++) {
+            rom |= (uint64_t)p[pos + i] << (8 * i);
+        }
+        pos += 8 + n;
+
+        if (b.roms.size() <= index) {
+            int32_t none = LogFormat::NO_READING;
+            b.roms.resize(index + 1);
+            b.raw.resize(index + 1, none);
+        }
+        b.roms[index] = rom;
+        b.raw[index] = Telemetry::unzigzag(value);
+        printReading(time_ms, bus, index);
+    }
+    return pos;
+}
+
+static uint32_t decodeChanges (uint32_t bus, const uint8_t *p, uint32_t len)
+{
+    uint32_t pos = 1;
+    uint32_t dt, n;
+    if (((n = Telemetry::getVarint(&p[pos], len - pos, &dt)) == 0) || (len < pos + n + 1)) {
+        return 0;
+    }
+    pos += n;
+    uint32_t count = p[pos++];
+
+    Bus &b = buses[bus];
+    bool known = b.known;
+    if (!known) {
+        stats.skipped_records++;
+    }
+    b.time_ms += dt;
+
+    int32_t index = -1;
+    for (uint32_t c = 0; c < count; c++) {
+        uint32_t gap, delta;
+        if ((n = Telemetry::getVarint(&p[pos], len - pos, &gap)) == 0) {
+            return 0;
+        }
+        pos += n;
+        if ((n = Telemetry::getVarint(&p[pos], len - pos, &delta)) == 0) {
+            return 0;
+        }
+        pos += n;
+
+        index += gap + 1;
+        if (!known) {
+            continue;
+        }
+        if ((uint32_t)index >= b.raw.size()) {
+            fprintf(stderr, "ptwd-log: bus %u: change for sensor %d, which is not in the keyframe\n", bus, index);
+            continue;
+        }
+        b.raw[index] += Telemetry::unzigzag(delta);
+        printReading(b.time_ms, bus, index);
+    }
+    return pos;
+}
+
+// --------------------------------------------------------------------------------------------
+static void decodePage (uint32_t sequence, const uint8_t *page, uint32_t start)
+{
+    uint32_t pos = start;
+    while ((pos < PAGE_SIZE) && (page[pos] != LogFormat::BLANK)) {
+        uint8_t type = page[pos] >> 4;
+        uint32_t bus = page[pos] & 0x0F;
+        uint32_t n = 0;
+
+        switch (type) {
+            case LogFormat::TYPE_BOOT:
+                stats.boots++;
+                buses.clear();
+                n = 1;
+                break;
+            case LogFormat::TYPE_KEYFRAME:
+                n = decodeKeyframe(bus, &page[pos], PAGE_SIZE - pos);
+                break;
+            case LogFormat::TYPE_CHANGES:
+                n = decodeChanges(bus, &page[pos], PAGE_SIZE - pos);
+                break;
+        }
+        if (n == 0) {
+            // Nothing else in the page can be trusted
+            fprintf(stderr, "ptwd-log: sector %u: bad record\n", sequence);
+            stats.bad_records++;
+            buses[bus].known = false;
+            return;
+        }
+        stats.records++;
+        pos += n;
+    }
+}
+
+static void decode (const std::vector<uint8_t> &data)
+{
+    // Find every sector of the log, and put them in the order they were written
+    std::vector<std::pair<uint32_t, size_t>> sectors;
+    for (size_t pos = 0; (pos + SECTOR_SIZE) <= data.size(); pos += SECTOR_SIZE) {
+        LogFormat::sector_header_t header;
+        memcpy(&header, &data[pos], sizeof(header));
+        if (header.magic == LogFormat::MAGIC) {
+            sectors.push_back({header.sequence, pos});
+        }
+    }
+    std::sort(sectors.begin(), sectors.end());
+
+    for (size_t s = 0; s < sectors.size(); s++) {
+        uint32_t sequence = sectors[s].first;
+        if ((s > 0) && (sequence != sectors[s - 1].first + 1)) {
+            uint32_t missing = sequence - sectors[s - 1].first - 1;
+            fprintf(stderr, "ptwd-log: sector %u: %u sectors missing\n", sequence, missing);
+            stats.missing_sectors += missing;
+            for (auto &b : buses) {
+                b.second.known = false;
+            }
+        }
+        stats.sectors++;
+
+        const uint8_t *sector = &data[sectors[s].second];
+        for (uint32_t page = 0; page < SECTOR_SIZE; page += PAGE_SIZE) {
+            decodePage(sequence, &sector[page], (page == 0) ? sizeof(LogFormat::sector_header_t) : 0);
+        }
+    }
+    if (!sectors.empty()) {
+        fprintf(stderr, "ptwd-log: sectors %u to %u\n", sectors.front().first, sectors.back().first);
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+int main (int argc, char **argv)
+{
+    const char *name = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if ((argv[i][0] == '-') && (argv[i][1] != '\0')) {
+            fprintf(stderr, "usage: %s [image]\n", argv[0]);
+            return 2;
+        }
+        name = argv[i];
+    }
+
+    FILE *f = stdin;
+    if (name && strcmp(name, "-") != 0) {
+        f = fopen(name, "rb");
+        if (!f) {
+            perror(name);
+            return 1;
+        }
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+    if (f != stdin) {
+        fclose(f);
+    }
+
+    printf("boot,time_ms,bus,sensor,rom,raw,temp_c\n");
+    decode(data);
+
+    fprintf(stderr, "ptwd-log: %u sectors, %u missing sectors, %u boots, %u records, %u readings, "
+                    "%u records skipped, %u bad records\n",
+            stats.sectors, stats.missing_sectors, stats.boots, stats.records, stats.readings,
+            stats.skipped_records, stats.bad_records);
+
+    return 0;
+}
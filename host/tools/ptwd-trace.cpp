@@ -0,0 +1,360 @@
+// ptwd-trace: formats a binary trace, using the format strings in the firmware's ELF file.
+//
+//   ptwd-trace [-t] elf [capture]
+//
+// The capture is what the firmware sent on RTT up-buffer 3 when it was built with BINARY_TRACE=1,
+// or what the host build wrote to the file named by PTWD_SIM_TRACE. It must come from the same
+// build as the ELF file: the records only carry the offsets of their call sites in it.
+// Reads the capture from stdin if there is no file name, or it is "-".
+//
+// Writes the text that printf would have written to stdout. With -t, every line starts with the
+// time that its first record was written, in seconds since boot, and the core that wrote it.
+// Dropped and damaged records get reported on stderr, followed by a summary.
+//
+// Works with the ARM ELF files of the target as well as the host build's own x86-64 executables.
+// See src/TraceFormat.h for the format.
+
+#include <elf.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "TraceFormat.h"
+
+struct Stats {
+    uint32_t records;
+    uint32_t dropped[256];              // by core: each report has the total since boot
+    uint32_t bad_records;
+};
+
+static Stats stats;
+
+// A section of the ELF file that gets loaded into the target's memory
+struct Section {
+    std::string name;
+    uint64_t addr;
+    const uint8_t *data;
+    uint64_t size;
+};
+
+static std::vector<uint8_t> elf;
+static std::vector<Section> sections;
+static const Section *sites;
+
+// --------------------------------------------------------------------------------------------
+static bool readFile (const char *name, std::vector<uint8_t> &data)
+{
+    FILE *f = stdin;
+    if (name && strcmp(name, "-") != 0) {
+        f = fopen(name, "rb");
+        if (!f) {
+            perror(name);
+            return false;
+        }
+    }
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+    if (f != stdin) {
+        fclose(f);
+    }
+    return true;
+}
+
+// The section headers, for either size of ELF file
+template <typename Ehdr, typename Shdr>
+static bool loadSections ()
+{
+    Ehdr ehdr;
+    if (elf.size() < sizeof(ehdr)) {
+        return false;
+    }
+    memcpy(&ehdr, elf.data(), sizeof(ehdr));
+    if ((ehdr.e_shentsize != sizeof(Shdr)) || (ehdr.e_shoff + (uint64_t)ehdr.e_shnum * sizeof(Shdr) > elf.size()) ||
+        (ehdr.e_shstrndx >= ehdr.e_shnum)) {
+        return false;
+    }
+
+    std::vector<Shdr> shdrs(ehdr.e_shnum);
+    memcpy(shdrs.data(), &elf[ehdr.e_shoff], ehdr.e_shnum * sizeof(Shdr));
+    const Shdr &strtab = shdrs[ehdr.e_shstrndx];
+    if (strtab.sh_offset + strtab.sh_size > elf.size()) {
+        return false;
+    }
+
+    for (const Shdr &s : shdrs) {
+        if (!(s.sh_flags & SHF_ALLOC) || (s.sh_type == SHT_NOBITS) || (s.sh_offset + s.sh_size > elf.size()) ||
+            (s.sh_name >= strtab.sh_size)) {
+            continue;
+        }
+        const char *name = (const char *)&elf[strtab.sh_offset + s.sh_name];
+        sections.push_back({std::string(name, strnlen(name, strtab.sh_size - s.sh_name)), s.sh_addr,
+                            &elf[s.sh_offset], s.sh_size});
+    }
+    return true;
+}
+
+static bool loadElf (const char *name)
+{
+    if (!readFile(name, elf)) {
+        return false;
+    }
+    bool ok = false;
+    if ((elf.size() >= EI_NIDENT) && (memcmp(elf.data(), ELFMAG, SELFMAG) == 0) && (elf[EI_DATA] == ELFDATA2LSB)) {
+        if (elf[EI_CLASS] == ELFCLASS32) {
+            ok = loadSections<Elf32_Ehdr, Elf32_Shdr>();
+        }
+        else if (elf[EI_CLASS] == ELFCLASS64) {
+            ok = loadSections<Elf64_Ehdr, Elf64_Shdr>();
+        }
+    }
+    if (!ok) {
+        fprintf(stderr, "ptwd-trace: %s is not a little-endian ELF file\n", name);
+        return false;
+    }
+
+    for (const Section &s : sections) {
+        if (s.name == "ptwd_trace") {
+            sites = &s;
+        }
+    }
+    if (!sites) {
+        fprintf(stderr, "ptwd-trace: %s has no ptwd_trace section: was it built with BINARY_TRACE=1?\n", name);
+        return false;
+    }
+    return true;
+}
+
+// The string at an offset from the start of the ptwd_trace section, wherever it is in the image
+static const char *constant (int32_t offset)
+{
+    uint64_t addr = sites->addr + offset;
+    for (const Section &s : sections) {
+        if ((addr >= s.addr) && (addr < s.addr + s.size)) {
+            const char *str = (const char *)&s.data[addr - s.addr];
+            if (memchr(str, '\0', s.addr + s.size - addr)) {
+                return str;
+            }
+        }
+    }
+    return nullptr;
+}
+
+// --------------------------------------------------------------------------------------------
+static uint32_t get32 (const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t get64 (const uint8_t *p)
+{
+    return get32(p) | ((uint64_t)get32(p + 4) << 32);
+}
+
+// Do what printf would have done with the site's format string and the arguments in the record.
+// Returns false if the arguments do not match the format string.
+static bool format (const char *fmt, uint32_t types, const uint8_t *args, uint32_t len, std::string &out)
+{
+    uint32_t pos = 0;
+    uint32_t arg = 0;
+    char buf[256];
+
+    for (const char *f = fmt; *f; f++) {
+        if (*f != '%') {
+            out += *f;
+            continue;
+        }
+        if (f[1] == '%') {
+            out += '%';
+            f++;
+            continue;
+        }
+
+        // Flags, width and precision get kept. The length gets replaced by the size of the argument
+        // that was really passed, which need not be the same on the target as on the host.
+        const char *start = f++;
+        while (*f && strchr("-+ #0", *f)) {
+            f++;
+        }
+        while ((*f >= '0') && (*f <= '9')) {
+            f++;
+        }
+        if (*f == '.') {
+            f++;
+            while ((*f >= '0') && (*f <= '9')) {
+                f++;
+            }
+        }
+        std::string spec(start, f - start);
+        while (*f && strchr("hljztL", *f)) {
+            f++;
+        }
+        char conv = *f;
+        if (!conv || (arg == TraceFormat::MAX_ARGS)) {
+            return false;
+        }
+        bool integer = strchr("diouxXc", conv);
+        bool is_signed = strchr("dic", conv);
+
+        uint32_t type = (types >> (arg++ * TraceFormat::TYPE_BITS)) & TraceFormat::TYPE_MASK;
+        switch (type) {
+            case TraceFormat::TYPE_INT:
+                if (!integer || (pos + 4 > len)) {
+                    return false;
+                }
+                if (is_signed) {
+                    snprintf(buf, sizeof(buf), (spec + conv).c_str(), (int32_t)get32(&args[pos]));
+                }
+                else {
+                    snprintf(buf, sizeof(buf), (spec + conv).c_str(), get32(&args[pos]));
+                }
+                pos += 4;
+                break;
+            case TraceFormat::TYPE_INT64:
+                if (!integer || (conv == 'c') || (pos + 8 > len)) {
+                    return false;
+                }
+                if (is_signed) {
+                    snprintf(buf, sizeof(buf), (spec + "ll" + conv).c_str(), (long long)get64(&args[pos]));
+                }
+                else {
+                    snprintf(buf, sizeof(buf), (spec + "ll" + conv).c_str(), (unsigned long long)get64(&args[pos]));
+                }
+                pos += 8;
+                break;
+            case TraceFormat::TYPE_DOUBLE: {
+                if (!strchr("fFeEgGaA", conv) || (pos + 8 > len)) {
+                    return false;
+                }
+                uint64_t bits = get64(&args[pos]);
+                double v;
+                memcpy(&v, &bits, sizeof(v));
+                snprintf(buf, sizeof(buf), (spec + conv).c_str(), v);
+                pos += 8;
+                break;
+            }
+            case TraceFormat::TYPE_STRING: {
+                if ((conv != 's') || (pos + 1 > len) || (pos + 1 + args[pos] > len)) {
+                    return false;
+                }
+                std::string s((const char *)&args[pos + 1], args[pos]);
+                snprintf(buf, sizeof(buf), (spec + conv).c_str(), s.c_str());
+                pos += 1 + args[pos];
+                break;
+            }
+            case TraceFormat::TYPE_CONSTANT: {
+                const char *s;
+                if ((conv != 's') || (pos + 4 > len) || !(s = constant((int32_t)get32(&args[pos])))) {
+                    return false;
+                }
+                snprintf(buf, sizeof(buf), (spec + conv).c_str(), s);
+                pos += 4;
+                break;
+            }
+            default:
+                return false;
+        }
+        out += buf;
+    }
+
+    // Every argument must have been used
+    return ((types >> (arg * TraceFormat::TYPE_BITS)) & TraceFormat::TYPE_MASK) == TraceFormat::TYPE_END;
+}
+
+// --------------------------------------------------------------------------------------------
+static void decode (const std::vector<uint8_t> &data, bool timestamps)
+{
+    bool line_start = true;
+    size_t pos = 0;
+    while (pos + sizeof(TraceFormat::record_header_t) <= data.size()) {
+        TraceFormat::record_header_t header;
+        memcpy(&header, &data[pos], sizeof(header));
+        if ((header.size < sizeof(header)) || (pos + header.size > data.size())) {
+            // The sizes are all that keep the records apart, so nothing after this can be trusted
+            fprintf(stderr, "ptwd-trace: bad record at byte %zu, giving up\n", pos);
+            stats.bad_records++;
+            return;
+        }
+        const uint8_t *args = &data[pos + sizeof(header)];
+        uint32_t len = header.size - sizeof(header);
+        pos += header.size;
+
+        if (header.site == TraceFormat::DROPPED) {
+            if (len >= 4) {
+                fprintf(stderr, "ptwd-trace: core %u has dropped %u records\n", header.core, get32(args));
+                stats.dropped[header.core] = get32(args);
+            }
+            continue;
+        }
+
+        uint64_t offset = (uint64_t)header.site * TraceFormat::SITE_ALIGN;
+        std::string text;
+        if ((offset + 4 >= sites->size) || !memchr(&sites->data[offset + 4], '\0', sites->size - offset - 4) ||
+            !format((const char *)&sites->data[offset + 4], get32(&sites->data[offset]), args, len, text)) {
+            fprintf(stderr, "ptwd-trace: bad record for site %u at %u.%06u\n",
+                    header.site, header.time_us / 1000000, header.time_us % 1000000);
+            stats.bad_records++;
+            continue;
+        }
+        stats.records++;
+
+        for (char c : text) {
+            if (timestamps && line_start) {
+                printf("[%5u.%06u %u] ", header.time_us / 1000000, header.time_us % 1000000, header.core);
+            }
+            putchar(c);
+            line_start = (c == '\n');
+        }
+    }
+    if (pos != data.size()) {
+        fprintf(stderr, "ptwd-trace: the last record is cut short\n");
+        stats.bad_records++;
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+int main (int argc, char **argv)
+{
+    bool timestamps = false;
+    const char *names[2] = {};
+    int count = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0) {
+            timestamps = true;
+        }
+        else if (((argv[i][0] == '-') && (argv[i][1] != '\0')) || (count == 2)) {
+            count = 0;
+            break;
+        }
+        else {
+            names[count++] = argv[i];
+        }
+    }
+    if (count == 0) {
+        fprintf(stderr, "usage: %s [-t] elf [capture]\n", argv[0]);
+        return 2;
+    }
+
+    if (!loadElf(names[0])) {
+        return 1;
+    }
+    std::vector<uint8_t> data;
+    if (!readFile(names[1], data)) {
+        return 1;
+    }
+
+    decode(data, timestamps);
+
+    uint32_t dropped = 0;
+    for (uint32_t d : stats.dropped) {
+        dropped += d;
+    }
+    fprintf(stderr, "ptwd-trace: %u records, %u dropped, %u bad records\n", stats.records, dropped, stats.bad_records);
+
+    return 0;
+}
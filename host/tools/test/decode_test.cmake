@@ -0,0 +1,34 @@
+# Runs ptwd-decode on a capture, and compares what it writes to stdout and stderr with the expected output.
+#   cmake -DDECODER=... -DCAPTURE=... -DEXPECTED=<name without extension> [-DJSON=ON] -P decode_test.cmake
+
+if(JSON)
+  set(args --json)
+  set(expected_out ${EXPECTED}.json)
+else()
+  set(args "")
+  set(expected_out ${EXPECTED}.csv)
+endif()
+
+get_filename_component(name ${EXPECTED} NAME)
+set(out ${CMAKE_CURRENT_BINARY_DIR}/${name}${args}.out)
+set(err ${CMAKE_CURRENT_BINARY_DIR}/${name}${args}.err)
+
+execute_process(
+  COMMAND ${DECODER} ${args} ${CAPTURE}
+  OUTPUT_FILE ${out}
+  ERROR_FILE ${err}
+  RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "ptwd-decode failed: ${result}")
+endif()
+
+foreach(pair "${out};${expected_out}" "${err};${EXPECTED}.err")
+  list(GET pair 0 actual)
+  list(GET pair 1 expected)
+  execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${actual} ${expected} RESULT_VARIABLE different)
+  if(different)
+    file(READ ${actual} text)
+    message(FATAL_ERROR "${actual} does not match ${expected}:\n${text}")
+  endif()
+endforeach()
@@ -0,0 +1,45 @@
+# Runs the firmware twice against the same simulated flash: long enough the first time for the log
+# to wrap around, then for a few seconds with a dump at the end. ptwd-log has to get the same readings
+# out of the dump as out of the flash image, from both boots, and without any damaged records.
+#   cmake -DFIRMWARE=<ptwd-host-log> -DEXTRACTOR=<ptwd-log> -P log_test.cmake
+
+set(flash ${CMAKE_CURRENT_BINARY_DIR}/log_test_flash.bin)
+set(dump ${CMAKE_CURRENT_BINARY_DIR}/log_test_dump.bin)
+file(REMOVE ${flash} ${dump})
+
+function(run_firmware SECONDS CONSOLE)
+  execute_process(
+    COMMAND ${CMAKE_COMMAND} -E env PTWD_SIM_SENSORS=5 PTWD_SIM_SECONDS=${SECONDS} PTWD_SIM_FLASH=${flash}
+            PTWD_SIM_CONSOLE=${CONSOLE} PTWD_SIM_LOG=${dump} ${FIRMWARE}
+    OUTPUT_VARIABLE out
+    RESULT_VARIABLE result
+  )
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${FIRMWARE} failed: ${result}\n${out}")
+  endif()
+endfunction()
+
+run_firmware(1500 "")
+run_firmware(30 "28:l")
+
+foreach(image dump flash)
+  execute_process(
+    COMMAND ${EXTRACTOR} ${${image}}
+    OUTPUT_VARIABLE ${image}_csv
+    ERROR_VARIABLE ${image}_err
+    RESULT_VARIABLE result
+  )
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "ptwd-log failed on the ${image}: ${result}")
+  endif()
+endforeach()
+
+if(NOT dump_err MATCHES "4 sectors, 0 missing sectors, 1 boots, [0-9]+ records, [0-9]+ readings, [0-3] records skipped, 0 bad records")
+  message(FATAL_ERROR "unexpected summary for the dump:\n${dump_err}")
+endif()
+if(NOT dump_csv STREQUAL flash_csv)
+  message(FATAL_ERROR "the dump and the flash image do not hold the same readings")
+endif()
+if(NOT dump_csv MATCHES "\n0,[0-9]+,0,0,[0-9a-f]+,-[0-9]+,-1[0-9]\\.[0-9]+\n" OR NOT dump_csv MATCHES "\n1,[0-9]+,0,4,")
+  message(FATAL_ERROR "readings missing from one of the boots:\n${dump_csv}")
+endif()
@@ -0,0 +1,47 @@
+# Runs the same simulation with the diagnostics as text and as a binary trace. ptwd-trace has to turn
+# the trace back into the very same text, line for line, and the console of the traced run must not
+# have any of it.
+#   cmake -DFIRMWARE=<ptwd-host-trace> -DTEXT_FIRMWARE=<ptwd-host> -DFORMATTER=<ptwd-trace> -P trace_test.cmake
+
+set(capture ${CMAKE_CURRENT_BINARY_DIR}/trace_test.bin)
+file(REMOVE ${capture})
+
+foreach(firmware FIRMWARE TEXT_FIRMWARE)
+  execute_process(
+    COMMAND ${CMAKE_COMMAND} -E env PTWD_SIM_SENSORS=4 PTWD_SIM_SECONDS=15 PTWD_SIM_ARRIVE_S=2 PTWD_SIM_DEPART_S=4
+            PTWD_SIM_TRACE=${capture} ${${firmware}}
+    OUTPUT_VARIABLE ${firmware}_out
+    RESULT_VARIABLE result
+  )
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${${firmware}} failed: ${result}\n${${firmware}_out}")
+  endif()
+endforeach()
+
+execute_process(
+  COMMAND ${FORMATTER} ${FIRMWARE} ${capture}
+  OUTPUT_VARIABLE text
+  ERROR_VARIABLE err
+  RESULT_VARIABLE result
+)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "ptwd-trace failed: ${result}\n${err}")
+endif()
+if(NOT err MATCHES "ptwd-trace: [0-9]+ records, 0 dropped, 0 bad records")
+  message(FATAL_ERROR "unexpected summary:\n${err}")
+endif()
+
+# The simulator's own report at the end is not part of the firmware's output
+string(REGEX REPLACE "\nsim:[^\n]*" "" expected "\n${TEXT_FIRMWARE_out}")
+string(REGEX REPLACE "^\n" "" expected "${expected}")
+if(NOT text STREQUAL expected)
+  file(WRITE ${CMAKE_CURRENT_BINARY_DIR}/trace_test_expected.txt "${expected}")
+  file(WRITE ${CMAKE_CURRENT_BINARY_DIR}/trace_test_text.txt "${text}")
+  message(FATAL_ERROR "the trace does not match the text: see trace_test_expected.txt and trace_test_text.txt")
+endif()
+if(NOT text MATCHES "Hello from the TempSensorTask.*has arrived.*temp is -1[0-9]\\.[0-9][0-9]C.*has departed")
+  message(FATAL_ERROR "lines missing from the trace:\n${text}")
+endif()
+if(FIRMWARE_out MATCHES "Hello from|temp is")
+  message(FATAL_ERROR "the traced run still printed its diagnostics:\n${FIRMWARE_out}")
+endif()
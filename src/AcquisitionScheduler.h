@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "SensorRegistry.h"
+
+// Decides which sensors on a bus get a conversion and a reading, and when. All of its times are
+// RTOS ticks, compared with wraparound.
+//
+// Each sensor has its own period. Its job is released at 'release', must be read by its deadline
+// at 'release' + 'period', and the next job is released one period after that. A job goes:
+//   due          released (or about to be, within a small window that lets neighbours share a conversion)
+//   converting   its CONVERT_T has been sent, and it is done at 'ready'
+//   complete     it got read (or, in exception-only mode, the alarm search said it did not change)
+// Due and ready sensors get handled earliest deadline first, so a fast sensor never waits behind
+// a slow one that has plenty of time left.
+//
+// A conversion can be started with one broadcast (SKIP_ROM + CONVERT_T: a reset and 16 slots)
+// whatever the number of sensors, or sensor by sensor (MATCH_ROM + ROM code + CONVERT_T: a reset
+// and 80 slots each). A broadcast also sets off every sensor that is not due, which then draws
+// its conversion current for nothing, and it would restart any conversion already under way.
+// So a broadcast only gets used when nothing is converting and at least half of the sensors are
+// due. When every sensor shares one period that is every time, and the bus runs exactly as it did
+// with a fixed scan period.
+template <uint32_t CAPACITY>
+class AcquisitionScheduler {
+    public:
+        typedef SensorRegistry<CAPACITY> registry_t;
+
+        // True if tick 'a' comes before tick 'b'
+        static bool before (uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+        static uint32_t deadline (const registry_t &s, int i) { return s.release[i] + s.period[i]; }
+
+        // The first release of a new sensor's jobs: the latest multiple of its period since 'epoch',
+        // so that sensors with the same period stay in step however late they showed up
+        static uint32_t firstRelease (uint32_t period, uint32_t epoch, uint32_t now)
+        {
+            return epoch + ((now - epoch) / period) * period;
+        }
+
+        // Fill 'slots' with the sensors that need a conversion started, earliest deadline first.
+        // Returns how many there are.
+        static int due (const registry_t &s, uint32_t now, uint32_t window, uint16_t *slots)
+        {
+            int n = 0;
+            for (int i = 0; i < s.count(); i++) {
+                if (!s.converting[i] && !before(now + window, s.release[i])) {
+                    slots[n++] = i;
+                }
+            }
+            sortByDeadline(s, slots, n);
+            return n;
+        }
+
+        // Fill 'slots' with the sensors whose conversion is done, earliest deadline first.
+        // Returns how many there are.
+        static int ready (const registry_t &s, uint32_t now, uint16_t *slots)
+        {
+            int n = 0;
+            for (int i = 0; i < s.count(); i++) {
+                if (s.converting[i] && !before(now, s.ready[i])) {
+                    slots[n++] = i;
+                }
+            }
+            sortByDeadline(s, slots, n);
+            return n;
+        }
+
+        // Whether to start the conversions of 'count' due sensors with a single broadcast
+        static bool broadcast (const registry_t &s, int count)
+        {
+            for (int i = 0; i < s.count(); i++) {
+                if (s.converting[i]) {
+                    return false;
+                }
+            }
+            return (count > 0) && ((2 * count) >= s.count());
+        }
+
+        // A sensor's job is done: release its next one. Returns how many deadlines it missed.
+        // A sensor that fell more than a whole period behind skips the jobs it has no time left for.
+        static uint32_t complete (registry_t &s, int i, uint32_t now)
+        {
+            uint32_t missed = before(deadline(s, i), now) ? 1 : 0;
+            s.converting[i] = false;
+            s.release[i] += s.period[i];
+            while (before(deadline(s, i), now)) {
+                s.release[i] += s.period[i];
+                missed++;
+            }
+            return missed;
+        }
+
+        // The next time anything happens on the bus: a conversion is done, or a job gets released.
+        // Returns 'idle' if that comes later (or the bus has no sensors).
+        static uint32_t nextEvent (const registry_t &s, uint32_t idle)
+        {
+            uint32_t next = idle;
+            for (int i = 0; i < s.count(); i++) {
+                uint32_t t = s.converting[i] ? s.ready[i] : s.release[i];
+                if (before(t, next)) {
+                    next = t;
+                }
+            }
+            return next;
+        }
+
+        // An insertion sort: the lists are short, and mostly in order already from the cycle before
+        static void sortByDeadline (const registry_t &s, uint16_t *slots, int n)
+        {
+            for (int k = 1; k < n; k++) {
+                uint16_t slot = slots[k];
+                uint32_t d = deadline(s, slot);
+                int j = k;
+                for (; (j > 0) && before(d, deadline(s, slots[j - 1])); j--) {
+                    slots[j] = slots[j - 1];
+                }
+                slots[j] = slot;
+            }
+        }
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+// The results of one benchmark, shared by the firmware's BENCHMARK build and host/tools/ptwd-bench.
+//
+// Each run's cost gets added, and print() sums them up as a single line of text:
+//   bench,<platform>,<name>,<unit>,<runs>,<min>,<median>,<max>
+// The names never contain a comma, so the lines can be picked out of the rest of the output and
+// split up by anything that reads CSV. The median is what to compare from one commit to the next:
+// a run that got interrupted can only ever make the maximum worse. 'ptwd-bench --compare' does the
+// comparing, for both the firmware's lines and the host's.
+//
+// 'per' is how many operations each run did: the costs get divided by it, rounded to the nearest.
+class Bench {
+    public:
+        static const uint32_t MAX_RUNS = 32;
+
+        Bench (const char *platform, const char *name, const char *unit, uint32_t per = 1) :
+            platform(platform), name(name), unit(unit), per(per), runs(0) {}
+
+        // Runs past MAX_RUNS get ignored
+        void add (uint64_t cost)
+        {
+            if (runs < MAX_RUNS) {
+                costs[runs++] = (cost + per / 2) / per;
+            }
+        }
+
+        bool full () const { return runs == MAX_RUNS; }
+
+        void print ()
+        {
+            if (runs == 0) {
+                printf("bench,%s,%s,%s,0,,,\n", platform, name, unit);
+                return;
+            }
+
+            // Insertion sort: there are never more than a few dozen
+            for (uint32_t i = 1; i < runs; i++) {
+                uint32_t c = costs[i];
+                uint32_t j = i;
+                for (; (j > 0) && (costs[j - 1] > c); j--) {
+                    costs[j] = costs[j - 1];
+                }
+                costs[j] = c;
+            }
+            printf("bench,%s,%s,%s,%u,%u,%u,%u\n", platform, name, unit, (unsigned)runs,
+                   (unsigned)costs[0], (unsigned)costs[runs / 2], (unsigned)costs[runs - 1]);
+        }
+
+    private:
+        const char *platform;
+        const char *name;
+        const char *unit;
+        uint32_t per;
+        uint32_t runs;
+        uint32_t costs[MAX_RUNS];
+};
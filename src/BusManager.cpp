@@ -0,0 +1,90 @@
+#include "BusManager.h"
+
+#include "Trace.h"
+#include "onewire_library.pio.h"        // generated by pioasm
+#include "onewire_triplet.pio.h"        // generated by pioasm
+
+// --------------------------------------------------------------------------------------------
+bool BusManager::loadProgram (uint32_t pio_index)
+{
+    if (pio_offset[pio_index] >= 0) {
+        return true;
+    }
+
+    PIO pio = pio_get_instance(pio_index);
+    if (!pio_can_add_program(pio, &onewire_program)) {
+        return false;
+    }
+    pio_offset[pio_index] = pio_add_program(pio, &onewire_program);
+
+    // Searches still work without the triplet program, just more slowly
+    if (pio_can_add_program(pio, &onewire_triplet_program)) {
+        triplet_offset[pio_index] = pio_add_program(pio, &onewire_triplet_program);
+    }
+    return true;
+}
+
+// --------------------------------------------------------------------------------------------
+// Buses get packed into the PIO blocks in order. Once a block has no state machines left
+// (or no room for the program), the next block gets used. State machines that someone
+// else already claimed (the CYW43 driver on the wireless boards, for example) get skipped.
+uint32_t BusManager::init (const uint32_t *gpios, uint32_t count)
+{
+    for (uint32_t p = 0; p < NUM_PIOS; p++) {
+        pio_offset[p] = -1;
+        triplet_offset[p] = -1;
+    }
+    bus_count = 0;
+
+    uint32_t pio_index = 0;
+    for (uint32_t i = 0; (i < count) && (bus_count < MAX_BUSES); i++) {
+        while (pio_index < NUM_PIOS) {
+            if (loadProgram(pio_index) &&
+                buses[bus_count].init(pio_get_instance(pio_index), pio_offset[pio_index], gpios[i],
+                                      triplet_offset[pio_index])) {
+                break;
+            }
+            pio_index++;
+        }
+        if (pio_index == NUM_PIOS) {
+            TRACE("%s: No PIO state machines left for the bus on GPIO %d\n", __FUNCTION__, gpios[i]);
+            break;
+        }
+
+        bus_gpio[bus_count] = gpios[i];
+        bus_count++;
+    }
+    return bus_count;
+}
+
+// --------------------------------------------------------------------------------------------
+void BusManager::clockChanged ()
+{
+    for (uint32_t i = 0; i < bus_count; i++) {
+        buses[i].clockChanged();
+    }
+}
+
+void BusManager::lock ()
+{
+    for (uint32_t i = 0; i < bus_count; i++) {
+        buses[i].lock();
+    }
+}
+
+void BusManager::unlock ()
+{
+    for (uint32_t i = bus_count; i > 0; i--) {
+        buses[i - 1].unlock();
+    }
+}
+
+bool BusManager::busy ()
+{
+    for (uint32_t i = 0; i < bus_count; i++) {
+        if (buses[i].busy()) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Onewire.h"
+
+// The BusManager runs one Onewire bus per GPIO, each on its own PIO state machine.
+// Every state machine in a PIO block runs the same onewire program, so the program only
+// gets loaded once into each PIO block that ends up being used. The onewire_triplet program
+// that speeds up ROM searches gets loaded next to it if there is room.
+class BusManager {
+    public:
+        // Every state machine can run a bus: 8 on an RP2040, 12 on an RP2350
+        static const uint32_t MAX_BUSES = NUM_PIOS * NUM_PIO_STATE_MACHINES;
+
+        // Create a bus for each of the 'count' GPIOs in 'gpios'.
+        // Returns the number of buses that could be created.
+        uint32_t init (const uint32_t *gpios, uint32_t count);
+
+        uint32_t count () { return bus_count; }
+        Onewire &bus (uint32_t index) { return buses[index]; }
+        uint32_t gpio (uint32_t index) { return bus_gpio[index]; }
+
+        // clk_sys changed: every bus has to re-derive its state machine's clock divider
+        void clockChanged ();
+
+        // Wait for every bus to get between operations, and keep them there until unlock().
+        // The locks get taken in bus order; a bus task only ever holds its own.
+        void lock ();
+        void unlock ();
+
+        // Some bus has a transaction in flight
+        bool busy ();
+
+    private:
+        bool loadProgram (uint32_t pio_index);
+
+        Onewire buses[MAX_BUSES];
+        uint32_t bus_gpio[MAX_BUSES];
+        uint32_t bus_count;
+
+        // Where the onewire program lives in each PIO block, or -1 if it has not been loaded there
+        int pio_offset[NUM_PIOS];
+
+        // Same for the triplet program
+        int triplet_offset[NUM_PIOS];
+};
@@ -0,0 +1,158 @@
+#include "ClockGovernor.h"
+
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/pll.h"
+
+#include "task.h"
+
+// VSYS on a Pico powered from USB
+static const uint32_t VSYS_MV = 5000;
+
+static const struct {
+    uint32_t hz;
+    uint32_t ma;
+} speeds[ClockGovernor::SPEED_COUNT] = {
+    {12 * MHZ,   3},
+    {48 * MHZ,   7},
+    {SYS_CLK_HZ, 16},
+};
+
+uint32_t ClockGovernor::hz (speed_t speed)
+{
+    return speeds[speed].hz;
+}
+
+// --------------------------------------------------------------------------------------------
+void ClockGovernor::init (speed_t idle, bool enabled, changed_t changed, hold_t hold)
+{
+    #if configSUPPORT_STATIC_ALLOCATION
+        mutex = xSemaphoreCreateMutexStatic(&mutex_buffer);
+    #else
+        mutex = xSemaphoreCreateMutex();
+    #endif
+
+    this->idle = idle;
+    this->enabled = enabled;
+    this->changed = changed;
+    this->hold = hold;
+    current = SPEED_FULL;
+    pll_sys_on = true;
+    pll_usb_on = true;
+    since_us = time_us_64();
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if (enabled) {
+        set(idle);
+    }
+    xSemaphoreGive(mutex);
+}
+
+void ClockGovernor::request (speed_t speed)
+{
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    votes[speed]++;
+    if (enabled && (speed > current)) {
+        set(speed);
+    }
+    xSemaphoreGive(mutex);
+}
+
+void ClockGovernor::release (speed_t speed)
+{
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    votes[speed]--;
+
+    // Fall back to the fastest speed that somebody still wants
+    speed_t wanted = idle;
+    for (int s = SPEED_COUNT - 1; s > idle; s--) {
+        if (votes[s] > 0) {
+            wanted = (speed_t)s;
+            break;
+        }
+    }
+    if (enabled && (wanted != current)) {
+        set(wanted);
+    }
+    xSemaphoreGive(mutex);
+}
+
+// --------------------------------------------------------------------------------------------
+// Called with the mutex held
+void ClockGovernor::account ()
+{
+    uint64_t now_us = time_us_64();
+    spent_us[current] += now_us - since_us;
+    since_us = now_us;
+}
+
+void ClockGovernor::set (speed_t speed)
+{
+    account();
+
+    // A PLL takes a while to lock, so get it going before switching over to it
+    if ((speed == SPEED_FULL) && !pll_sys_on) {
+        pll_init(pll_sys, PLL_SYS_REFDIV, PLL_SYS_VCO_FREQ_HZ, PLL_SYS_POSTDIV1, PLL_SYS_POSTDIV2);
+        pll_sys_on = true;
+    }
+    if ((speed >= SPEED_USB_PLL) && !pll_usb_on) {
+        pll_init(pll_usb, PLL_USB_REFDIV, PLL_USB_VCO_FREQ_HZ, PLL_USB_POSTDIV1, PLL_USB_POSTDIV2);
+        pll_usb_on = true;
+    }
+
+    static const uint32_t auxsrc[SPEED_COUNT] = {
+        CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_XOSC_CLKSRC,
+        CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB,
+        CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS,
+    };
+    uint32_t f = speeds[speed].hz;
+
+    // No bus may be in a time slot while the PIO runs on a divider meant for another clock.
+    // The critical section only covers this core, which is why the buses get held as well.
+    if (hold) {
+        hold(true);
+    }
+    taskENTER_CRITICAL();
+    clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX, auxsrc[speed], f, f);
+    clock_configure(clk_peri, 0, CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS, f, f);
+    if (changed) {
+        changed();
+    }
+    taskEXIT_CRITICAL();
+    if (hold) {
+        hold(false);
+    }
+
+    // Turning off the sysclk PLL saves 0.9 mA on a Pico2, and so does turning off the USB PLL
+    if ((speed < SPEED_FULL) && pll_sys_on) {
+        pll_deinit(pll_sys);
+        pll_sys_on = false;
+    }
+    if ((speed < SPEED_USB_PLL) && pll_usb_on) {
+        pll_deinit(pll_usb);
+        pll_usb_on = false;
+    }
+
+    current = speed;
+    change_count++;
+}
+
+// --------------------------------------------------------------------------------------------
+uint64_t ClockGovernor::time_us (speed_t speed)
+{
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    account();
+    uint64_t t = spent_us[speed];
+    xSemaphoreGive(mutex);
+    return t;
+}
+
+uint64_t ClockGovernor::energy_uJ ()
+{
+    // uSec x mA x mV is picojoules
+    uint64_t pJ = 0;
+    for (int s = 0; s < SPEED_COUNT; s++) {
+        pJ += time_us((speed_t)s) * speeds[s].ma * VSYS_MV;
+    }
+    return pJ / 1000000;
+}
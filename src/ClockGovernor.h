@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+// The ClockGovernor runs clk_sys as slowly as the work at hand allows. Tasks ask for the speed they
+// need while they are busy, and give it back when they go to sleep. The clock runs at the fastest
+// speed that anybody is asking for, or at the idle speed when nobody is.
+//
+// Each speed shuts down the PLLs that it does not need. Approximate average VSYS current on a Pico2:
+//   SPEED_XOSC      12 MHz    3 mA   (no sysPLL or usbPLL; XOSC is the source of the 12 MHz clock)
+//   SPEED_USB_PLL   48 MHz    7 mA   (no sysPLL; usbPLL is the source of the 48 MHz clock)
+//   SPEED_FULL     150 MHz   16 mA   (sysPLL and usbPLL running)
+// The governor keeps track of the time spent at each speed, which gives an estimate of the energy used.
+//
+// clk_ref and the timer stay on the XOSC, so time_us_64() does not notice a change, and neither does
+// the FreeRTOS tick (see configSYSTICK_CLOCK_HZ). The PIO state machines do: every change calls the
+// 'changed' callback, which has to re-derive their clock dividers. clock_configure() passes clk_sys
+// through clk_ref on the way, and the state machines run on their old dividers until 'changed' is
+// done, so their timing is off for several microseconds. That would corrupt any time slot in flight,
+// and a bus task on the other core can be in the middle of one. So every change is wrapped in calls
+// to the 'hold' callback, which has to keep the buses between transactions until it gets false.
+class ClockGovernor {
+    public:
+        typedef enum {
+            SPEED_XOSC,
+            SPEED_USB_PLL,
+            SPEED_FULL,
+            SPEED_COUNT
+        } speed_t;
+
+        typedef void (*changed_t) ();
+        typedef void (*hold_t) (bool hold);
+
+        // The clock starts out at the full speed that the boot code set up.
+        // 'enabled' false keeps it there, and only keeps track of the time.
+        // Whoever holds a bus in 'hold' must not be waiting for the governor at the same time.
+        void init (speed_t idle, bool enabled, changed_t changed, hold_t hold);
+
+        // Ask for at least 'speed' until the matching release()
+        void request (speed_t speed);
+        void release (speed_t speed);
+
+        static uint32_t hz (speed_t speed);
+
+        // Everything since init(): the time spent at 'speed', how many times the clock changed,
+        // and the energy used by the whole board according to the current table above.
+        uint64_t time_us (speed_t speed);
+        uint32_t changes () { return change_count; }
+        uint64_t energy_uJ ();
+
+    private:
+        void set (speed_t speed);
+        void account ();
+
+        SemaphoreHandle_t mutex;
+        #if configSUPPORT_STATIC_ALLOCATION
+            StaticSemaphore_t mutex_buffer;
+        #endif
+
+        bool enabled;
+        speed_t idle;
+        speed_t current;
+        changed_t changed;
+        hold_t hold;
+        uint32_t votes[SPEED_COUNT];
+        uint64_t since_us;
+        uint64_t spent_us[SPEED_COUNT];
+        uint32_t change_count;
+        bool pll_sys_on;
+        bool pll_usb_on;
+};
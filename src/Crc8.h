@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+
+// Dallas/Maxim CRC8 (polynomial x^8 + x^5 + x^4 + 1, bit-reversed to 0x8C), as used by Onewire
+// ROM codes and scratchpads. Data followed by its own CRC checks out as 0.
+// Kept in its own header so that host tools can use the same implementation as the target.
+//
+// There are three ways to work it out, which trade speed for table space:
+//   CRC8_BITWISE   shift and test one bit at a time: no table, 8 steps per byte
+//   CRC8_NIBBLE    two 16-entry tables: 32 bytes, 2 lookups per byte
+//   CRC8_TABLE     one 256-entry table: 256 bytes, 1 lookup per byte
+// The tables are const, so on the target they stay in flash and get read through the XIP cache.
+// crc8() uses the one picked by CRC8_METHOD. All three are always available, for ptwd-bench-crc.
+#define CRC8_BITWISE    0
+#define CRC8_NIBBLE     1
+#define CRC8_TABLE      2
+
+#ifndef CRC8_METHOD
+    #define CRC8_METHOD CRC8_TABLE
+#endif
+
+static inline uint8_t crc8_bitwise (const uint8_t *data, uint32_t len)
+{
+    uint8_t crc = 0;
+    while (len--) {
+        uint8_t b = *data++;
+        for (int i = 0; i < 8; i++) {
+            uint8_t mix = (crc ^ b) & 0x01;
+            crc >>= 1;
+            if (mix) {
+                crc ^= 0x8C;
+            }
+            b >>= 1;
+        }
+    }
+    return crc;
+}
+
+// The tables get worked out by the compiler from the bitwise version
+namespace Crc8Tables {
+    template <int N>
+    struct table_t {
+        uint8_t entry[N];
+    };
+
+    // What one byte of 'value' XORed into the CRC comes to, 8 bit steps later
+    constexpr uint8_t step (uint8_t value)
+    {
+        uint8_t crc = value;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x01) ? ((crc >> 1) ^ 0x8C) : (crc >> 1);
+        }
+        return crc;
+    }
+
+    template <int N, int SHIFT>
+    constexpr table_t<N> make ()
+    {
+        table_t<N> t = {};
+        for (int i = 0; i < N; i++) {
+            t.entry[i] = step(i << SHIFT);
+        }
+        return t;
+    }
+
+    // The CRC is linear, so a byte's two nibbles can be looked up separately and XORed together
+    inline constexpr table_t<16> low = make<16, 0>();
+    inline constexpr table_t<16> high = make<16, 4>();
+    inline constexpr table_t<256> bytes = make<256, 0>();
+}
+
+static inline uint8_t crc8_nibble (const uint8_t *data, uint32_t len)
+{
+    uint8_t crc = 0;
+    while (len--) {
+        uint8_t x = crc ^ *data++;
+        crc = Crc8Tables::low.entry[x & 0x0F] ^ Crc8Tables::high.entry[x >> 4];
+    }
+    return crc;
+}
+
+static inline uint8_t crc8_table (const uint8_t *data, uint32_t len)
+{
+    uint8_t crc = 0;
+    while (len--) {
+        crc = Crc8Tables::bytes.entry[crc ^ *data++];
+    }
+    return crc;
+}
+
+static inline uint8_t crc8 (const uint8_t *data, uint32_t len)
+{
+    #if CRC8_METHOD == CRC8_TABLE
+        return crc8_table(data, len);
+    #elif CRC8_METHOD == CRC8_NIBBLE
+        return crc8_nibble(data, len);
+    #else
+        return crc8_bitwise(data, len);
+    #endif
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+
+#if PICO_RP2350
+    #include "hardware/structs/m33.h"
+#else
+    #include "hardware/structs/systick.h"
+#endif
+
+// Counts clk_sys cycles on the calling core, for the benchmarks.
+//
+// The RP2350's Cortex-M33 has a DWT cycle counter, which just gets turned on. The RP2040's
+// Cortex-M0+ has no such thing, so its 24-bit SysTick counter stands in: at 125 MHz, it wraps
+// every 134 mSec, which the 1 MHz timer is plenty to count. That core's SysTick must not be the
+// FreeRTOS tick on a tickless build, since the tick gets reloaded with odd counts as it sleeps.
+// The acquisition core does not run the tick, so init() gets SysTick going there all by itself.
+//
+// Each core has a counter of its own: init() and every measurement must all run on the same one.
+// Measurements are good for about 28 seconds at 150 MHz.
+class CycleCounter {
+    public:
+        typedef struct {
+            uint32_t count;
+            uint32_t us;
+        } snapshot_t;
+
+        // Which chip the counts come from, for the benchmark results
+        #if PICO_RP2350
+            static constexpr const char *PLATFORM = "rp2350";
+        #else
+            static constexpr const char *PLATFORM = "rp2040";
+        #endif
+
+        static void init ()
+        {
+            #if PICO_RP2350
+                m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+                m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+            #else
+                if (!(systick_hw->csr & SYSTICK_ENABLE)) {
+                    systick_hw->rvr = SYSTICK_MAX;
+                    systick_hw->cvr = 0;
+                    systick_hw->csr = SYSTICK_ENABLE | SYSTICK_PROCESSOR_CLOCK;
+                }
+            #endif
+        }
+
+        static snapshot_t now ()
+        {
+            #if PICO_RP2350
+                return {m33_hw->dwt_cyccnt, 0};
+            #else
+                // The timer read comes second, so it can only ever be ahead of the count
+                uint32_t count = systick_hw->cvr;
+                return {count, time_us_32()};
+            #endif
+        }
+
+        // The cycles from 'start' to now
+        static uint32_t since (const snapshot_t &start)
+        {
+            snapshot_t end = now();
+            #if PICO_RP2350
+                return end.count - start.count;
+            #else
+                // SysTick counts down, and takes 'period' cycles to come back around. The timer
+                // says roughly how many times it did, and the counts make up the exact remainder.
+                uint32_t period = systick_hw->rvr + 1;
+                uint32_t part = (start.count + period - end.count) % period;
+                uint32_t expected = (end.us - start.us) * (clock_get_hz(clk_sys) / MHZ);
+                uint32_t wraps = (expected > part) ? (expected - part + period / 2) / period : 0;
+                return wraps * period + part;
+            #endif
+        }
+
+    private:
+        #if !PICO_RP2350
+            static const uint32_t SYSTICK_ENABLE = 1u << 0;
+            static const uint32_t SYSTICK_PROCESSOR_CLOCK = 1u << 2;
+            static const uint32_t SYSTICK_MAX = 0x00FFFFFF;
+        #endif
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Temperature.h"
+#include "ds18b20.h"
+
+// The drivers for the temperature sensors that can share a bus, by family: the low byte of a
+// device's ROM code. They all take the DS18B20's function commands, but their scratchpads differ:
+//   DS18B20    9 to 12 bits, set by its configuration register
+//   DS1822     a DS18B20 with looser accuracy, and the same scratchpad
+//   DS18S20    9 bits (half degrees), and no configuration register. COUNT_REMAIN makes up the rest
+//              of a 1/16 C reading, so a reading takes 7 scratchpad bytes instead of 2.
+//
+// Each driver is a specialization of SensorDriver, with everything about its family known at compile
+// time. The sensor table keeps each sensor's family as an index into DeviceFamily::CODES. The bus task
+// sorts the sensors it reads into one group per family, and reads each group with code built for that
+// family alone: there is no switch on the family and no virtual call for each reading. Every driver
+// turns its scratchpad into the same Temperature::raw_t, in 1/16 C.
+//
+// One SKIP_ROM + CONVERT_T starts a conversion in every family at once, so the conversions do not
+// need grouping. A DS18S20 always takes 750 mSec, like a DS18B20 at 12 bits.
+template <uint8_t FAMILY>
+struct SensorDriver;
+
+template <>
+struct SensorDriver<DS18B20_FAMILY> {
+    static constexpr const char *NAME = "DS18B20";
+
+    // The scratchpad bytes that a reading needs, from byte 0
+    static const uint32_t READ_BYTES = 2;
+
+    // Whether there is a configuration register, which WRITE_SCRATCHPAD takes after TH and TL
+    static const bool CONFIGURABLE = true;
+
+    // The resolution that the sensor runs at when 'wanted' is asked for
+    static uint8_t resolution (uint8_t wanted) { return wanted; }
+
+    static Temperature::raw_t normalize (const uint8_t *scratchpad, uint8_t resolution)
+    {
+        // The bits below the sensor's resolution are undefined.
+        // Clearing them rounds negative temperatures down, the same as positive ones.
+        int16_t undefined = (1 << (12 - resolution)) - 1;
+        return (int16_t)(scratchpad[0] | (scratchpad[1] << 8)) & ~undefined;
+    }
+
+    // Whether a whole scratchpad holds the power-on value: the sensor lost power after its
+    // conversion started. A real reading of 85 C has 0x10 in byte 6 instead.
+    static bool powerOn (const uint8_t *scratchpad)
+    {
+        return (scratchpad[0] == DS18B20_POWER_ON_LSB) && (scratchpad[1] == DS18B20_POWER_ON_MSB) &&
+               (scratchpad[DS18B20_SCRATCHPAD_COUNT_REMAIN] == DS18B20_POWER_ON_COUNT_REMAIN);
+    }
+};
+
+template <>
+struct SensorDriver<DS1822_FAMILY> : SensorDriver<DS18B20_FAMILY> {
+    static constexpr const char *NAME = "DS1822";
+};
+
+template <>
+struct SensorDriver<DS18S20_FAMILY> {
+    static constexpr const char *NAME = "DS18S20";
+
+    // Up to and including COUNT_REMAIN. COUNT_PER_C is always 16, so there is no need to read it.
+    static const uint32_t READ_BYTES = DS18B20_SCRATCHPAD_COUNT_REMAIN + 1;
+
+    static const bool CONFIGURABLE = false;
+
+    // A 1/16 C reading that takes 750 mSec: as far as the rest of the firmware knows, 12 bits
+    static uint8_t resolution (uint8_t) { return 12; }
+
+    // The datasheet's extended resolution reading,
+    //   TEMP_READ - 0.25 + (COUNT_PER_C - COUNT_REMAIN) / COUNT_PER_C
+    // where TEMP_READ is the reading with its half degree bit dropped, in 1/16 C
+    static Temperature::raw_t normalize (const uint8_t *scratchpad, uint8_t)
+    {
+        int16_t half_degrees = (int16_t)(scratchpad[0] | (scratchpad[1] << 8));
+        return (half_degrees >> 1) * Temperature::RAW_PER_C - Temperature::RAW_PER_C / 4 +
+               (DS18S20_COUNT_PER_C - scratchpad[DS18B20_SCRATCHPAD_COUNT_REMAIN]);
+    }
+
+    // COUNT_REMAIN comes up as 0x0C, just like a DS18B20's. A DS18S20 that really is at 85.00 C
+    // reads exactly the same, though, so that reading gets dropped too.
+    static bool powerOn (const uint8_t *scratchpad)
+    {
+        return (scratchpad[0] == DS18S20_POWER_ON_LSB) && (scratchpad[1] == DS18S20_POWER_ON_MSB) &&
+               (scratchpad[DS18B20_SCRATCHPAD_COUNT_REMAIN] == DS18B20_POWER_ON_COUNT_REMAIN);
+    }
+};
+
+// The families that have a driver, and the sorting of sensors into groups by family
+class DeviceFamily {
+    public:
+        // A family's index in here is what the sensor table keeps for each sensor
+        static constexpr uint8_t CODES[] = {DS18B20_FAMILY, DS1822_FAMILY, DS18S20_FAMILY};
+        static const int COUNT = sizeof(CODES);
+        static const int UNSUPPORTED = -1;
+
+        // The driver of the family with index F
+        template <int F>
+        using driver_t = SensorDriver<CODES[F]>;
+
+        // The index of the family of device 'rom', or UNSUPPORTED if there is no driver for it
+        static int of (uint64_t rom)
+        {
+            for (int f = 0; f < COUNT; f++) {
+                if (CODES[f] == (uint8_t)rom) {
+                    return f;
+                }
+            }
+            return UNSUPPORTED;
+        }
+
+        // Sort 'count' slots into one group per family, given the family of every slot, and keep
+        // their order within each group. The group of family f is grouped[first[f]] up to, but not
+        // including, grouped[first[f + 1]]. 'first' has room for COUNT + 1 entries.
+        static void group (const uint8_t *family, const uint16_t *slots, int count, uint16_t *grouped, int *first)
+        {
+            int next[COUNT] = {};
+            for (int c = 0; c < count; c++) {
+                next[family[slots[c]]]++;
+            }
+            first[0] = 0;
+            for (int f = 0; f < COUNT; f++) {
+                first[f + 1] = first[f] + next[f];
+                next[f] = first[f];
+            }
+            for (int c = 0; c < count; c++) {
+                grouped[next[family[slots[c]]]++] = slots[c];
+            }
+        }
+};
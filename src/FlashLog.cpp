@@ -0,0 +1,250 @@
+#include "FlashLog.h"
+
+#include <string.h>
+
+#include "pico/flash.h"
+#include "SEGGER_RTT.h"
+
+#include "Telemetry.h"
+#include "Trace.h"
+
+// --------------------------------------------------------------------------------------------
+bool FlashLog::validSector (const uint8_t *sector, uint32_t *sequence)
+{
+    LogFormat::sector_header_t header;
+    memcpy(&header, sector, sizeof(header));
+    *sequence = header.sequence;
+    return header.magic == LogFormat::MAGIC;
+}
+
+// The log carries on from the first blank page of the newest sector. Every page that got
+// programmed starts with a header or a record, so it cannot start with a blank byte.
+bool FlashLog::init ()
+{
+    const uint8_t *region = (const uint8_t *)(XIP_BASE + FLASH_OFFSET);
+    bool found = false;
+    uint32_t newest = 0;
+    sequence = 0;
+    for (uint32_t s = 0; s < SIZE; s += FLASH_SECTOR_SIZE) {
+        uint32_t seq;
+        if (validSector(&region[s], &seq) && (!found || ((int32_t)(seq - sequence) > 0))) {
+            found = true;
+            sequence = seq;
+            newest = s;
+        }
+    }
+
+    next_offset = 0;
+    if (found) {
+        next_offset = (newest + FLASH_SECTOR_SIZE) % SIZE;
+        for (uint32_t p = newest + FLASH_PAGE_SIZE; p < newest + FLASH_SECTOR_SIZE; p += FLASH_PAGE_SIZE) {
+            if (region[p] == LogFormat::BLANK) {
+                next_offset = p;
+                break;
+            }
+        }
+    }
+
+    page = nullptr;
+    fill = 0;
+    pages_used = 0;
+    count_pos = 0;
+    for (uint32_t b = 0; b < BusManager::MAX_BUSES; b++) {
+        keyframe_due[b] = true;
+        last_time_ms[b] = 0;
+    }
+
+    if (room(1)) {
+        page->data[fill++] = LogFormat::tag(LogFormat::TYPE_BOOT, 0);
+    }
+
+    return SEGGER_RTT_ConfigUpBuffer(RTT_BUFFER, "ptwd-log", rtt_buffer, sizeof(rtt_buffer),
+                                     SEGGER_RTT_MODE_BLOCK_IF_FIFO_FULL) >= 0;
+}
+
+// --------------------------------------------------------------------------------------------
+// Make sure that the page being filled has room for 'bytes' more, handing it over and starting
+// the next one if it does not. Returns false if the writer has no free page for us.
+bool FlashLog::room (uint32_t bytes)
+{
+    if (page && ((fill + bytes) <= FLASH_PAGE_SIZE)) {
+        return true;
+    }
+    flush();
+
+    page = pages.reserve();
+    if (!page) {
+        // Whatever gets logged until a page comes free is lost, so the changes after it would be
+        // relative to readings the extractor never saw
+        for (uint32_t b = 0; b < BusManager::MAX_BUSES; b++) {
+            keyframe_due[b] = true;
+        }
+        return false;
+    }
+
+    page->offset = next_offset;
+    next_offset = (next_offset + FLASH_PAGE_SIZE) % SIZE;
+    memset(page->data, LogFormat::BLANK, sizeof(page->data));
+    fill = 0;
+
+    if ((page->offset % FLASH_SECTOR_SIZE) == 0) {
+        LogFormat::sector_header_t header = {LogFormat::MAGIC, ++sequence};
+        memcpy(page->data, &header, sizeof(header));
+        fill = sizeof(header);
+        for (uint32_t b = 0; b < BusManager::MAX_BUSES; b++) {
+            keyframe_due[b] = true;
+        }
+    }
+    return true;
+}
+
+void FlashLog::flush ()
+{
+    endRecord();
+    if (page) {
+        pages.commit();
+        page = nullptr;
+        pages_used++;
+        fill = 0;
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+// Records get built in place in the page. One that runs out of page (or entries) gets ended, and
+// carries on as a new record in the next page: a change record with a time difference of 0, or a
+// keyframe that starts from the next slot.
+bool FlashLog::startRecord ()
+{
+    uint32_t entry = (record_type == LogFormat::TYPE_KEYFRAME) ? LogFormat::MAX_KEY_SIZE : LogFormat::MAX_CHANGE_SIZE;
+    if (!room(LogFormat::MAX_HEADER_SIZE + entry)) {
+        return false;
+    }
+
+    uint8_t *p = page->data;
+    p[fill++] = LogFormat::tag(record_type, record_bus);
+    if (record_type == LogFormat::TYPE_KEYFRAME) {
+        for (int i = 0; i < 4; i++) {
+            p[fill++] = record_time_ms >> (8 * i);
+        }
+        fill += Telemetry::putVarint(&p[fill], next_slot);
+    }
+    else {
+        fill += Telemetry::putVarint(&p[fill], record_time_ms - last_time_ms[record_bus]);
+    }
+    last_time_ms[record_bus] = record_time_ms;
+
+    count_pos = fill++;
+    count = 0;
+    prev_slot = -1;
+    return true;
+}
+
+bool FlashLog::openEntry (uint32_t bytes)
+{
+    if (count_pos && (count < LogFormat::MAX_COUNT) && ((fill + bytes) <= FLASH_PAGE_SIZE)) {
+        return true;
+    }
+    endRecord();
+    return startRecord();
+}
+
+void FlashLog::endRecord ()
+{
+    if (count_pos) {
+        page->data[count_pos] = count;
+        count_pos = 0;
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+void FlashLog::beginKeyframe (uint32_t bus, uint32_t time_ms)
+{
+    record_type = LogFormat::TYPE_KEYFRAME;
+    record_bus = bus;
+    record_time_ms = time_ms;
+    next_slot = 0;
+
+    // A bus without any sensors still gets an empty keyframe.
+    // One that starts a new sector is all that sector needs.
+    keyframe_due[bus] = !startRecord();
+}
+
+void FlashLog::addKey (uint64_t rom, int32_t raw)
+{
+    if (openEntry(LogFormat::MAX_KEY_SIZE)) {
+        uint8_t *p = page->data;
+        for (int b = 0; b < 8; b++) {
+            p[fill++] = rom >> (8 * b);
+        }
+        fill += Telemetry::putVarint(&p[fill], Telemetry::zigzag(raw));
+        count++;
+    }
+    next_slot++;
+}
+
+void FlashLog::beginChanges (uint32_t bus, uint32_t time_ms)
+{
+    record_type = LogFormat::TYPE_CHANGES;
+    record_bus = bus;
+    record_time_ms = time_ms;
+}
+
+void FlashLog::addChange (uint32_t slot, int32_t delta)
+{
+    if (openEntry(LogFormat::MAX_CHANGE_SIZE)) {
+        uint8_t *p = page->data;
+        fill += Telemetry::putVarint(&p[fill], slot - prev_slot - 1);
+        fill += Telemetry::putVarint(&p[fill], Telemetry::zigzag(delta));
+        prev_slot = slot;
+        count++;
+    }
+}
+
+void FlashLog::end ()
+{
+    endRecord();
+}
+
+// --------------------------------------------------------------------------------------------
+// Runs with interrupts disabled and the other core locked out
+void FlashLog::writePage (void *param)
+{
+    const page_t *p = (const page_t *)param;
+
+    if ((p->offset % FLASH_SECTOR_SIZE) == 0) {
+        flash_range_erase(FLASH_OFFSET + p->offset, FLASH_SECTOR_SIZE);
+    }
+    flash_range_program(FLASH_OFFSET + p->offset, p->data, FLASH_PAGE_SIZE);
+}
+
+void FlashLog::write ()
+{
+    const page_t *first;
+    for (uint32_t n = pages.peek(first); n > 0; n = pages.peek(first)) {
+        for (uint32_t i = 0; i < n; i++) {
+            if (flash_safe_execute(writePage, (void *)&first[i], 100) != PICO_OK) {
+                write_errors.store(writeErrors() + 1, std::memory_order_relaxed);
+                TRACE("%s: Unable to write the log to flash\n", __FUNCTION__);
+                continue;
+            }
+            if ((first[i].offset % FLASH_SECTOR_SIZE) == 0) {
+                sectors_erased.store(sectorsErased() + 1, std::memory_order_relaxed);
+            }
+            pages_written.store(pagesWritten() + 1, std::memory_order_relaxed);
+        }
+        pages.release(n);
+    }
+}
+
+// The sectors go out in the order they lie in flash: the extractor puts them in order by sequence.
+// Sectors that have never been used get left out.
+void FlashLog::dump ()
+{
+    const uint8_t *region = (const uint8_t *)(XIP_BASE + FLASH_OFFSET);
+    for (uint32_t s = 0; s < SIZE; s += FLASH_SECTOR_SIZE) {
+        uint32_t seq;
+        if (validSector(&region[s], &seq)) {
+            SEGGER_RTT_Write(RTT_BUFFER, &region[s], FLASH_SECTOR_SIZE);
+        }
+    }
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "hardware/flash.h"
+
+#include "BusManager.h"
+#include "LogFormat.h"
+#include "RomStore.h"
+#include "SampleRing.h"
+
+// The size of the flash log, just below the RomStore's sector at the end of flash.
+// It must be a whole number of sectors, and at least 2 of them.
+#ifndef FLASH_LOG_SIZE
+    #define FLASH_LOG_SIZE (512 * 1024)
+#endif
+
+// The FlashLog keeps a history of the readings in a reserved region of flash, so that it survives
+// a power cycle and can be read out later. See LogFormat.h for the format.
+//
+// The region is used as a ring of sectors. The oldest sector gets erased just before it is
+// reused, so every sector gets erased exactly once per pass through the ring, and they all wear
+// at the same rate.
+//
+// The report task builds the records, a whole flash page at a time, and hands the finished pages
+// to the log task through a SampleRing. The log task does the erasing and programming with
+// flash_safe_execute(), which parks the other core while the flash is off the XIP bus. That holds
+// off interrupts for up to the 45 mSec of a sector erase, so the FreeRTOS tick count drops behind
+// by that much once every sector. If the log task falls so far behind that the ring is full,
+// whole pages get dropped, and the next records for every bus are keyframes.
+//
+// dump() sends every sector in the region over an RTT up-buffer, for the host's ptwd-log tool.
+class FlashLog {
+    public:
+        static const uint32_t SIZE = FLASH_LOG_SIZE;
+        static const uint32_t FLASH_OFFSET = RomStore::FLASH_OFFSET - SIZE;
+
+        static_assert((SIZE % FLASH_SECTOR_SIZE) == 0, "FLASH_LOG_SIZE must be a whole number of sectors");
+        static_assert(SIZE >= 2 * FLASH_SECTOR_SIZE, "FLASH_LOG_SIZE must be at least 2 sectors");
+
+        // stdio owns RTT up-buffer 0, and the telemetry has buffer 1
+        static constexpr unsigned RTT_BUFFER = 2;
+
+        // Find where the log left off before this boot, and start the new boot there.
+        // Returns false if the RTT buffer could not be set up.
+        bool init ();
+
+        // ------------------------------------------------------------------------------------
+        // The producer side: only ever one task
+
+        // A keyframe lists every sensor on a bus, in slot order, with its raw reading or LogFormat::NO_READING.
+        // A change record lists the sensors whose reading changed since the bus's previous record,
+        // in slot order. Either one ends with end(). A change record without any changes takes no space.
+        void beginKeyframe (uint32_t bus, uint32_t time_ms);
+        void addKey (uint64_t rom, int32_t raw);
+        void beginChanges (uint32_t bus, uint32_t time_ms);
+        void addChange (uint32_t slot, int32_t delta);
+        void end ();
+
+        // True when the next record for the bus has to be a keyframe: at boot, at the start of
+        // each sector, and after a page got dropped
+        bool keyframeDue (uint32_t bus) const { return keyframe_due[bus]; }
+
+        // Hand over the page being filled, even though it is not full yet
+        void flush ();
+
+        // The flash space used since boot, counting the unused ends of pages
+        uint32_t bytesUsed () const { return pages_used * FLASH_PAGE_SIZE + fill; }
+        uint32_t droppedPages () const { return pages.overflowCount(); }
+
+        // ------------------------------------------------------------------------------------
+        // The writer side: only ever one task
+
+        // Program every page that has been handed over
+        void write ();
+
+        // Send every sector of the log over RTT. This waits for the host to read it all.
+        void dump ();
+
+        uint32_t pagesWritten () const { return pages_written.load(std::memory_order_relaxed); }
+        uint32_t sectorsErased () const { return sectors_erased.load(std::memory_order_relaxed); }
+        uint32_t writeErrors () const { return write_errors.load(std::memory_order_relaxed); }
+
+    private:
+        typedef struct {
+            uint32_t offset;                    // from the start of the region
+            uint8_t data[FLASH_PAGE_SIZE];
+        } page_t;
+
+        static void writePage (void *param);
+        static bool validSector (const uint8_t *sector, uint32_t *sequence);
+
+        bool room (uint32_t bytes);
+        bool startRecord ();
+        bool openEntry (uint32_t bytes);
+        void endRecord ();
+
+        SampleRing<page_t, 4> pages;
+
+        // The producer's own
+        page_t *page;                           // the page being filled, or nullptr
+        uint32_t fill;                          // bytes used in 'page'
+        uint32_t next_offset;                   // where the next page goes
+        uint32_t sequence;                      // of the newest sector
+        uint32_t pages_used;
+        bool keyframe_due[BusManager::MAX_BUSES];
+        uint32_t last_time_ms[BusManager::MAX_BUSES];
+
+        // The record being built
+        uint8_t record_type;
+        uint32_t record_bus;
+        uint32_t record_time_ms;
+        uint32_t count_pos;                     // where its count goes in 'page', or 0 if no record is open
+        uint32_t count;
+        int32_t prev_slot;                      // change records: the slot of the previous entry
+        uint32_t next_slot;                     // keyframes: the slot of the next entry
+
+        // Only the writer writes these
+        std::atomic<uint32_t> pages_written {0};
+        std::atomic<uint32_t> sectors_erased {0};
+        std::atomic<uint32_t> write_errors {0};
+
+        uint8_t rtt_buffer[1024];
+};
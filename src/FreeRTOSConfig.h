@@ -42,10 +42,30 @@
 
 /* Scheduler Related */
 #define configUSE_PREEMPTION                    1
+/* Tickless idle: building with -DTICKLESS_IDLE=0 keeps the tick running all the time.
+   Otherwise the tick core stops it whenever nothing is due for a while: the kernel calls
+   vApplicationSleep() in main.cpp instead of the port's own tickless code (see TicklessIdle.h). */
+#ifndef TICKLESS_IDLE
+    #define TICKLESS_IDLE                       1
+#endif
+#if TICKLESS_IDLE
+#define configUSE_TICKLESS_IDLE                 2
+#ifndef __ASSEMBLER__
+    #ifdef __cplusplus
+    extern "C"
+    #endif
+    void vApplicationSleep (uint32_t xExpectedIdleTime);
+#endif
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime )   vApplicationSleep( xExpectedIdleTime )
+#else
 #define configUSE_TICKLESS_IDLE                 0
+#endif
 #define configUSE_IDLE_HOOK                     1
 #define configUSE_TICK_HOOK                     0
 #define configTICK_RATE_HZ                      ( ( TickType_t ) 1000 )
+/* SysTick counts the 1 MHz reference tick instead of clk_sys, so the tick rate stays right when
+   the ClockGovernor changes clk_sys. The reference is derived from clk_ref, which stays on the XOSC. */
+#define configSYSTICK_CLOCK_HZ                  ( 1000000UL )
 #define configMAX_PRIORITIES                    32
 #define configMINIMAL_STACK_SIZE                ( configSTACK_DEPTH_TYPE ) 1024
 #define configUSE_16_BIT_TICKS                  0
@@ -64,15 +84,27 @@
 // todo need this for lwip FreeRTOS sys_arch to compile
 #define configENABLE_BACKWARD_COMPATIBILITY     1
 #define configNUM_THREAD_LOCAL_STORAGE_POINTERS 5
+/* Index 0 is left for the application, index 1 signals Onewire transaction completion */
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES   2
 
 /* System */
 #define configSTACK_DEPTH_TYPE                  uint32_t
 #define configMESSAGE_BUFFER_LENGTH_TYPE        size_t
 
-/* Memory allocation related definitions. */
+/* Memory allocation related definitions.
+   Building with -DSTATIC_ALLOCATION=1 creates every task and kernel object from statically sized
+   memory (see StaticTasks.h), and there is no heap at all. */
+#ifndef STATIC_ALLOCATION
+    #define STATIC_ALLOCATION                   0
+#endif
+#if STATIC_ALLOCATION
+#define configSUPPORT_STATIC_ALLOCATION         1
+#define configSUPPORT_DYNAMIC_ALLOCATION        0
+#else
 #define configSUPPORT_STATIC_ALLOCATION         0
 #define configSUPPORT_DYNAMIC_ALLOCATION        1
 #define configTOTAL_HEAP_SIZE                   (128*1024)
+#endif
 #define configAPPLICATION_ALLOCATED_HEAP        0
 
 /* Hook function related definitions. */
@@ -81,10 +113,22 @@
 #define configUSE_DAEMON_TASK_STARTUP_HOOK      0
 
 /* Run time and task stats gathering related definitions. */
-#define configGENERATE_RUN_TIME_STATS           0
+#define configGENERATE_RUN_TIME_STATS           1
 #define configUSE_TRACE_FACILITY                1
 #define configUSE_STATS_FORMATTING_FUNCTIONS    0
 
+/* The run time counter is the free-running 64-bit uSec timer: it needs no setup, and never wraps.
+   TaskStats.cpp formats the results, so the kernel's formatting functions stay out. */
+#define configRUN_TIME_COUNTER_TYPE             uint64_t
+#ifndef __ASSEMBLER__
+    #ifdef __cplusplus
+    extern "C"
+    #endif
+    uint64_t ptwdRunTimeCounter (void);
+#endif
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE()        ptwdRunTimeCounter()
+
 /* Co-routine related definitions. */
 #define configUSE_CO_ROUTINES                   0
 #define configMAX_CO_ROUTINE_PRIORITIES         1
@@ -119,6 +163,8 @@
 #define configENABLE_MPU                        0
 #define configENABLE_TRUSTZONE                  0
 #define configRUN_FREERTOS_SECURE_ONLY          1
+/* The FPU context does not get saved on a task switch, so no task may use float or double.
+   Temperatures are all integer arithmetic: see Temperature.h */
 #define configENABLE_FPU                        0
 
 /* As of right now this is the only value of configMAX_SYSCALL_INTERRUPT_PRIORITY that has been tested */
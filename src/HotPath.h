@@ -0,0 +1,23 @@
+#pragma once
+
+#include "pico/stdlib.h"
+
+// Building with RAM_HOT_PATH=1 runs the bus hot path out of SRAM instead of XIP flash: the Onewire
+// driver and the acquisition loop (HOT_PATH() below), and with -DPTWD_RAM_HOT_PATH=ON the kernel's
+// context switch, tick and task notifications as well (see KernelHotPath.h).
+//
+// Otherwise, every instruction gets fetched through the XIP cache, which the two cores share. The
+// report task on the other core can evict the bus task's code at any time, and each miss stalls the
+// core for a QSPI read in the middle of a bus transaction. The XipCache counters in the stats show
+// how many misses there are, and the acquisition latency and scan jitter what they cost.
+#ifndef RAM_HOT_PATH
+    #define RAM_HOT_PATH 0
+#endif
+
+// Wraps the name of a function definition, like the SDK's __not_in_flash_func(). The code gets
+// copied from flash to SRAM at boot, along with the rest of the .time_critical sections.
+#if RAM_HOT_PATH
+    #define HOT_PATH(func_name) __not_in_flash_func(func_name)
+#else
+    #define HOT_PATH(func_name) func_name
+#endif
@@ -0,0 +1,52 @@
+// Forced into the FreeRTOS kernel's tasks.c, queue.c, list.c and port sources by -DPTWD_RAM_HOT_PATH=ON (see
+// CMakeLists.txt), so that the kernel's hot path runs from SRAM without touching the kernel sources.
+//
+// A section attribute on a declaration carries over to the function's definition, and the kernel's
+// own declarations do not have one (PRIVILEGED_FUNCTION is empty without the MPU). The SDK's linker
+// scripts copy every .time_critical section to SRAM at boot. A function that does not exist in this
+// port just never gets defined.
+#pragma once
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "list.h"
+
+#define KERNEL_HOT_PATH(func_name) __attribute__((section(".time_critical.kernel." #func_name)))
+
+// The context switch and the tick
+void vTaskSwitchContext (BaseType_t xCoreID) KERNEL_HOT_PATH(vTaskSwitchContext);
+BaseType_t xTaskIncrementTick (void) KERNEL_HOT_PATH(xTaskIncrementTick);
+void xPortPendSVHandler (void) KERNEL_HOT_PATH(xPortPendSVHandler);
+void xPortSysTickHandler (void) KERNEL_HOT_PATH(xPortSysTickHandler);
+void vTaskEnterCritical (void) KERNEL_HOT_PATH(vTaskEnterCritical);
+void vTaskExitCritical (void) KERNEL_HOT_PATH(vTaskExitCritical);
+
+// What a bus transaction does: the DMA interrupt notifies the bus task, which was waiting for it
+BaseType_t xTaskGenericNotify (TaskHandle_t xTaskToNotify, UBaseType_t uxIndexToNotify, uint32_t ulValue,
+                               eNotifyAction eAction, uint32_t *pulPreviousNotificationValue)
+    KERNEL_HOT_PATH(xTaskGenericNotify);
+void vTaskGenericNotifyGiveFromISR (TaskHandle_t xTaskToNotify, UBaseType_t uxIndexToNotify,
+                                    BaseType_t *pxHigherPriorityTaskWoken)
+    KERNEL_HOT_PATH(vTaskGenericNotifyGiveFromISR);
+uint32_t ulTaskGenericNotifyTake (UBaseType_t uxIndexToWaitOn, BaseType_t xClearCountOnExit, TickType_t xTicksToWait)
+    KERNEL_HOT_PATH(ulTaskGenericNotifyTake);
+uint32_t ulTaskGenericNotifyValueClear (TaskHandle_t xTask, UBaseType_t uxIndexToClear, uint32_t ulBitsToClear)
+    KERNEL_HOT_PATH(ulTaskGenericNotifyValueClear);
+TaskHandle_t xTaskGetCurrentTaskHandle (void) KERNEL_HOT_PATH(xTaskGetCurrentTaskHandle);
+TickType_t xTaskGetTickCount (void) KERNEL_HOT_PATH(xTaskGetTickCount);
+BaseType_t xTaskDelayUntil (TickType_t *const pxPreviousWakeTime, const TickType_t xTimeIncrement)
+    KERNEL_HOT_PATH(xTaskDelayUntil);
+
+// Every bus operation takes and gives the bus's lock, which hardly ever has to wait
+BaseType_t xQueueSemaphoreTake (QueueHandle_t xQueue, TickType_t xTicksToWait) KERNEL_HOT_PATH(xQueueSemaphoreTake);
+BaseType_t xQueueGenericSend (QueueHandle_t xQueue, const void *const pvItemToQueue, TickType_t xTicksToWait,
+                              const BaseType_t xCopyPosition)
+    KERNEL_HOT_PATH(xQueueGenericSend);
+BaseType_t xTaskPriorityInherit (TaskHandle_t const pxMutexHolder) KERNEL_HOT_PATH(xTaskPriorityInherit);
+BaseType_t xTaskPriorityDisinherit (TaskHandle_t const pxMutexHolder) KERNEL_HOT_PATH(xTaskPriorityDisinherit);
+
+// The ready and delayed lists that all of those work on
+void vListInsertEnd (List_t *const pxList, ListItem_t *const pxNewListItem) KERNEL_HOT_PATH(vListInsertEnd);
+void vListInsert (List_t *const pxList, ListItem_t *const pxNewListItem) KERNEL_HOT_PATH(vListInsert);
+UBaseType_t uxListRemove (ListItem_t *const pxItemToRemove) KERNEL_HOT_PATH(uxListRemove);
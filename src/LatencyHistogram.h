@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+// A latency histogram that is cheap enough to leave running all the time: recording a latency
+// is a count-leading-zeros and an increment. Bucket 'i' counts latencies from 2^i up to 2^(i+1)
+// uSec (bucket 0 also gets 0 uSec), and the last bucket gets everything longer.
+//
+// Only one task may record into a histogram, but any task can read it at the same time.
+// Like SampleRing, each counter only ever has one writer, so no locks or atomic read-modify-write
+// are needed. A reader might see a count that is one sample behind, which does not matter here.
+class LatencyHistogram {
+    public:
+        // The last bucket starts at 2^19 uSec, about half a second
+        static const uint32_t BUCKETS = 20;
+
+        void record (uint32_t us)
+        {
+            uint32_t b = (us == 0) ? 0 : 31 - __builtin_clz(us);
+            if (b >= BUCKETS) {
+                b = BUCKETS - 1;
+            }
+            counts[b].store(counts[b].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            if (us > max.load(std::memory_order_relaxed)) {
+                max.store(us, std::memory_order_relaxed);
+            }
+        }
+
+        uint32_t count () const
+        {
+            uint32_t n = 0;
+            for (uint32_t b = 0; b < BUCKETS; b++) {
+                n += counts[b].load(std::memory_order_relaxed);
+            }
+            return n;
+        }
+
+        // An upper bound for the given percentile: the top of the bucket it falls in
+        uint32_t percentile_us (uint32_t pct) const
+        {
+            uint32_t n = count();
+            if (n == 0) {
+                return 0;
+            }
+            uint32_t target = (uint32_t)(((uint64_t)n * pct + 99) / 100);
+            uint32_t seen = 0;
+            for (uint32_t b = 0; b < BUCKETS - 1; b++) {
+                seen += counts[b].load(std::memory_order_relaxed);
+                if (seen >= target) {
+                    uint32_t top = (2u << b) - 1;
+                    return (top < max_us()) ? top : max_us();
+                }
+            }
+            return max_us();
+        }
+
+        uint32_t max_us () const { return max.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<uint32_t> counts[BUCKETS] {};
+        std::atomic<uint32_t> max {0};
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+
+// The layout of the flash log (see FlashLog.h), shared with the host extractor (host/tools/ptwd-log.cpp).
+//
+// The log region is a ring of 4 KB flash sectors. Every sector starts with a header:
+//   magic (4 bytes LE)  sequence (4 bytes LE)
+// 'sequence' goes up by one for every sector that gets started, so the oldest sector in the
+// region is the one with the lowest. The rest of the sector is 256 byte flash pages full of records.
+// A record never straddles two pages: the unused end of a page is left erased (0xFF), and no
+// record can start with 0xFF.
+//
+// Every record starts with a tag byte: type << 4 | bus. Numbers are varints, and signed numbers
+// are zig-zag varints, just as in the telemetry (see Telemetry.h). Times are mSec since boot.
+//
+//   TYPE_BOOT      nothing else: the firmware started up, and time started over from 0
+//   TYPE_KEYFRAME  time (4 bytes LE), varint(first slot), count (1 byte),
+//                  then for each of 'count' consecutive slots: ROM code (8 bytes LE), varint(zigzag(raw))
+//   TYPE_CHANGES   varint(time since the bus's previous record), count (1 byte),
+//                  then for each sensor: varint(slot - previous slot - 1), varint(zigzag(raw - previous raw))
+//
+// A keyframe holds the whole table of sensors on a bus along with their readings. A keyframe that
+// starts from slot 0 replaces the table. Each change record only carries the sensors whose reading
+// changed, as the difference from the previous reading, so it means nothing without the keyframe
+// before it. The writer starts every sector with fresh keyframes as soon as it can, so that
+// each sector can be read on its own once the sectors before it have been overwritten.
+//
+// Raw values are the sensors' 1/16ths of a degree C. NO_READING stands for a sensor that has
+// not been read yet.
+class LogFormat {
+    public:
+        static const uint32_t MAGIC = 0x474f4c50;       // "PLOG"
+
+        static const uint8_t TYPE_BOOT = 1;
+        static const uint8_t TYPE_KEYFRAME = 2;
+        static const uint8_t TYPE_CHANGES = 3;
+
+        static const uint8_t BLANK = 0xFF;
+
+        static const int32_t NO_READING = INT16_MIN;
+
+        // The most entries in one record, and the largest record headers and entries
+        static const uint32_t MAX_COUNT = 255;
+        static const uint32_t MAX_HEADER_SIZE = 1 + 4 + 5 + 1;
+        static const uint32_t MAX_KEY_SIZE = 8 + 5;
+        static const uint32_t MAX_CHANGE_SIZE = 5 + 5;
+
+        typedef struct {
+            uint32_t magic;
+            uint32_t sequence;
+        } sector_header_t;
+
+        static uint8_t tag (uint8_t type, uint32_t bus) { return (type << 4) | bus; }
+};
@@ -1,27 +1,283 @@
 #include "Onewire.h"
+#include "Crc8.h"
+#include "HotPath.h"
+#include "ow_rom.h"
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
 #include "onewire_library.pio.h"        // generated by pioasm
+#include "onewire_triplet.pio.h"        // generated by pioasm
 
-bool Onewire::init (PIO pio, uint offset, uint gpio)
+bool Onewire::init (PIO pio, uint offset, uint gpio, int triplet_offset)
 {
-    return ow_init(&ow, pio, (uint)offset, (uint)gpio);
+    if (!ow_init(&ow, pio, (uint)offset, (uint)gpio)) {
+        return false;
+    }
+    this->triplet_offset = triplet_offset;
+    #if configSUPPORT_STATIC_ALLOCATION
+        bus_lock = xSemaphoreCreateMutexStatic(&bus_lock_buffer);
+    #else
+        bus_lock = xSemaphoreCreateMutex();
+    #endif
+    use_dma = initDma();
+    return true;
 }
 
-void Onewire::send (uint data)
+void HOT_PATH(Onewire::lock) ()
 {
+    xSemaphoreTake(bus_lock, portMAX_DELAY);
+}
+
+void HOT_PATH(Onewire::unlock) ()
+{
+    xSemaphoreGive(bus_lock);
+}
+
+void HOT_PATH(Onewire::send) (uint data)
+{
+    lock();
     ow_send(&ow, data);
+    unlock();
+}
+
+uint8_t HOT_PATH(Onewire::read) ()
+{
+    lock();
+    uint8_t data = ow_read(&ow);
+    unlock();
+    return data;
+}
+
+bool HOT_PATH(Onewire::reset) ()
+{
+    lock();
+    bool present = resetBus();
+    unlock();
+    return present;
+}
+
+// With the lock held
+bool HOT_PATH(Onewire::resetBus) ()
+{
+    uint32_t t0_us = time_us_32();
+    bool present = ow_reset(&ow);
+    latencies[LATENCY_RESET].record(time_us_32() - t0_us);
+    return present;
 }
 
-uint8_t Onewire::read ()
+// The divider is in 1/256ths, worked out without touching a float
+void Onewire::clockChanged ()
 {
-    return ow_read(&ow);
+    uint32_t div = ((uint64_t)clock_get_hz(clk_sys) << 8) / 1000000;
+    pio_sm_set_clkdiv_int_frac(ow.pio, ow.sm, div >> 8, div & 0xff);
 }
 
-bool Onewire::reset ()
+// The same set up as onewire_sm_init() from the onewire library, which works out the clock divider
+// in float. The FPU context does not get saved on a task switch (see configENABLE_FPU), so that is
+// only safe while no other task could be using it: ow_init() still calls it once per bus from
+// bootSystem(), before the bus tasks exist. The bus tasks use this instead.
+void HOT_PATH(Onewire::smInit) (uint bits_per_word)
 {
-    return ow_reset(&ow);
+    pio_sm_config c = onewire_program_get_default_config(ow.offset);
+    sm_config_set_in_shift(&c, true, true, bits_per_word);
+    sm_config_set_out_shift(&c, true, true, bits_per_word);
+    sm_config_set_in_pins(&c, ow.gpio);
+    sm_config_set_sideset_pins(&c, ow.gpio);
+
+    uint32_t div = ((uint64_t)clock_get_hz(clk_sys) << 8) / 1000000;
+    sm_config_set_clkdiv_int_frac(&c, div >> 8, div & 0xff);
+
+    pio_sm_init(ow.pio, ow.sm, ow.offset + onewire_offset_fetch_bit, &c);
+    pio_sm_set_enabled(ow.pio, ow.sm, true);
 }
 
+// --------------------------------------------------------------------------------------------
+// A complete search is a series of incremental search passes, each one resuming from the last discrepancy
 int32_t Onewire::romsearch (uint64_t *romcodes, int maxdevs, uint command)
 {
-    return ow_romsearch (&ow, romcodes, maxdevs, command);
-}
\ No newline at end of file
+    search_t s = {};
+    int32_t found = 0;
+
+    do {
+        if (!searchNext(s, command)) {
+            break;
+        }
+        if (romcodes) {
+            romcodes[found] = s.rom;
+        }
+        found++;
+    } while (!s.done && ((maxdevs == 0) || (found < maxdevs)));
+
+    return found;
+}
+
+// --------------------------------------------------------------------------------------------
+// One step of a ROM search: read a bit, read its complement, then write the direction to take.
+// 'preferred' is the direction to take if the devices disagree.
+// Returns the bit in bit 0 and its complement in bit 1.
+uint HOT_PATH(Onewire::searchTriplet) (uint preferred)
+{
+    if (triplet_offset >= 0) {
+        // The triplet program does all 3 slots and picks the direction by itself
+        pio_sm_put_blocking(ow.pio, ow.sm, preferred);
+        return pio_sm_get_blocking(ow.pio, ow.sm) >> 30;
+    }
+
+    uint a = ow_read(&ow) ? 1 : 0;
+    uint b = ow_read(&ow) ? 1 : 0;
+    ow_send(&ow, a ? 1 : (b ? 0 : preferred));
+    return a | (b << 1);
+}
+
+// --------------------------------------------------------------------------------------------
+// One pass of the search algorithm from Maxim application note 187 (see RomSearch.h).
+// The search tree gets walked one triplet at a time, either by the triplet program,
+// or by running the onewire program in 1-bit mode.
+// The state machine gets re-initialized along the way, which sets its clock divider from clk_sys,
+// in integers. Holding the lock for the whole pass keeps clk_sys from changing in the meantime.
+bool HOT_PATH(Onewire::searchNext) (search_t &s, uint command)
+{
+    if (s.done) {
+        s = {};
+        return false;
+    }
+
+    lock();
+    if (!resetBus()) {
+        unlock();
+        s = {};
+        return false;
+    }
+
+    if (triplet_offset >= 0) {
+        ow_send(&ow, command);
+        onewire_triplet_sm_init(ow.pio, ow.sm, triplet_offset, ow.gpio);
+    }
+    else {
+        smInit(1);
+        for (int i = 0; i < 8; i++) {
+            ow_send(&ow, command >> i);
+        }
+    }
+
+    uint64_t rom;
+    int last_zero;
+    bool found = RomSearch::walk(s, [this](uint32_t preferred) { return searchTriplet(preferred); }, rom, last_zero);
+
+    smInit(8);
+    unlock();
+
+    // A device that got unplugged halfway through can leave us with a garbage ROM code
+    if (!found || !validRom(rom)) {
+        s = {};
+        return false;
+    }
+
+    RomSearch::advance(s, rom, last_zero);
+    return true;
+}
+
+uint8_t HOT_PATH(Onewire::crc8) (const uint8_t *data, uint32_t len)
+{
+    return ::crc8(data, len);
+}
+
+bool HOT_PATH(Onewire::validRom) (uint64_t rom)
+{
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = rom >> (8 * i);
+    }
+    return crc8(bytes, sizeof(bytes)) == 0;
+}
+
+// --------------------------------------------------------------------------------------------
+bool HOT_PATH(Onewire::start) (const uint8_t *tx, uint32_t txlen, uint32_t rxlen)
+{
+    if ((txlen + rxlen) > MAX_TRANSACTION) {
+        return false;
+    }
+
+    // Bytes being read are clocked in by sending all 1's
+    for (uint32_t i = 0; i < txlen; i++) {
+        txbuf[i] = tx[i];
+    }
+    for (uint32_t i = txlen; i < txlen + rxlen; i++) {
+        txbuf[i] = 0xFF;
+    }
+    txcount = txlen + rxlen;
+    rxcount = rxlen;
+
+    // finish() lets go of it
+    lock();
+    start_us = time_us_32();
+
+    if (!use_dma) {
+        startBlocking();
+        return true;
+    }
+
+    // Throw away any stale notification from a transaction that timed out
+    waiter = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyValueClearIndexed(waiter, NOTIFY_INDEX, UINT32_MAX);
+
+    startDma();
+    return true;
+}
+
+// Without DMA, the transaction runs to completion right away, leaving rxbuf
+// in exactly the state that the DMA transfer would have left it.
+void HOT_PATH(Onewire::startBlocking) ()
+{
+    rxbuf[0] = ow_reset(&ow) ? 0 : 1;
+    for (uint32_t i = 0; i < txcount; i++) {
+        if (i < (txcount - rxcount)) {
+            ow_send(&ow, txbuf[i]);
+            rxbuf[1 + i] = 0;
+        }
+        else {
+            rxbuf[1 + i] = (uint32_t)ow_read(&ow) << 24;
+        }
+    }
+}
+
+bool HOT_PATH(Onewire::finish) (uint8_t *rx, TickType_t timeout)
+{
+    bool completed = true;
+    if (use_dma) {
+        completed = (ulTaskNotifyTakeIndexed(NOTIFY_INDEX, pdTRUE, timeout) != 0);
+        if (!completed) {
+            abortDma();
+        }
+        waiter = nullptr;
+    }
+
+    // Transactions that address a single device get timed. Timeouts count too: they are the long tail.
+    if (txbuf[0] == OW_MATCH_ROM) {
+        latencies[(rxcount > 0) ? LATENCY_READ : LATENCY_MATCH_ROM].record(time_us_32() - start_us);
+    }
+    unlock();
+    if (!completed) {
+        return false;
+    }
+
+    // rxbuf[0] holds the bus state sampled during the presence window: low means someone answered
+    if (rxbuf[0] & 1) {
+        return false;
+    }
+
+    // Each byte was shifted in from the top of the ISR, so the data sits in bits 31..24
+    if (rx) {
+        for (uint32_t i = 0; i < rxcount; i++) {
+            rx[i] = rxbuf[1 + txcount - rxcount + i] >> 24;
+        }
+    }
+    return true;
+}
+
+bool HOT_PATH(Onewire::transact) (const uint8_t *tx, uint32_t txlen, uint8_t *rx, uint32_t rxlen)
+{
+    if (!start(tx, txlen, rxlen)) {
+        return false;
+    }
+    return finish(rx);
+}
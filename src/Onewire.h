@@ -1,3 +1,5 @@
+#pragma once
+
 #include <stdint.h>
 
 
@@ -11,14 +13,121 @@ extern "C" {
 //#include "hardware/clocks.h"            // for clock_get_hz() in generated header
 //#include "onewire_library.pio.h"        // generated by pioasm
 
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+
+#include "LatencyHistogram.h"
+#include "RomSearch.h"
+
 class Onewire {
     public:
-        bool init (PIO pio, uint offset, uint gpio);
+        // The state of a ROM search that finds one device per call to searchNext()
+        typedef RomSearch::state_t search_t;
+
+        // The largest transaction (bytes sent plus bytes read back) that can be queued at once
+        static const uint32_t MAX_TRANSACTION = 32;
+
+        // Transactions signal their completion using this task notification index,
+        // leaving the default index free for the application.
+        static const UBaseType_t NOTIFY_INDEX = 1;
+
+        // 'triplet_offset' is where the onewire_triplet program was loaded in the same PIO block,
+        // or -1 if it could not be loaded. Without it, ROM searches run one slot at a time.
+        bool init (PIO pio, uint offset, uint gpio, int triplet_offset = -1);
         void send (uint data);
         uint8_t read ();
         bool reset ();
+
+        // The onewire programs run their state machine at 1 MHz. Call this after every change to
+        // clk_sys to re-derive the state machine's clock divider.
+        void clockChanged ();
+
+        // Every bus operation holds the bus's lock from start to finish: a transaction from start()
+        // until finish(), and a ROM search pass or a single primitive for its whole length. Anything
+        // that would upset a time slot, like a change to clk_sys, takes the lock first, and so happens
+        // between operations. The owner of the bus must not call lock() itself around an operation.
+        void lock ();
+        void unlock ();
+
+        // Find up to 'maxdevs' devices (0: no limit). Returns how many were found.
         int32_t romsearch (uint64_t *romcodes, int maxdevs, uint command);
 
+        // Incremental ROM search: every call performs one pass through the search tree and
+        // finds one device. Returns false (and resets 's') once every device has been found,
+        // if the bus is empty, or if the pass failed. A fresh search starts from a zeroed search_t.
+        bool searchNext (search_t &s, uint command);
+
+        // Dallas/Maxim CRC8, used by ROM codes and scratchpads. Data followed by its CRC checks out as 0.
+        static uint8_t crc8 (const uint8_t *data, uint32_t len);
+
+        // True if the last byte of a ROM code is the CRC of the first 7
+        static bool validRom (uint64_t rom);
+
+        // Asynchronous transactions: a bus reset, followed by 'txlen' bytes sent and then 'rxlen'
+        // bytes read back, all clocked out by DMA without any CPU involvement.
+        // start() returns immediately. The calling task is notified when the transaction completes,
+        // and collects the results by calling finish(). finish() returns false if no device
+        // answered the reset or if the transaction did not complete within 'timeout'.
+        bool start (const uint8_t *tx, uint32_t txlen, uint32_t rxlen = 0);
+        bool finish (uint8_t *rx = nullptr, TickType_t timeout = pdMS_TO_TICKS(50));
+
+        // A transaction was started on the DMA, and finish() has not collected it yet
+        bool busy () const { return waiter != nullptr; }
+
+        // A start() followed by a finish(): the calling task sleeps while the bus does the work
+        bool transact (const uint8_t *tx, uint32_t txlen, uint8_t *rx = nullptr, uint32_t rxlen = 0);
+
+        // How long bus operations take, from the calling task's point of view:
+        //   LATENCY_RESET      reset() on its own, as used by ROM searches
+        //   LATENCY_MATCH_ROM  a transaction that addresses one device and only sends (e.g. a scratchpad write)
+        //   LATENCY_READ       a transaction that addresses one device and reads from it (e.g. a scratchpad read)
+        // Both transaction kinds include their reset. Only the task that owns the bus may use it, so
+        // each histogram has a single writer.
+        typedef enum {
+            LATENCY_RESET,
+            LATENCY_MATCH_ROM,
+            LATENCY_READ,
+            LATENCY_COUNT
+        } latency_t;
+
+        const LatencyHistogram &latency (latency_t kind) const { return latencies[kind]; }
+
+        // Each bus needs 2 DMA channels for its asynchronous transactions. If there were none left
+        // when the bus got initialized, start() performs the transaction on the spot instead.
+        bool usingDma () { return use_dma; }
+
     private:
+        bool initDma ();
+        void startDma ();
+        void abortDma ();
+        static void dmaIrqHandler ();
+
+        void startBlocking ();
+        bool resetBus ();
+        void smInit (uint bits_per_word);
+        uint searchTriplet (uint preferred);
+
         OW ow;
-};
\ No newline at end of file
+        int triplet_offset;
+
+        SemaphoreHandle_t bus_lock;
+        #if configSUPPORT_STATIC_ALLOCATION
+            StaticSemaphore_t bus_lock_buffer;
+        #endif
+
+        bool use_dma;
+        int dma_tx;
+        int dma_rx;
+        TaskHandle_t waiter;
+        uint32_t txcount;
+        uint32_t rxcount;
+        uint32_t start_us;
+
+        LatencyHistogram latencies[LATENCY_COUNT];
+
+        // One byte goes out per bus byte. Every byte (plus the reset's presence result)
+        // comes back as a full 32-bit word from the RX FIFO.
+        uint8_t txbuf[MAX_TRANSACTION];
+        uint32_t rxbuf[MAX_TRANSACTION + 1];
+};
@@ -0,0 +1,98 @@
+// DMA engine behind the asynchronous Onewire transactions.
+//
+// The onewire PIO program turns every word in its TX FIFO into a byte on the bus, and pushes
+// one word into its RX FIFO for every byte (the bits that were read back during the byte).
+// A transaction is run by forcing the state machine into its reset_bus routine, then letting
+// one DMA channel feed the TX FIFO from txbuf while a second channel drains the RX FIFO into
+// rxbuf. The RX channel finishes last, and its interrupt wakes the waiting task.
+
+#include "Onewire.h"
+#include "HotPath.h"
+
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+
+// Maps each RX DMA channel back to the Onewire instance that owns it
+static Onewire *dma_owner[NUM_DMA_CHANNELS];
+static bool irq_installed;
+
+// --------------------------------------------------------------------------------------------
+bool Onewire::initDma ()
+{
+    waiter = nullptr;
+    dma_tx = dma_claim_unused_channel(false);
+    dma_rx = dma_claim_unused_channel(false);
+    if ((dma_tx < 0) || (dma_rx < 0)) {
+        // Give back whatever we did get so that it is not wasted
+        if (dma_tx >= 0) {
+            dma_channel_unclaim(dma_tx);
+        }
+        if (dma_rx >= 0) {
+            dma_channel_unclaim(dma_rx);
+        }
+        return false;
+    }
+
+    // TX: bytes from txbuf to the TX FIFO. The byte write gets replicated across the FIFO word,
+    // and the state machine only shifts out the low 8 bits.
+    dma_channel_config c = dma_channel_get_default_config(dma_tx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(ow.pio, ow.sm, true));
+    dma_channel_configure(dma_tx, &c, &ow.pio->txf[ow.sm], txbuf, 0, false);
+
+    // RX: whole words from the RX FIFO into rxbuf
+    c = dma_channel_get_default_config(dma_rx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, pio_get_dreq(ow.pio, ow.sm, false));
+    dma_channel_configure(dma_rx, &c, rxbuf, &ow.pio->rxf[ow.sm], 0, false);
+
+    dma_owner[dma_rx] = this;
+    if (!irq_installed) {
+        irq_add_shared_handler(DMA_IRQ_0, dmaIrqHandler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+        irq_set_enabled(DMA_IRQ_0, true);
+        irq_installed = true;
+    }
+    dma_channel_set_irq0_enabled(dma_rx, true);
+    return true;
+}
+
+// --------------------------------------------------------------------------------------------
+void HOT_PATH(Onewire::startDma) ()
+{
+    // The reset's presence result is the first word to come back, followed by one per byte
+    dma_channel_transfer_to_buffer_now(dma_rx, rxbuf, 1 + txcount);
+
+    // The state machine is stalled waiting for TX data. Forcing it into reset_bus
+    // means it will run the reset before it starts consuming the bytes queued behind it.
+    pio_sm_exec(ow.pio, ow.sm, ow.jmp_reset);
+    dma_channel_transfer_from_buffer_now(dma_tx, txbuf, txcount);
+}
+
+void HOT_PATH(Onewire::abortDma) ()
+{
+    dma_channel_abort(dma_tx);
+    dma_channel_abort(dma_rx);
+    dma_channel_acknowledge_irq0(dma_rx);
+    pio_sm_clear_fifos(ow.pio, ow.sm);
+}
+
+// --------------------------------------------------------------------------------------------
+void HOT_PATH(Onewire::dmaIrqHandler) ()
+{
+    BaseType_t woken = pdFALSE;
+
+    for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        Onewire *o = dma_owner[ch];
+        if (o && dma_channel_get_irq0_status(ch)) {
+            dma_channel_acknowledge_irq0(ch);
+            if (o->waiter) {
+                vTaskNotifyGiveIndexedFromISR(o->waiter, NOTIFY_INDEX, &woken);
+            }
+        }
+    }
+    portYIELD_FROM_ISR(woken);
+}
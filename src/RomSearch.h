@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+
+// The search algorithm from Maxim application note 187, apart from the bus it runs on.
+// Kept in its own header so that host tools can run the same implementation as the target.
+//
+// A complete search is a series of passes, each one finding one device by resuming from the
+// last discrepancy of the pass before. Onewire::searchNext() runs them on a real bus.
+class RomSearch {
+    public:
+        // The state of a ROM search that finds one device per pass
+        typedef struct {
+            uint64_t rom;                   // the ROM code found by the most recent pass
+            int last_discrepancy;           // 1 + the bit where the search takes the '1' path next time (0: none)
+            bool done;                      // the previous pass found the last device
+        } state_t;
+
+        // Walks the search tree once, one triplet at a time. 'triplet(preferred)' reads a bit and
+        // its complement, then writes the direction to take: 'preferred' if the devices disagree.
+        // It returns the bit in bit 0 and its complement in bit 1.
+        // Returns false if nobody was taking part any more: the device being followed went away.
+        // Otherwise, 'rom' is the ROM code that was followed, and 'last_zero' the last bit where the
+        // '0' path was taken at a discrepancy (-1: none). It is up to the caller to check the ROM code
+        // and pass both to advance().
+        template <typename TRIPLET>
+        static bool walk (const state_t &s, TRIPLET triplet, uint64_t &rom, int &last_zero)
+        {
+            last_zero = -1;
+            int discrepancy = s.last_discrepancy - 1;
+            rom = 0;
+            for (int i = 0; i < 64; i++) {
+                // At a discrepancy: take the same path as last time below the last discrepancy,
+                // the '1' path at it, and the '0' path beyond it
+                uint32_t preferred;
+                if (i < discrepancy) {
+                    preferred = (s.rom >> i) & 1;
+                }
+                else {
+                    preferred = (i == discrepancy) ? 1 : 0;
+                }
+
+                uint32_t ab = triplet(preferred);
+                uint32_t dir;
+                if (ab == 3) {
+                    return false;
+                }
+                else if (ab == 0) {
+                    // A discrepancy
+                    dir = preferred;
+                    if (dir == 0) {
+                        last_zero = i;
+                    }
+                }
+                else {
+                    // Every remaining device agrees on this bit
+                    dir = ab & 1;
+                }
+
+                rom |= (uint64_t)dir << i;
+            }
+            return true;
+        }
+
+        // Sets up the next pass after a good one
+        static void advance (state_t &s, uint64_t rom, int last_zero)
+        {
+            s.rom = rom;
+            s.last_discrepancy = last_zero + 1;
+            s.done = (last_zero < 0);
+        }
+};
@@ -0,0 +1,110 @@
+#include "RomStore.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "pico/flash.h"
+
+#include "Trace.h"
+
+// --------------------------------------------------------------------------------------------
+// FNV-1a over everything but the checksum itself
+uint32_t RomStore::checksum (const rom_table_t *t)
+{
+    const uint8_t *p = (const uint8_t *)t;
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < offsetof(rom_table_t, checksum); i++) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void RomStore::init ()
+{
+    #if configSUPPORT_STATIC_ALLOCATION
+        mutex = xSemaphoreCreateMutexStatic(&mutex_buffer);
+    #else
+        mutex = xSemaphoreCreateMutex();
+    #endif
+
+    const rom_table_t *flash = (const rom_table_t *)(XIP_BASE + FLASH_OFFSET);
+    if ((flash->magic == MAGIC) && (flash->checksum == checksum(flash))) {
+        memcpy(&table, flash, sizeof(table));
+    }
+    else {
+        memset(image, 0, sizeof(image));
+        table.magic = MAGIC;
+    }
+}
+
+RomStore::bus_roms_t *RomStore::find (uint32_t gpio)
+{
+    for (uint32_t i = 0; i < BusManager::MAX_BUSES; i++) {
+        if ((table.bus[i].count > 0) && (table.bus[i].gpio == gpio)) {
+            return &table.bus[i];
+        }
+    }
+    return nullptr;
+}
+
+// --------------------------------------------------------------------------------------------
+int RomStore::load (uint32_t gpio, uint64_t *roms, int maxdevs)
+{
+    int count = 0;
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    bus_roms_t *b = find(gpio);
+    if (b) {
+        count = ((int)b->count < maxdevs) ? b->count : maxdevs;
+        memcpy(roms, b->rom, count * sizeof(uint64_t));
+    }
+    xSemaphoreGive(mutex);
+
+    return count;
+}
+
+bool RomStore::save (uint32_t gpio, const uint64_t *roms, int count)
+{
+    if (count > (int)MAX_ROMS_PER_BUS) {
+        count = MAX_ROMS_PER_BUS;
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    bus_roms_t *b = find(gpio);
+    if (!b) {
+        // Take over an empty slot
+        for (uint32_t i = 0; (i < BusManager::MAX_BUSES) && !b; i++) {
+            if (table.bus[i].count == 0) {
+                b = &table.bus[i];
+            }
+        }
+    }
+
+    bool ok = true;
+    if (b && ((b->count != (uint32_t)count) || (memcmp(b->rom, roms, count * sizeof(uint64_t)) != 0))) {
+        b->gpio = gpio;
+        b->count = count;
+        memcpy(b->rom, roms, count * sizeof(uint64_t));
+        table.sequence++;
+        table.checksum = checksum(&table);
+
+        // The other core must not be executing from flash while the sector is being rewritten
+        ok = (flash_safe_execute(writeFlash, this, 100) == PICO_OK);
+        if (!ok) {
+            TRACE("%s: Unable to write the ROM table to flash\n", __FUNCTION__);
+        }
+    }
+
+    xSemaphoreGive(mutex);
+    return ok;
+}
+
+// Runs with interrupts disabled and the other core locked out
+void RomStore::writeFlash (void *param)
+{
+    RomStore *store = (RomStore *)param;
+
+    flash_range_erase(FLASH_OFFSET, FLASH_SECTOR_SIZE);
+    flash_range_program(FLASH_OFFSET, store->image, IMAGE_SIZE);
+}
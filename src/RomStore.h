@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "hardware/flash.h"
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+#include "BusManager.h"
+
+// The RomStore keeps the ROM codes that were found on each bus in a reserved sector at the
+// very end of flash. After a reboot, the known devices can be verified individually instead of
+// having to rediscover everything with a full ROM search before the first sample.
+//
+// The table is only written to flash when it actually changes.
+class RomStore {
+    public:
+        // Storage limit per bus. This is independent of how many sensors we scan for.
+        static const uint32_t MAX_ROMS_PER_BUS = 32;
+
+        // Flash offset of the reserved sector
+        static const uint32_t FLASH_OFFSET = PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE;
+
+        // Read the table from flash. If flash does not hold a valid table, start an empty one.
+        void init ();
+
+        // Copy the saved ROM codes for the bus on 'gpio' to 'roms'. Returns how many there were.
+        int load (uint32_t gpio, uint64_t *roms, int maxdevs);
+
+        // Replace the saved ROM codes for the bus on 'gpio', writing the table to flash if anything changed.
+        bool save (uint32_t gpio, const uint64_t *roms, int count);
+
+    private:
+        typedef struct {
+            uint32_t gpio;
+            uint32_t count;
+            uint64_t rom[MAX_ROMS_PER_BUS];
+        } bus_roms_t;
+
+        typedef struct {
+            uint32_t magic;
+            uint32_t sequence;
+            bus_roms_t bus[BusManager::MAX_BUSES];
+            uint32_t checksum;
+        } rom_table_t;
+
+        static const uint32_t MAGIC = 0x544d4f52;       // "ROMT"
+
+        // Flash can only be programmed in whole pages
+        static const uint32_t IMAGE_SIZE = (sizeof(rom_table_t) + FLASH_PAGE_SIZE - 1) & ~(FLASH_PAGE_SIZE - 1);
+        static_assert(IMAGE_SIZE <= FLASH_SECTOR_SIZE, "ROM table does not fit in a flash sector");
+
+        static uint32_t checksum (const rom_table_t *t);
+        static void writeFlash (void *param);
+        bus_roms_t *find (uint32_t gpio);
+
+        union {
+            rom_table_t table;
+            uint8_t image[IMAGE_SIZE];
+        };
+        SemaphoreHandle_t mutex;
+        #if configSUPPORT_STATIC_ALLOCATION
+            StaticSemaphore_t mutex_buffer;
+        #endif
+};
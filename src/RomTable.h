@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+#include "SensorRegistry.h"
+
+// A copy of the ROM codes in a bus's sensor table, by slot, for a task other than the bus task.
+// The bus task adds and removes sensors in its SensorRegistry as they come and go, moving others
+// to new slots as it does. The report task cannot look at that table while it changes, so it
+// works from a copy instead, and a RomTablePublisher hands it a new one after every change.
+//
+// Each version of the table has its own number. Every reading that the bus task hands over
+// carries the version that its slot number belongs to, so that the report task can tell which
+// sensor it came from even when the table has moved on since.
+template <uint32_t CAPACITY>
+class RomTable {
+    public:
+        static const int NOT_FOUND = -1;
+
+        int count () const { return sensor_count; }
+        uint64_t rom (int slot) const { return roms[slot]; }
+        const uint64_t *romTable () const { return roms; }
+        uint32_t version () const { return table_version; }
+
+        // Returns the slot of the sensor with ROM code 'rom', or NOT_FOUND
+        int find (uint64_t rom) const
+        {
+            uint32_t lo = 0;
+            uint32_t hi = sensor_count;
+            while (lo < hi) {
+                uint32_t mid = (lo + hi) / 2;
+                if (roms[order[mid]] < rom) {
+                    lo = mid + 1;
+                }
+                else {
+                    hi = mid;
+                }
+            }
+            return ((lo < (uint32_t)sensor_count) && (roms[order[lo]] == rom)) ? order[lo] : NOT_FOUND;
+        }
+
+    private:
+        template <uint32_t>
+        friend class RomTablePublisher;
+
+        uint64_t roms[CAPACITY];
+        uint16_t order[CAPACITY];               // slots, sorted by ROM code
+        int sensor_count = 0;
+        uint32_t table_version = 0;
+};
+
+// Hands each new version of a bus's ROM table from the bus task to the report task, which are
+// free to run on different cores. The bus task is the only one that ever publishes, and the
+// report task the only one that ever copies.
+//
+// The version number doubles as a sequence lock: it is odd while a new table is being written,
+// and the copy gets taken again if the number was odd, or changed, while it was being taken.
+// The bus task never waits. A change of the table only happens on hot-plug, so the report task
+// hardly ever has to take a copy twice.
+template <uint32_t CAPACITY>
+class RomTablePublisher {
+    public:
+        // Bus task side: make the table in 'sensors' the latest version
+        void publish (const SensorRegistry<CAPACITY> &sensors)
+        {
+            uint32_t v = sequence.load(std::memory_order_relaxed);
+            sequence.store(v + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            table.sensor_count = sensors.count();
+            memcpy(table.roms, sensors.romTable(), table.sensor_count * sizeof(table.roms[0]));
+            memcpy(table.order, sensors.sortedSlots(), table.sensor_count * sizeof(table.order[0]));
+
+            sequence.store(v + 2, std::memory_order_release);
+        }
+
+        // Bus task side: the version that the slots in the bus task's table belong to
+        uint32_t version () const { return sequence.load(std::memory_order_relaxed); }
+
+        // Report task side: whether a newer version than 'copy' has been published
+        bool changed (const RomTable<CAPACITY> &copy) const
+        {
+            return sequence.load(std::memory_order_relaxed) != copy.table_version;
+        }
+
+        // Report task side: copy the latest version into 'copy'
+        void copy (RomTable<CAPACITY> &copy) const
+        {
+            while (1) {
+                uint32_t v = sequence.load(std::memory_order_acquire);
+                if (v & 1) {
+                    continue;
+                }
+                // Halfway through a publish, the count is still either the old one or the new one
+                int n = table.sensor_count;
+                memcpy(copy.roms, table.roms, n * sizeof(copy.roms[0]));
+                memcpy(copy.order, table.order, n * sizeof(copy.order[0]));
+                copy.sensor_count = n;
+                copy.table_version = v;
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) == v) {
+                    return;
+                }
+            }
+        }
+
+    private:
+        RomTable<CAPACITY> table;
+        std::atomic<uint32_t> sequence {0};
+};
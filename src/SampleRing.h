@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+// A lock-free ring buffer for exactly one producer and one consumer, which are free to run on
+// different cores. The producer is the only one that ever writes 'head', and the consumer is
+// the only one that ever writes 'tail', so neither side needs a lock, a critical section, or
+// an atomic read-modify-write (which the Cortex-M0+ does not have anyway).
+//
+// The indexes run freely and only get masked when they are used, so all SIZE entries are usable.
+// SIZE must be a power of 2.
+//
+// Items can also be passed in batches without copying them: the producer fills in entries with
+// reserve() where they lie in the ring, and publishes all of them at once with commit(). The
+// consumer works on them in place through peek(), then hands the entries back with release().
+// Either way, each batch costs one release store on each side, however many items are in it.
+template <typename T, uint32_t SIZE>
+class SampleRing {
+    static_assert((SIZE & (SIZE - 1)) == 0, "SampleRing SIZE must be a power of 2");
+
+    public:
+        // Producer side: returns false if the consumer has fallen so far behind that the ring is full.
+        // The item gets dropped and counted as an overflow.
+        bool push (const T &item)
+        {
+            T *entry = reserve();
+            if (!entry) {
+                return false;
+            }
+            *entry = item;
+            commit();
+            return true;
+        }
+
+        // Producer side: returns the next free entry for the producer to fill in, or nullptr (and
+        // counts an overflow) if the ring is full. The consumer cannot see it until commit().
+        T *reserve ()
+        {
+            if ((pending - tail.load(std::memory_order_acquire)) == SIZE) {
+                overflows.store(overflows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            return &items[pending++ & (SIZE - 1)];
+        }
+
+        // Producer side: hand every entry reserved so far to the consumer
+        void commit ()
+        {
+            // The items must be in place before the consumer can see the new head
+            head.store(pending, std::memory_order_release);
+        }
+
+        // Consumer side: returns false if the ring is empty
+        bool pop (T &item)
+        {
+            uint32_t t = tail.load(std::memory_order_relaxed);
+            if (t == head.load(std::memory_order_acquire)) {
+                return false;
+            }
+            item = items[t & (SIZE - 1)];
+
+            // The item must be copied out before the producer can reuse its entry
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side: points 'first' at the oldest item, and returns how many items follow it
+        // in one contiguous run. A batch that wraps around the end of the ring takes two calls.
+        uint32_t peek (const T *&first) const
+        {
+            uint32_t t = tail.load(std::memory_order_relaxed);
+            uint32_t available = head.load(std::memory_order_acquire) - t;
+            uint32_t contiguous = SIZE - (t & (SIZE - 1));
+            first = &items[t & (SIZE - 1)];
+            return (available < contiguous) ? available : contiguous;
+        }
+
+        // Consumer side: the oldest 'count' items are done with, and the producer can reuse their entries
+        void release (uint32_t count)
+        {
+            tail.store(tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+        }
+
+        // How many items the producer had to drop so far. Safe to call from either side.
+        uint32_t overflowCount () const { return overflows.load(std::memory_order_relaxed); }
+
+    private:
+        T items[SIZE];
+        std::atomic<uint32_t> head {0};
+        std::atomic<uint32_t> tail {0};
+        std::atomic<uint32_t> overflows {0};
+        uint32_t pending = 0;                   // the producer's own: head, plus the entries reserved since the last commit()
+};
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Temperature.h"
+
+// The table of sensors on one bus, for up to CAPACITY sensors.
+//
+// Each field gets its own array (structure-of-arrays), so a pass over one field does not drag
+// the others along with it. The table belongs to the bus task. Other tasks work from a copy of
+// its ROM codes that the bus task publishes after every change (see RomTable.h).
+//
+// Sensors live in slots 0 to count()-1. Removing a sensor moves the last one into its slot.
+// A separate index keeps the slots sorted by ROM code, so that the ROM codes that come back
+// from an alarm search or a background search can be looked up in O(log n). Adding or removing
+// a sensor keeps the index sorted, which costs O(n), but that only happens on hot-plug.
+template <uint32_t CAPACITY>
+class SensorRegistry {
+    static_assert((CAPACITY > 0) && (CAPACITY <= UINT16_MAX), "SensorRegistry CAPACITY must fit in a uint16_t");
+
+    public:
+        static const int NOT_FOUND = -1;
+
+        int count () const { return sensor_count; }
+        bool full () const { return sensor_count == (int)CAPACITY; }
+
+        uint64_t rom (int slot) const { return roms[slot]; }
+
+        // All of the ROM codes, in slot order
+        const uint64_t *romTable () const { return roms; }
+
+        // All of the slots, in ROM code order
+        const uint16_t *sortedSlots () const { return order; }
+
+        // Returns the slot of the sensor with ROM code 'rom', or NOT_FOUND
+        int find (uint64_t rom) const
+        {
+            uint32_t pos = lowerBound(rom);
+            return ((pos < (uint32_t)sensor_count) && (roms[order[pos]] == rom)) ? order[pos] : NOT_FOUND;
+        }
+
+        // Returns the slot of a new sensor with ROM code 'rom' (or of the existing one, if it is
+        // already there), or NOT_FOUND if the table is full. The other fields of a new sensor are
+        // left for the caller to fill in.
+        int add (uint64_t rom)
+        {
+            uint32_t pos = lowerBound(rom);
+            if ((pos < (uint32_t)sensor_count) && (roms[order[pos]] == rom)) {
+                return order[pos];
+            }
+            if (full()) {
+                return NOT_FOUND;
+            }
+
+            int slot = sensor_count++;
+            roms[slot] = rom;
+            seen[slot] = false;
+            for (uint32_t i = slot; i > pos; i--) {
+                order[i] = order[i - 1];
+            }
+            order[pos] = slot;
+            return slot;
+        }
+
+        // Remove the sensor in 'slot' by moving the last sensor into its place
+        void remove (int slot)
+        {
+            int last = sensor_count - 1;
+
+            // Take 'slot' out of the index, and point the last sensor's entry at its new slot
+            uint32_t pos = lowerBound(roms[slot]);
+            for (uint32_t i = pos; i < (uint32_t)last; i++) {
+                order[i] = order[i + 1];
+            }
+            for (uint32_t i = 0; i < (uint32_t)last; i++) {
+                if (order[i] == last) {
+                    order[i] = slot;
+                }
+            }
+
+            roms[slot] = roms[last];
+            raw[slot] = raw[last];
+            family[slot] = family[last];
+            resolution[slot] = resolution[last];
+            alarm_high[slot] = alarm_high[last];
+            alarm_low[slot] = alarm_low[last];
+            seen[slot] = seen[last];
+            period[slot] = period[last];
+            release[slot] = release[last];
+            ready[slot] = ready[last];
+            converting[slot] = converting[last];
+            crc_errors[slot] = crc_errors[last];
+            power_on_readings[slot] = power_on_readings[last];
+            sensor_count = last;
+        }
+
+        // The fields of each sensor, by slot
+        Temperature::raw_t raw[CAPACITY];       // the latest reading
+        uint8_t family[CAPACITY];               // the index of its driver in DeviceFamily::CODES
+        uint8_t resolution[CAPACITY];           // 9 to 12 bits
+        int8_t alarm_high[CAPACITY];            // the TH and TL alarm thresholds in the sensor's scratchpad
+        int8_t alarm_low[CAPACITY];
+        bool seen[CAPACITY];                    // found by the current background search round
+        uint16_t crc_errors[CAPACITY];          // scratchpad reads that failed their CRC check, retries included
+        uint16_t power_on_readings[CAPACITY];   // readings that came back as the power-on value, and got dropped
+
+        // The bus task's schedule for each sensor, in ticks (see AcquisitionScheduler.h)
+        uint32_t period[CAPACITY];
+        uint32_t release[CAPACITY];             // when its next reading was due to start
+        uint32_t ready[CAPACITY];               // when its conversion is done, while 'converting'
+        bool converting[CAPACITY];
+
+    private:
+        // The position in 'order' of the first sensor whose ROM code is not less than 'rom'
+        uint32_t lowerBound (uint64_t rom) const
+        {
+            uint32_t lo = 0;
+            uint32_t hi = sensor_count;
+            while (lo < hi) {
+                uint32_t mid = (lo + hi) / 2;
+                if (roms[order[mid]] < rom) {
+                    lo = mid + 1;
+                }
+                else {
+                    hi = mid;
+                }
+            }
+            return lo;
+        }
+
+        uint64_t roms[CAPACITY];
+        uint16_t order[CAPACITY];               // slots, sorted by ROM code
+        int sensor_count;
+};
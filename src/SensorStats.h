@@ -0,0 +1,131 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Temperature.h"
+
+// Rolling statistics for up to CAPACITY sensors, kept up to date one reading at a time.
+// Every update is a handful of integer adds and shifts, whatever the window size:
+//
+//   average    an exponential moving average, with a weight of 1/2^EMA_SHIFT for the newest reading
+//   filtered   the average rounded to a raw reading, with hysteresis: it only moves once the average
+//              is more than 3/4 of a step away from it. A sensor sitting on the edge between two
+//              1/16 C steps reads one or the other at random, and this keeps it from flickering.
+//   min, max   over the last WINDOW to 2*WINDOW readings. Each block of WINDOW readings keeps its own
+//              min and max, and the window is the current block plus the one before it.
+//   rate       how fast the average moved over the last complete block, per minute
+//   noise      a moving average of how far each reading lands from the average (the mean absolute deviation)
+//
+// The average and noise are kept with 8 extra fraction bits (Q8), so a steady sensor does not get
+// stuck half a step away from its true value. Accessors return everything in centi-degrees C.
+//
+// Like SensorRegistry, each field gets its own array. Only one task may update or read the stats.
+template <uint32_t CAPACITY, uint32_t WINDOW = 32, uint32_t EMA_SHIFT = 2, uint32_t NOISE_SHIFT = 4>
+class SensorStats {
+    static_assert((WINDOW > 0) && (WINDOW <= UINT16_MAX), "SensorStats WINDOW must fit in a uint16_t");
+
+    public:
+        static const int32_t FRACTION_BITS = 8;
+        static const int32_t ONE = 1 << FRACTION_BITS;
+
+        // Forget everything about a sensor: its next reading starts over
+        void reset (int slot) { samples[slot] = 0; }
+
+        void resetAll ()
+        {
+            for (uint32_t i = 0; i < CAPACITY; i++) {
+                reset(i);
+            }
+        }
+
+        // Add a reading taken at 't_ms', and return the new filtered value
+        Temperature::raw_t update (int slot, Temperature::raw_t raw, uint32_t t_ms)
+        {
+            int32_t x = (int32_t)raw << FRACTION_BITS;
+
+            if (samples[slot] == 0) {
+                ema[slot] = x;
+                noise[slot] = 0;
+                rate[slot] = 0;
+                out[slot] = raw;
+                prev_min[slot] = raw;
+                prev_max[slot] = raw;
+                block_n[slot] = 0;
+            }
+            else {
+                ema[slot] += (x - ema[slot]) >> EMA_SHIFT;
+
+                int32_t dev = x - ema[slot];
+                dev = (dev < 0) ? -dev : dev;
+                noise[slot] += (dev - noise[slot]) >> NOISE_SHIFT;
+
+                int32_t away = ema[slot] - ((int32_t)out[slot] << FRACTION_BITS);
+                if ((away > (3 * ONE / 4)) || (away < -(3 * ONE / 4))) {
+                    out[slot] = (ema[slot] + ONE / 2) >> FRACTION_BITS;
+                }
+            }
+            if (samples[slot] < UINT16_MAX) {
+                samples[slot]++;
+            }
+
+            if (block_n[slot] == 0) {
+                // A new block starts with this reading
+                if (samples[slot] > 1) {
+                    prev_min[slot] = cur_min[slot];
+                    prev_max[slot] = cur_max[slot];
+                    int32_t dt_ms = t_ms - block_t_ms[slot];
+                    if (dt_ms > 0) {
+                        rate[slot] = (int32_t)(((int64_t)(ema[slot] - block_ema[slot]) * 60000) / dt_ms);
+                    }
+                }
+                cur_min[slot] = raw;
+                cur_max[slot] = raw;
+                block_ema[slot] = ema[slot];
+                block_t_ms[slot] = t_ms;
+            }
+            else {
+                cur_min[slot] = (raw < cur_min[slot]) ? raw : cur_min[slot];
+                cur_max[slot] = (raw > cur_max[slot]) ? raw : cur_max[slot];
+            }
+            if (++block_n[slot] == WINDOW) {
+                block_n[slot] = 0;
+            }
+
+            return out[slot];
+        }
+
+        uint32_t count (int slot) const { return samples[slot]; }
+
+        Temperature::raw_t filtered (int slot) const { return out[slot]; }
+
+        Temperature::centi_t average_centi (int slot) const { return Q8ToCentiC::apply(ema[slot]); }
+        Temperature::centi_t noise_centi (int slot) const { return Q8ToCentiC::apply(noise[slot]); }
+        Temperature::centi_t rate_centi_per_min (int slot) const { return Q8ToCentiC::apply(rate[slot]); }
+
+        Temperature::centi_t min_centi (int slot) const
+        {
+            return Temperature::RawToCentiC::apply((cur_min[slot] < prev_min[slot]) ? cur_min[slot] : prev_min[slot]);
+        }
+
+        Temperature::centi_t max_centi (int slot) const
+        {
+            return Temperature::RawToCentiC::apply((cur_max[slot] > prev_max[slot]) ? cur_max[slot] : prev_max[slot]);
+        }
+
+    private:
+        // Q8 1/16 C to 1/100 C
+        typedef Temperature::Scale<100, Temperature::RAW_PER_C * ONE> Q8ToCentiC;
+
+        int32_t ema[CAPACITY];                  // Q8
+        int32_t noise[CAPACITY];                // Q8
+        int32_t rate[CAPACITY];                 // Q8 per minute
+        int32_t block_ema[CAPACITY];            // the average when the current block started
+        uint32_t block_t_ms[CAPACITY];          // and when that was
+        Temperature::raw_t out[CAPACITY];
+        Temperature::raw_t cur_min[CAPACITY];
+        Temperature::raw_t cur_max[CAPACITY];
+        Temperature::raw_t prev_min[CAPACITY];
+        Temperature::raw_t prev_max[CAPACITY];
+        uint16_t block_n[CAPACITY];             // readings in the current block so far
+        uint16_t samples[CAPACITY];             // readings so far, stopping at UINT16_MAX
+};
@@ -0,0 +1,47 @@
+// Without a heap, the kernel asks the application for the memory of its own tasks:
+// an idle task for every core, and the timer service task.
+
+#include "StaticTasks.h"
+
+#if configSUPPORT_STATIC_ALLOCATION
+
+static StaticTask_t idle_tcb[configNUMBER_OF_CORES];
+static StackType_t idle_stack[configNUMBER_OF_CORES][configMINIMAL_STACK_SIZE];
+
+static StaticTask_t timer_tcb;
+static StackType_t timer_stack[configTIMER_TASK_STACK_DEPTH];
+
+extern "C" {
+
+// --------------------------------------------------------------------------------------------
+void vApplicationGetIdleTaskMemory (StaticTask_t **ppxIdleTaskTCBBuffer, StackType_t **ppxIdleTaskStackBuffer,
+                                    configSTACK_DEPTH_TYPE *puxIdleTaskStackSize)
+{
+    *ppxIdleTaskTCBBuffer = &idle_tcb[0];
+    *ppxIdleTaskStackBuffer = idle_stack[0];
+    *puxIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
+#if (configNUMBER_OF_CORES > 1)
+// The idle tasks for the other cores
+void vApplicationGetPassiveIdleTaskMemory (StaticTask_t **ppxIdleTaskTCBBuffer, StackType_t **ppxIdleTaskStackBuffer,
+                                           configSTACK_DEPTH_TYPE *puxIdleTaskStackSize, BaseType_t xPassiveIdleTaskIndex)
+{
+    *ppxIdleTaskTCBBuffer = &idle_tcb[1 + xPassiveIdleTaskIndex];
+    *ppxIdleTaskStackBuffer = idle_stack[1 + xPassiveIdleTaskIndex];
+    *puxIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+#endif
+
+// --------------------------------------------------------------------------------------------
+void vApplicationGetTimerTaskMemory (StaticTask_t **ppxTimerTaskTCBBuffer, StackType_t **ppxTimerTaskStackBuffer,
+                                     configSTACK_DEPTH_TYPE *puxTimerTaskStackSize)
+{
+    *ppxTimerTaskTCBBuffer = &timer_tcb;
+    *ppxTimerTaskStackBuffer = timer_stack;
+    *puxTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+
+}
+
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+// The memory for a group of COUNT tasks that each get a stack of STACK_WORDS.
+//
+// In the static allocation build (-DSTATIC_ALLOCATION=1) every stack and TCB is a statically sized
+// array, so the whole task table is laid out by the linker and there is no heap at all.
+// Otherwise, the same calls fall back to xTaskCreate() and the heap.
+//
+// Declaring one TaskGroup per kind of task makes the task table a compile-time object: its exact
+// size is known before anything runs (see taskRamBytes() below), and creating a task cannot fail
+// for lack of memory.
+template <uint32_t STACK_WORDS, uint32_t COUNT = 1>
+class TaskGroup {
+    public:
+        static constexpr uint32_t STACK_DEPTH = STACK_WORDS;
+        static constexpr uint32_t TASKS = COUNT;
+
+        // The RAM that the group takes: stacks plus TCBs
+        static constexpr size_t RAM_BYTES = COUNT * (STACK_WORDS * sizeof(StackType_t) + sizeof(StaticTask_t));
+
+        // Create task 'i' of the group. Returns nullptr if it could not be created.
+        TaskHandle_t create (uint32_t i, TaskFunction_t code, const char *name, void *arg, UBaseType_t priority)
+        {
+            if (i >= COUNT) {
+                return nullptr;
+            }
+            #if configSUPPORT_STATIC_ALLOCATION
+                return xTaskCreateStatic(code, name, STACK_WORDS, arg, priority, memory[i].stack, &memory[i].tcb);
+            #else
+                TaskHandle_t task;
+                return (xTaskCreate(code, name, STACK_WORDS, arg, priority, &task) == pdPASS) ? task : nullptr;
+            #endif
+        }
+
+    private:
+        #if configSUPPORT_STATIC_ALLOCATION
+            struct {
+                StackType_t stack[STACK_WORDS];
+                StaticTask_t tcb;
+            } memory[COUNT];
+        #endif
+};
+
+// The RAM taken by a whole set of task groups, worked out at compile time
+template <typename... GROUPS>
+constexpr size_t taskRamBytes ()
+{
+    return (GROUPS::RAM_BYTES + ... + 0);
+}
+
+// The RAM taken by the kernel's own idle and timer tasks (see StaticTasks.cpp)
+constexpr size_t kernelTaskRamBytes ()
+{
+    return (configNUMBER_OF_CORES + 1) * sizeof(StaticTask_t) +
+           (configNUMBER_OF_CORES * configMINIMAL_STACK_SIZE + configTIMER_TASK_STACK_DEPTH) * sizeof(StackType_t);
+}
@@ -0,0 +1,56 @@
+#include "TaskStats.h"
+
+#include <inttypes.h>
+
+#include "pico/stdlib.h"
+
+#include "Trace.h"
+
+// --------------------------------------------------------------------------------------------
+// The kernel's run time counter (portGET_RUN_TIME_COUNTER_VALUE in FreeRTOSConfig.h)
+extern "C" uint64_t ptwdRunTimeCounter (void)
+{
+    return time_us_64();
+}
+
+// --------------------------------------------------------------------------------------------
+uint64_t TaskStats::previousRunTime (TaskHandle_t handle)
+{
+    for (uint32_t i = 0; i < previous_count; i++) {
+        if (previous[i].handle == handle) {
+            return previous[i].run_time;
+        }
+    }
+    return 0;
+}
+
+// Gathering the task states suspends the scheduler while the kernel walks every stack to find its
+// high-water mark, so this is not something to do on every scan.
+void TaskStats::print ()
+{
+    UBaseType_t count = uxTaskGetSystemState(status, MAX_TASKS, nullptr);
+    if (count == 0) {
+        TRACE("%s: more than %u tasks\n", __FUNCTION__, (uint32_t)MAX_TASKS);
+        return;
+    }
+
+    uint64_t now = ptwdRunTimeCounter();
+    uint64_t elapsed = now - previous_time;
+    TRACE("%s: %u tasks over the last %" PRIu64 " mSec\n", __FUNCTION__, (uint32_t)count, elapsed / 1000);
+    TRACE("  %-16s %4s %7s %11s\n", "task", "prio", "cpu", "stack free");
+    for (UBaseType_t i = 0; i < count; i++) {
+        const TaskStatus_t &t = status[i];
+        uint64_t used = t.ulRunTimeCounter - previousRunTime(t.xHandle);
+        uint32_t permille = (elapsed > 0) ? (uint32_t)((used * 1000) / elapsed) : 0;
+        TRACE("  %-16s %4u %5u.%u%% %11u\n",
+               t.pcTaskName, (uint32_t)t.uxCurrentPriority, permille / 10, permille % 10,
+               (uint32_t)(t.usStackHighWaterMark * sizeof(StackType_t)));
+    }
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        previous[i].handle = status[i].xHandle;
+        previous[i].run_time = status[i].ulRunTimeCounter;
+    }
+    previous_count = count;
+    previous_time = now;
+}
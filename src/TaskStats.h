@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+// Per-task CPU usage and stack high-water marks, from the FreeRTOS run time stats.
+//
+// The kernel's run time counter is the 64-bit microsecond timer, so the counters never wrap and
+// there is no extra timer interrupt: the kernel reads the timer once per context switch.
+// Each call to print() shows what every task did since the previous call.
+class TaskStats {
+    public:
+        // Enough for 12 bus tasks, the other application tasks, and the kernel's idle and timer tasks
+        static const uint32_t MAX_TASKS = 24;
+
+        // Print one line per task: its share of a core since the last call (100% is one whole core,
+        // so the total across all tasks is 100% per core), and the least free stack space it has ever had.
+        void print ();
+
+    private:
+        uint64_t previousRunTime (TaskHandle_t handle);
+
+        TaskStatus_t status[MAX_TASKS];
+
+        struct {
+            TaskHandle_t handle;
+            uint64_t run_time;
+        } previous[MAX_TASKS];
+        uint32_t previous_count;
+        uint64_t previous_time;
+};
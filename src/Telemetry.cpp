@@ -0,0 +1,101 @@
+#include "Telemetry.h"
+
+#include "SEGGER_RTT.h"
+
+#include "Crc8.h"
+
+// --------------------------------------------------------------------------------------------
+// A frame that does not fit in the RTT buffer gets dropped rather than blocking the caller
+// until the debugger catches up.
+bool Telemetry::init ()
+{
+    seq = 0;
+    length = 0;
+    return SEGGER_RTT_ConfigUpBuffer(RTT_BUFFER, "ptwd-telemetry", rtt_buffer, sizeof(rtt_buffer),
+                                     SEGGER_RTT_MODE_NO_BLOCK_SKIP) >= 0;
+}
+
+void Telemetry::startFrame (uint8_t type)
+{
+    frame[0] = SYNC;
+    frame[1] = type;
+    length = HEADER_SIZE;
+}
+
+// The sequence number counts every frame, sent or not, so that the decoder sees the gap
+bool Telemetry::sendFrame ()
+{
+    frame[2] = seq++;
+    frame[3] = length - HEADER_SIZE;
+    frame[length] = crc8(&frame[1], length - 1);
+    length++;
+
+    bool sent = (SEGGER_RTT_Write(RTT_BUFFER, frame, length) == length);
+    length = 0;
+    return sent;
+}
+
+// --------------------------------------------------------------------------------------------
+void Telemetry::beginSamples (uint32_t bus, uint32_t timestamp_ms)
+{
+    sample_bus = bus;
+    sample_timestamp_ms = timestamp_ms;
+    sample_ok = true;
+
+    startFrame(TYPE_SAMPLES);
+    frame[length++] = bus;
+    for (int i = 0; i < 4; i++) {
+        frame[length++] = timestamp_ms >> (8 * i);
+    }
+}
+
+void Telemetry::addSample (uint32_t index, int32_t raw, int32_t prev)
+{
+    // Worst case: 2 maximum length varints
+    if ((length + 10) > (HEADER_SIZE + MAX_PAYLOAD)) {
+        sample_ok &= sendFrame();
+        beginSamples(sample_bus, sample_timestamp_ms);
+    }
+
+    bool absolute = (prev == NO_PREVIOUS);
+    length += putVarint(&frame[length], (index << 1) | (absolute ? 1 : 0));
+    length += putVarint(&frame[length], zigzag(absolute ? raw : raw - prev));
+}
+
+bool Telemetry::endSamples ()
+{
+    // An empty frame is not worth sending
+    if (length > (HEADER_SIZE + 5)) {
+        sample_ok &= sendFrame();
+    }
+    length = 0;
+    return sample_ok;
+}
+
+// --------------------------------------------------------------------------------------------
+bool Telemetry::sendRoms (uint32_t bus, const uint64_t *roms, uint32_t count)
+{
+    bool ok = true;
+    uint32_t i = 0;
+    do {
+        startFrame(TYPE_ROMS);
+        frame[length++] = bus;
+        length += putVarint(&frame[length], i);
+        while ((i < count) && ((length + 8) <= (HEADER_SIZE + MAX_PAYLOAD))) {
+            for (int b = 0; b < 8; b++) {
+                frame[length++] = roms[i] >> (8 * b);
+            }
+            i++;
+        }
+        ok &= sendFrame();
+    } while (i < count);
+    return ok;
+}
+
+bool Telemetry::sendOverflow (uint32_t bus, uint32_t total)
+{
+    startFrame(TYPE_OVERFLOW);
+    frame[length++] = bus;
+    length += putVarint(&frame[length], total);
+    return sendFrame();
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <stdint.h>
+
+// Binary telemetry: readings get sent as compact frames on their own RTT up-buffer instead of
+// as formatted text on the console. A reading that changed costs about 2 bytes instead of a
+// 60 byte printf line, and the target never has to convert a temperature to a string.
+// host/tools/ptwd-decode.cpp (built by the host build) turns a capture back into CSV or JSON.
+//
+// Every frame looks like this:
+//   SYNC  type  seq  len  payload[len]  crc
+// 'seq' counts frames, so the decoder can tell when frames went missing.
+// 'crc' is the Onewire CRC8 of everything from 'type' to the end of the payload.
+//
+// Payloads are built from varints: 7 bits per byte, least significant group first, with the
+// top bit set on every byte except the last. Signed values get zig-zag encoded first so that
+// small negative numbers stay small.
+//
+//   TYPE_SAMPLES   bus, timestamp_ms (4 bytes LE), then per reading:
+//                      varint(index << 1 | absolute), varint(zigzag(value))
+//                  An absolute reading carries the raw temperature itself. Otherwise it carries
+//                  the difference from the previous reading of the same sensor.
+//   TYPE_ROMS      bus, varint(first index), then 8 byte ROM codes (LE) for consecutive indexes
+//   TYPE_OVERFLOW  bus, varint(total readings dropped by the bus so far)
+class Telemetry {
+    public:
+        static const uint8_t SYNC = 0xA5;
+        static const uint8_t TYPE_SAMPLES = 1;
+        static const uint8_t TYPE_ROMS = 2;
+        static const uint8_t TYPE_OVERFLOW = 3;
+
+        static const uint32_t HEADER_SIZE = 4;
+        static const uint32_t MAX_PAYLOAD = 255;
+
+        // stdio owns RTT up-buffer 0
+        static const unsigned RTT_BUFFER = 1;
+
+        static const int32_t NO_PREVIOUS = INT32_MIN;
+
+        bool init ();
+
+        // Readings get collected into a frame for one bus at a time. A frame that fills up gets sent
+        // and another one started automatically. endSamples() returns false if any frame since
+        // beginSamples() could not be sent. The decoder then has the wrong baseline for the
+        // readings in it, so the caller must send them as absolute values next time.
+        // 'prev' is the previous raw value the decoder got for this sensor, or NO_PREVIOUS to send an absolute reading.
+        // Raw values are signed, so -1 is a perfectly good temperature.
+        void beginSamples (uint32_t bus, uint32_t timestamp_ms);
+        void addSample (uint32_t index, int32_t raw, int32_t prev);
+        bool endSamples ();
+
+        // The ROM codes of the sensors on a bus, so the decoder can tell which sensor an index refers to
+        bool sendRoms (uint32_t bus, const uint64_t *roms, uint32_t count);
+
+        bool sendOverflow (uint32_t bus, uint32_t total);
+
+        // ------------------------------------------------------------------------------------
+        // The encoding, shared with the host decoder
+
+        static uint32_t zigzag (int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+        static int32_t unzigzag (uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+        // Returns the number of bytes written (at most 5)
+        static uint32_t putVarint (uint8_t *p, uint32_t v)
+        {
+            uint32_t n = 0;
+            while (v >= 0x80) {
+                p[n++] = (v & 0x7F) | 0x80;
+                v >>= 7;
+            }
+            p[n++] = v;
+            return n;
+        }
+
+        // Returns the number of bytes used, or 0 if the varint runs past 'len' or is too long
+        static uint32_t getVarint (const uint8_t *p, uint32_t len, uint32_t *v)
+        {
+            *v = 0;
+            for (uint32_t n = 0; (n < len) && (n < 5); n++) {
+                *v |= (uint32_t)(p[n] & 0x7F) << (7 * n);
+                if ((p[n] & 0x80) == 0) {
+                    return n + 1;
+                }
+            }
+            return 0;
+        }
+
+    private:
+        void startFrame (uint8_t type);
+        bool sendFrame ();
+
+        uint8_t frame[HEADER_SIZE + MAX_PAYLOAD + 1];
+        uint32_t length;
+        uint8_t seq;
+
+        // The samples frame being built
+        uint32_t sample_bus;
+        uint32_t sample_timestamp_ms;
+        bool sample_ok;
+
+        uint8_t rtt_buffer[2048];
+};
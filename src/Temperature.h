@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Integer temperature arithmetic. The sensor loop never touches a float: the RP2040 has no FPU,
+// so every float operation there is a soft-float library call, and the RP2350 build does not
+// save FPU context between tasks anyway (configENABLE_FPU is 0).
+//
+// A DS18B20 reports a signed Q12.4 number: 1/16ths of a degree C in a 16-bit two's complement
+// register. Everything downstream works in hundredths of a degree ("centi-degrees"), C or F.
+// Conversions between the two are Scale<> types, so the multiplier, divisor and offset are
+// reduced at compile time and a power of 2 divisor turns into a shift.
+namespace Temperature {
+
+    // 1/16 C, straight out of scratchpad bytes 0 and 1
+    typedef int16_t raw_t;
+
+    // 1/100 of a degree, C or F
+    typedef int32_t centi_t;
+
+    static const int32_t RAW_PER_C = 16;
+
+    constexpr int32_t gcd (int32_t a, int32_t b) { return (b == 0) ? a : gcd(b, a % b); }
+
+    // v * NUM / DEN + OFFSET, rounded to the nearest integer with ties going up.
+    // Rounding is the same on both sides of zero, so negative temperatures do not get a bias of their own.
+    template <int32_t NUM, int32_t DEN, int32_t OFFSET = 0>
+    struct Scale {
+        static_assert((NUM > 0) && (DEN > 0), "Scale factors must be positive");
+
+        static constexpr int32_t G = gcd(NUM, DEN);
+        static constexpr int32_t N = NUM / G;
+        static constexpr int32_t D = DEN / G;
+
+        static constexpr int32_t apply (int32_t v)
+        {
+            // Arithmetic shift right floors, so adding half of D first gives the rounding
+            return ((D & (D - 1)) == 0) ? ((v * N + D / 2) >> log2(D)) + OFFSET
+                                        : floorDiv(v * N + D / 2, D) + OFFSET;
+        }
+
+        private:
+            static constexpr int32_t log2 (int32_t d) { return (d <= 1) ? 0 : 1 + log2(d >> 1); }
+            static constexpr int32_t floorDiv (int32_t a, int32_t d) { return (a >= 0) ? a / d : -((-a + d - 1) / d); }
+    };
+
+    // 1/16 C to 1/100 C: 100/16 reduces to 25/4
+    typedef Scale<100, RAW_PER_C> RawToCentiC;
+
+    // 1/16 C to 1/100 F: 9/5 * 100/16 reduces to 45/4, then 32 F
+    typedef Scale<900, 5 * RAW_PER_C, 3200> RawToCentiF;
+
+    // 1/100 C to 1/16 C
+    typedef Scale<RAW_PER_C, 100> CentiCToRaw;
+
+    // The whole degrees C part of a reading, rounded down. This is what a DS18B20 compares to its TH and TL alarm thresholds.
+    inline int32_t wholeC (raw_t raw) { return raw >> 4; }
+
+    // The floating point edge: formats centi-degrees as "-12.34" without going through a float
+    inline int formatCenti (char *buf, size_t size, centi_t centi)
+    {
+        uint32_t magnitude = (centi < 0) ? -(uint32_t)centi : centi;
+        return snprintf(buf, size, "%s%u.%02u", (centi < 0) ? "-" : "", (unsigned)(magnitude / 100), (unsigned)(magnitude % 100));
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Temperature.h"
+
+// The work the report task does with each reading, written two ways so they can be timed against
+// each other: the change check against the previous reading, then conversion to degrees C and F.
+// floatPipeline() is the code that Temperature.h replaced, unsigned raw value bug and all.
+// The results get stored through 'sink' so that the compiler cannot optimize the work away.
+//
+// Used by host/tools/ptwd-bench-temp.cpp, and on the target when built with -DTEMPERATURE_BENCHMARK=1.
+namespace TemperatureBench {
+
+    // A repeatable walk through the range of a real sensor, -55C to +125C, in steps of up to 2/16 C
+    inline void makeReadings (Temperature::raw_t *raw, uint32_t count)
+    {
+        int32_t t = 20 * Temperature::RAW_PER_C;
+        uint32_t seed = 12345;
+        for (uint32_t i = 0; i < count; i++) {
+            seed = seed * 1103515245 + 12345;
+            t += (int32_t)((seed >> 16) % 5) - 2;
+            if (t > 125 * Temperature::RAW_PER_C) {
+                t = 125 * Temperature::RAW_PER_C;
+            }
+            if (t < -55 * Temperature::RAW_PER_C) {
+                t = -55 * Temperature::RAW_PER_C;
+            }
+            raw[i] = t;
+        }
+    }
+
+    inline void floatPipeline (const Temperature::raw_t *raw, uint32_t count, volatile float *sink)
+    {
+        uint16_t prev = 0xFFFF;
+        for (uint32_t i = 0; i < count; i++) {
+            uint16_t rawtemp = raw[i];
+            if (rawtemp == prev) {
+                continue;
+            }
+            prev = rawtemp;
+            float t_C = (float)rawtemp / 16.0f;
+            *sink = t_C;
+            *sink = ((t_C * 9.0f)/5.0f)+32.0f;
+        }
+    }
+
+    inline void integerPipeline (const Temperature::raw_t *raw, uint32_t count, volatile int32_t *sink)
+    {
+        int32_t prev = INT32_MIN;
+        for (uint32_t i = 0; i < count; i++) {
+            int32_t rawtemp = raw[i];
+            if (rawtemp == prev) {
+                continue;
+            }
+            prev = rawtemp;
+            *sink = Temperature::RawToCentiC::apply(rawtemp);
+            *sink = Temperature::RawToCentiF::apply(rawtemp);
+        }
+    }
+}
@@ -0,0 +1,120 @@
+#include "TicklessIdle.h"
+
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "hardware/structs/scb.h"
+#include "hardware/structs/systick.h"
+
+// The SysTick enable bit and the ICSR "SysTick pending" bit are the same on the M0+ and the M33
+static const uint32_t SYST_CSR_ENABLE = 1u << 0;
+static const uint32_t ICSR_PENDSTSET = 1u << 26;
+
+// SysTick counts the 1 MHz reference (configSYSTICK_CLOCK_HZ), so one count is one uSec
+static const uint32_t TICK_US = configSYSTICK_CLOCK_HZ / configTICK_RATE_HZ;
+
+static volatile bool alarm_fired;
+
+void TicklessIdle::alarmFired (uint alarm_num)
+{
+    (void)alarm_num;
+    alarm_fired = true;
+}
+
+// --------------------------------------------------------------------------------------------
+void TicklessIdle::init ()
+{
+    alarm = hardware_alarm_claim_unused(true);
+    hardware_alarm_set_callback(alarm, alarmFired);
+}
+
+// SysTick only loads a new period when its count runs out. Clearing the count makes it load the
+// partial period on its next 1 MHz clock, and the full period goes back in once it has done so.
+void TicklessIdle::restartTick (uint32_t next_tick_us)
+{
+    if (next_tick_us < 2) {
+        next_tick_us = 2;
+    }
+    systick_hw->rvr = next_tick_us - 1;
+    systick_hw->cvr = 0;
+    systick_hw->csr |= SYST_CSR_ENABLE;
+    while (systick_hw->cvr == 0) {
+    }
+    systick_hw->rvr = TICK_US - 1;
+}
+
+// --------------------------------------------------------------------------------------------
+void TicklessIdle::sleep (TickType_t expected)
+{
+    uint32_t save = save_and_disable_interrupts();
+
+    // Stop the tick. What is left of the current tick period stays in the counter.
+    systick_hw->csr &= ~SYST_CSR_ENABLE;
+    uint32_t remaining_us = systick_hw->cvr;
+    uint64_t start_us = time_us_64();
+
+    // A tick that is already due, or a task that an interrupt readied since the kernel decided to
+    // sleep, calls it off. Carrying on from where the tick stopped costs a fraction of a uSec.
+    if ((remaining_us == 0) || (scb_hw->icsr & ICSR_PENDSTSET) || (eTaskConfirmSleepModeStatus() == eAbortSleep)) {
+        systick_hw->csr |= SYST_CSR_ENABLE;
+        restore_interrupts(save);
+        return;
+    }
+
+    // Ticks that went by during an earlier sleep, but that could not be stepped over then without
+    // going past a task's deadline. That task has had its turn since, so they go in first.
+    if (late_ticks > 0) {
+        TickType_t ticks = (late_ticks < expected) ? late_ticks : expected;
+        vTaskStepTick(ticks);
+        late_ticks -= ticks;
+        suppressed_ticks.store(suppressedTicks() + ticks, std::memory_order_relaxed);
+        expected -= ticks;
+        if (expected == 0) {
+            systick_hw->csr |= SYST_CSR_ENABLE;
+            restore_interrupts(save);
+            return;
+        }
+    }
+
+    // The tick at the end of the current period is tick 1. The next task is due at tick 'expected'.
+    uint64_t next_tick_us = start_us + remaining_us;
+    uint64_t wake_us = next_tick_us + (uint64_t)(expected - 1) * TICK_US;
+    alarm_fired = false;
+    if (!hardware_alarm_set_target(alarm, from_us_since_boot(wake_us))) {
+        __dsb();
+        __wfi();
+        __isb();
+    }
+
+    // Let whatever woke us up run its handler, then shut interrupts off again for the fixup
+    restore_interrupts(save);
+    save = save_and_disable_interrupts();
+    hardware_alarm_cancel(alarm);
+    uint64_t now_us = time_us_64();
+
+    // Count the ticks that went by, and restart SysTick so the next one lands where it would have.
+    // Interrupts would have to be held off for a whole tick for the alarm to be late enough to
+    // go past tick 'expected'. Stepping over the next task's deadline would skip it, so only the
+    // ticks up to there get stepped now, and the rest wait for the next sleep.
+    uint32_t ticks = 0;
+    if (now_us >= next_tick_us) {
+        ticks = 1 + (now_us - next_tick_us) / TICK_US;
+        next_tick_us += (uint64_t)ticks * TICK_US;
+        if (ticks > expected) {
+            late_ticks += ticks - expected;
+            ticks = expected;
+        }
+    }
+    restartTick(next_tick_us - now_us);
+    if (ticks > 0) {
+        vTaskStepTick(ticks);
+    }
+    restore_interrupts(save);
+
+    total_sleep_us += now_us - start_us;
+    sleep_count.store(sleeps() + 1, std::memory_order_relaxed);
+    if (alarm_fired) {
+        alarm_wakeups.store(alarmWakeups() + 1, std::memory_order_relaxed);
+    }
+    sleep_ms.store(total_sleep_us / 1000, std::memory_order_relaxed);
+    suppressed_ticks.store(suppressedTicks() + ticks, std::memory_order_relaxed);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "hardware/timer.h"
+
+// Tickless idle for the tick core (configUSE_TICKLESS_IDLE 2, see portSUPPRESS_TICKS_AND_SLEEP).
+//
+// When the idle task finds that no task needs to run for a while, sleep() stops SysTick, sets one
+// of the timer's alarms for the tick where the next task is due, and sleeps until an interrupt
+// comes in. On the way out, it works out from the 64-bit uSec timer how many tick periods went by,
+// steps the kernel's tick count forward by that many, and restarts SysTick in step with the ticks
+// it missed, so xTaskDelayUntil() deadlines land on exactly the same uSec as if the tick had kept
+// running. Neither the timer nor SysTick's 1 MHz reference depend on clk_sys, so the clock
+// governor can run the core as slowly as it likes in the meantime.
+//
+// The counters show how often the tick core woke up, and why.
+class TicklessIdle {
+    public:
+        // Claims an alarm, and enables its interrupt on the calling core: call this on the tick core
+        void init ();
+
+        // Sleep for up to 'expected' ticks. Called from the idle task, with the scheduler suspended.
+        void sleep (TickType_t expected);
+
+        // Everything since the scheduler started
+        uint32_t sleeps () const { return sleep_count.load(std::memory_order_relaxed); }
+        uint32_t alarmWakeups () const { return alarm_wakeups.load(std::memory_order_relaxed); }
+        uint32_t asleep_ms () const { return sleep_ms.load(std::memory_order_relaxed); }
+        uint32_t suppressedTicks () const { return suppressed_ticks.load(std::memory_order_relaxed); }
+
+        // The tick interrupts that really happened, and every way the tick core woke up
+        uint32_t tickInterrupts () const { return xTaskGetTickCount() - suppressedTicks(); }
+        uint32_t wakeups () const { return tickInterrupts() + sleeps(); }
+
+    private:
+        static void alarmFired (uint alarm_num);
+        void restartTick (uint32_t next_tick_us);
+
+        int alarm;
+
+        // Only the tick core's idle task writes these
+        uint64_t total_sleep_us;
+        TickType_t late_ticks;
+        std::atomic<uint32_t> sleep_count {0};
+        std::atomic<uint32_t> alarm_wakeups {0};
+        std::atomic<uint32_t> sleep_ms {0};
+        std::atomic<uint32_t> suppressed_ticks {0};
+};
@@ -0,0 +1,99 @@
+#include "Trace.h"
+
+#include "SEGGER_RTT.h"
+
+// --------------------------------------------------------------------------------------------
+// A record that does not fit in the RTT buffer stays in its trace buffer until the next drain()
+bool Trace::init ()
+{
+    for (uint32_t c = 0; c < CORES; c++) {
+        sent_dropped[c] = 0;
+    }
+    return SEGGER_RTT_ConfigUpBuffer(RTT_BUFFER, "ptwd-trace", rtt_buffer, sizeof(rtt_buffer),
+                                     SEGGER_RTT_MODE_NO_BLOCK_SKIP) >= 0;
+}
+
+uint32_t Trace::dropped () const
+{
+    uint32_t total = 0;
+    for (uint32_t c = 0; c < CORES; c++) {
+        total += buffers[c].dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+// --------------------------------------------------------------------------------------------
+// The oldest record in a core's buffer, or nullptr if it is empty
+const TraceFormat::record_header_t *Trace::peek (uint32_t core)
+{
+    buffer_t &b = buffers[core];
+    uint32_t tail = b.tail.load(std::memory_order_relaxed);
+    uint32_t head = b.head.load(std::memory_order_acquire);
+    if (tail == head) {
+        return nullptr;
+    }
+    uint32_t at = tail & (TRACE_BUFFER_SIZE - 1);
+    if (b.data[at] == 0) {
+        // The producer skipped the rest of the buffer
+        tail += TRACE_BUFFER_SIZE - at;
+        b.tail.store(tail, std::memory_order_release);
+        if (tail == head) {
+            return nullptr;
+        }
+        at = 0;
+    }
+    return (const TraceFormat::record_header_t *)&b.data[at];
+}
+
+// Tell the host how many records a core has dropped since boot, if that changed since the last time
+bool Trace::sendDropped (uint32_t core)
+{
+    uint32_t total = buffers[core].dropped.load(std::memory_order_relaxed);
+    if (total == sent_dropped[core]) {
+        return true;
+    }
+
+    struct {
+        TraceFormat::record_header_t header;
+        uint32_t total;
+    } record = {{sizeof(record), (uint8_t)core, TraceFormat::DROPPED, time_us_32()}, total};
+    if (SEGGER_RTT_Write(RTT_BUFFER, &record, sizeof(record)) != sizeof(record)) {
+        return false;
+    }
+    sent_dropped[core] = total;
+    return true;
+}
+
+// --------------------------------------------------------------------------------------------
+void Trace::drain ()
+{
+    for (uint32_t c = 0; c < CORES; c++) {
+        if (!sendDropped(c)) {
+            return;
+        }
+    }
+
+    while (1) {
+        // Whichever core has the oldest record goes next
+        const TraceFormat::record_header_t *oldest = nullptr;
+        uint32_t core = 0;
+        for (uint32_t c = 0; c < CORES; c++) {
+            const TraceFormat::record_header_t *r = peek(c);
+            if (r && (!oldest || ((int32_t)(r->time_us - oldest->time_us) < 0))) {
+                oldest = r;
+                core = c;
+            }
+        }
+        if (!oldest) {
+            return;
+        }
+        if (SEGGER_RTT_Write(RTT_BUFFER, oldest, oldest->size) != oldest->size) {
+            return;
+        }
+
+        // The record has been copied out, so the producer can have its space back
+        buffer_t &b = buffers[core];
+        uint32_t tail = b.tail.load(std::memory_order_relaxed);
+        b.tail.store(tail + oldest->size, std::memory_order_release);
+    }
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <type_traits>
+
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+#include "TraceFormat.h"
+
+// Each core's trace buffer holds this many bytes of records until the next drain(). It must be a power of 2.
+#ifndef TRACE_BUFFER_SIZE
+    #define TRACE_BUFFER_SIZE 4096
+#endif
+
+// The start of the section that the linker collects every TRACE_WRITE() site into
+extern "C" const uint8_t __start_ptwd_trace[];
+
+// A binary trace with deferred formatting: printf without the formatting. See TraceFormat.h for the format.
+//
+// TRACE_WRITE(tracer, fmt, args...) takes the same format strings and arguments as printf, but
+// the format string never gets used on the target. It goes into the ptwd_trace section along with
+// the types of the arguments, which are worked out at compile time. All that the call does at
+// run time is copy its arguments into a record, raw, with its site and a timestamp. So it costs
+// the same few dozen cycles whatever the format asks for: a '%8u' costs as much as a '%u', and
+// a string in flash (a literal or __FUNCTION__) is only passed as its address. Only strings in
+// RAM get copied, up to TraceFormat::MAX_STRING characters.
+//
+// Each core has its own buffer of records. The caller only holds off interrupts on its own core
+// while it writes its record, which also keeps it from being switched out, or moved to the other
+// core, halfway through. The cores never wait for each other: each buffer is a ring with one
+// producer (its core) and one consumer (whichever task calls drain()), just like a SampleRing.
+// When a buffer is full, records get dropped and counted, and never block the caller.
+//
+// drain() sends the records to an RTT up-buffer, oldest first across both cores. The host's
+// ptwd-trace tool reads the format strings out of the firmware's ELF file, and does the
+// formatting there.
+class Trace {
+    public:
+        static_assert((TRACE_BUFFER_SIZE & (TRACE_BUFFER_SIZE - 1)) == 0, "TRACE_BUFFER_SIZE must be a power of 2");
+
+        // stdio owns RTT up-buffer 0, the telemetry has buffer 1, and the flash log dumps have buffer 2
+        static const unsigned RTT_BUFFER = 3;
+
+        // RP2040 and RP2350 both have two
+        static const uint32_t CORES = 2;
+
+        // What a TRACE_WRITE() call site puts in the ptwd_trace section
+        template <uint32_t N>
+        struct site_t {
+            uint32_t types;
+            char format[N];
+        };
+
+        // The type of each argument, and all of them together as a site stores them
+        template <typename A>
+        static constexpr uint32_t typeOf ()
+        {
+            typedef typename std::remove_reference<A>::type T;
+            typedef typename std::decay<A>::type D;
+            if constexpr (std::is_array<T>::value && std::is_same<D, const char *>::value) {
+                return TraceFormat::TYPE_CONSTANT;
+            }
+            else if constexpr (std::is_same<D, const char *>::value || std::is_same<D, char *>::value) {
+                return TraceFormat::TYPE_STRING;
+            }
+            else if constexpr (std::is_floating_point<D>::value) {
+                return TraceFormat::TYPE_DOUBLE;
+            }
+            else {
+                static_assert(std::is_integral<D>::value || std::is_enum<D>::value, "TRACE_WRITE() cannot pass this type");
+                return (sizeof(D) <= 4) ? TraceFormat::TYPE_INT : TraceFormat::TYPE_INT64;
+            }
+        }
+
+        template <typename... A>
+        static constexpr uint32_t types ()
+        {
+            const uint32_t codes[] = {typeOf<A>()..., TraceFormat::TYPE_END};
+            uint32_t t = 0;
+            for (uint32_t i = 0; i < sizeof...(A); i++) {
+                t |= codes[i] << (i * TraceFormat::TYPE_BITS);
+            }
+            return t;
+        }
+
+        // The types of a call's arguments, for its site. Only ever used inside decltype().
+        template <typename... A>
+        struct signature_t {
+            static_assert(sizeof...(A) <= TraceFormat::MAX_ARGS, "too many arguments for TRACE_WRITE()");
+            static constexpr uint32_t value = types<A...>();
+        };
+        template <typename... A>
+        static signature_t<A...> signature (A &&...args);
+
+        // Lets the compiler check the arguments against the format string, just as it would for printf
+        static void check (const char *fmt, ...) __attribute__((format(__printf__, 1, 2))) { (void)fmt; }
+
+        // Returns false if the RTT buffer could not be set up
+        bool init ();
+
+        // ------------------------------------------------------------------------------------
+        // The producer side: any task or interrupt, on either core
+
+        template <typename... A>
+        void write (const void *site, A &&...args)
+        {
+            uint32_t size = sizeof(TraceFormat::record_header_t) + (0 + ... + argSize(args));
+
+            // Whole words, so that every record header is aligned
+            size = (size + 3) & ~3;
+
+            uint32_t status = save_and_disable_interrupts();
+            uint32_t core = get_core_num();
+            buffer_t &b = buffers[core];
+            uint8_t *p = reserve(b, size);
+            if (p) {
+                TraceFormat::record_header_t *header = (TraceFormat::record_header_t *)p;
+                header->size = size;
+                header->core = core;
+                header->site = ((const uint8_t *)site - __start_ptwd_trace) / TraceFormat::SITE_ALIGN;
+                header->time_us = time_us_32();
+                p += sizeof(TraceFormat::record_header_t);
+                (put(p, args), ...);
+                b.head.store(b.pending, std::memory_order_release);
+            }
+            restore_interrupts(status);
+        }
+
+        // ------------------------------------------------------------------------------------
+        // The consumer side: only ever one task at a time
+
+        // Send every record in the buffers over RTT, until the RTT buffer is full
+        void drain ();
+
+        // How many records have been dropped since boot
+        uint32_t dropped () const;
+
+    private:
+        typedef struct {
+            std::atomic<uint32_t> head {0};     // only the producer writes this
+            std::atomic<uint32_t> tail {0};     // only the consumer writes this
+            std::atomic<uint32_t> dropped {0};
+            uint32_t pending;                   // the producer's own: where the record being written ends
+            alignas(4) uint8_t data[TRACE_BUFFER_SIZE];
+        } buffer_t;
+
+        static uint32_t length (const char *s)
+        {
+            uint32_t n = 0;
+            while (s && (n < TraceFormat::MAX_STRING) && s[n]) {
+                n++;
+            }
+            return n;
+        }
+
+        template <typename A>
+        static uint32_t argSize (A &&arg)
+        {
+            constexpr uint32_t type = typeOf<A>();
+            if constexpr (type == TraceFormat::TYPE_STRING) {
+                return 1 + length(arg);
+            }
+            else {
+                return ((type == TraceFormat::TYPE_INT) || (type == TraceFormat::TYPE_CONSTANT)) ? 4 : 8;
+            }
+        }
+
+        template <typename A>
+        static void put (uint8_t *&p, A &&arg)
+        {
+            constexpr uint32_t type = typeOf<A>();
+            if constexpr (type == TraceFormat::TYPE_CONSTANT) {
+                int32_t offset = (const uint8_t *)arg - __start_ptwd_trace;
+                memcpy(p, &offset, 4);
+                p += 4;
+            }
+            else if constexpr (type == TraceFormat::TYPE_STRING) {
+                uint32_t n = length(arg);
+                *p++ = n;
+                memcpy(p, arg, n);
+                p += n;
+            }
+            else if constexpr (type == TraceFormat::TYPE_DOUBLE) {
+                double v = arg;
+                memcpy(p, &v, 8);
+                p += 8;
+            }
+            else if constexpr (type == TraceFormat::TYPE_INT64) {
+                uint64_t v = (uint64_t)arg;
+                memcpy(p, &v, 8);
+                p += 8;
+            }
+            else {
+                uint32_t v = (uint32_t)arg;
+                memcpy(p, &v, 4);
+                p += 4;
+            }
+        }
+
+        // Returns where a record of 'size' bytes goes, or nullptr (and counts a dropped record) if there
+        // is no room. A record never wraps around the end of the buffer: when it would, the rest of the
+        // buffer gets skipped, marked by a 0 where the next record's size would be.
+        static uint8_t *reserve (buffer_t &b, uint32_t size)
+        {
+            uint32_t head = b.head.load(std::memory_order_relaxed);
+            uint32_t at = head & (TRACE_BUFFER_SIZE - 1);
+            uint32_t skip = ((at + size) > TRACE_BUFFER_SIZE) ? (TRACE_BUFFER_SIZE - at) : 0;
+            if ((head + skip + size - b.tail.load(std::memory_order_acquire)) > TRACE_BUFFER_SIZE) {
+                b.dropped.store(b.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            if (skip) {
+                b.data[at] = 0;
+            }
+            b.pending = head + skip + size;
+            return &b.data[(head + skip) & (TRACE_BUFFER_SIZE - 1)];
+        }
+
+        const TraceFormat::record_header_t *peek (uint32_t core);
+        bool sendDropped (uint32_t core);
+
+        buffer_t buffers[CORES];
+
+        // The consumer's own
+        uint32_t sent_dropped[CORES];
+
+        uint8_t rtt_buffer[2048];
+};
+
+// Writes a record for this call site to 'tracer', a Trace. The site goes into the ptwd_trace section.
+#define TRACE_WRITE(tracer, fmt, ...)                                                                       \
+    do {                                                                                                    \
+        static const Trace::site_t<sizeof(fmt)> trace_site                                                  \
+            __attribute__((section("ptwd_trace"), used, aligned(TraceFormat::SITE_ALIGN))) =                \
+            {decltype(Trace::signature(__VA_ARGS__))::value, fmt};                                          \
+        if (0) {                                                                                            \
+            Trace::check(fmt, ##__VA_ARGS__);                                                               \
+        }                                                                                                   \
+        (tracer).write(&trace_site, ##__VA_ARGS__);                                                         \
+    } while (0)
+
+// Set to 1 to send every diagnostic in the firmware as a binary trace on RTT up-buffer 3 instead of as text on the
+// console. The target then never formats anything: each TRACE() only copies its arguments, and the host build's
+// ptwd-trace tool does the formatting from the firmware's ELF file.
+#ifndef BINARY_TRACE
+    #define BINARY_TRACE 0
+#endif
+
+// The firmware's one tracer, in main.cpp
+extern Trace trace;
+
+#if BINARY_TRACE
+    #define TRACE(fmt, ...) TRACE_WRITE(trace, fmt, ##__VA_ARGS__)
+#else
+    #define TRACE(fmt, ...) printf(fmt, ##__VA_ARGS__)
+#endif
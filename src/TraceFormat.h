@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+
+// The layout of the binary trace (see Trace.h), shared with the host formatter (host/tools/ptwd-trace.cpp).
+//
+// Every TRACE() call site puts its format string into the ptwd_trace section of the firmware's ELF
+// file, as a site: the types of its arguments (4 bytes LE), then the format string itself. Sites
+// are 4 byte aligned, and each one is known by its offset from the start of the section, in 4 byte units.
+// The section gets linked into flash like any other constant data, but nothing on the target ever
+// reads it: the host formatter gets the format strings from the ELF file instead.
+//
+// The types hold TYPE_BITS per argument, first argument in the lowest bits, and end at the first
+// TYPE_END. So a site can have up to MAX_ARGS arguments.
+//   TYPE_INT       4 bytes LE: any integer of 32 bits or less, signed or not, and bool or char
+//   TYPE_INT64     8 bytes LE
+//   TYPE_DOUBLE    8 bytes, IEEE 754 LE: floats get promoted, just as they would be for printf
+//   TYPE_STRING    length (1 byte), then that many characters, with no NUL: a string that was in RAM,
+//                  cut short at MAX_STRING characters
+//   TYPE_CONSTANT  4 bytes LE: a string in the image (a string literal or __FUNCTION__), as its
+//                  offset in bytes from the start of the ptwd_trace section
+//
+// Every record starts with a header, then the arguments are packed one after the other, without
+// any padding. A record with the site DROPPED carries a single TYPE_INT instead: the number of
+// records that the core has had to drop since boot, because its buffer was full.
+class TraceFormat {
+    public:
+        static const uint32_t TYPE_BITS = 3;
+        static const uint32_t TYPE_MASK = (1 << TYPE_BITS) - 1;
+        static const uint32_t MAX_ARGS = 32 / TYPE_BITS;
+
+        static const uint32_t TYPE_END = 0;
+        static const uint32_t TYPE_INT = 1;
+        static const uint32_t TYPE_INT64 = 2;
+        static const uint32_t TYPE_DOUBLE = 3;
+        static const uint32_t TYPE_STRING = 4;
+        static const uint32_t TYPE_CONSTANT = 5;
+
+        static const uint32_t MAX_STRING = 23;
+
+        static const uint32_t SITE_ALIGN = 4;
+        static const uint16_t DROPPED = 0xFFFF;
+
+        typedef struct {
+            uint8_t size;                       // of the whole record, header included
+            uint8_t core;
+            uint16_t site;
+            uint32_t time_us;
+        } record_header_t;
+
+        // The biggest a record can get: every argument a string of MAX_STRING characters
+        static const uint32_t MAX_RECORD = sizeof(record_header_t) + MAX_ARGS * (1 + MAX_STRING);
+        static_assert(MAX_RECORD <= UINT8_MAX, "a record's size must fit in its header");
+};
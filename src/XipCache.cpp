@@ -0,0 +1,24 @@
+#include "XipCache.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "hardware/structs/xip_ctrl.h"
+
+#include "HotPath.h"
+
+// The bus tasks take a sample every time they wake up
+XipCache::counts_t HOT_PATH(XipCache::sample) ()
+{
+    // Writing a counter clears it. The critical section keeps the other core from doing the same in between.
+    taskENTER_CRITICAL();
+    uint32_t accesses = xip_ctrl_hw->ctr_acc;
+    uint32_t hits = xip_ctrl_hw->ctr_hit;
+    xip_ctrl_hw->ctr_acc = 0;
+    xip_ctrl_hw->ctr_hit = 0;
+    totals.accesses += accesses;
+    totals.hits += hits;
+    counts_t c = totals;
+    taskEXIT_CRITICAL();
+    return c;
+}
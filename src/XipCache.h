@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+
+// The XIP cache's hit and access counters, which count every instruction fetch and data read from
+// flash on either core. The hardware counters are 32 bits, and saturate after about 28 seconds of
+// nothing but flash accesses at 150 MHz, so sample() has to be called more often than that: it moves
+// them into 64-bit totals. Every caller sees the same totals, so the difference between two samples
+// is what the whole chip did in the meantime.
+//
+// Reading both counters takes two bus reads, so an access in between can end up counted as a hit
+// and not an access, or the other way around. That is only ever off by one or two.
+class XipCache {
+    public:
+        typedef struct {
+            uint64_t accesses;
+            uint64_t hits;
+        } counts_t;
+
+        static uint64_t misses (const counts_t &c) { return (c.accesses > c.hits) ? (c.accesses - c.hits) : 0; }
+
+        // Any task, on either core
+        counts_t sample ();
+
+    private:
+        counts_t totals;
+};
@@ -6,4 +6,34 @@
 #define DS18B20_READ_SCRATCHPAD     0xbe
 #define DS18B20_COPY_SCRATCHPAD     0x48
 #define DS18B20_RECALL_EE           0xb8
-#define DS18B20_READ_POWER_SUPPLY   0xb4
\ No newline at end of file
+#define DS18B20_READ_POWER_SUPPLY   0xb4
+
+// The configuration register (scratchpad byte 4) holds the resolution in bits 6:5.
+// The other bits always read as 1's.
+#define DS18B20_SCRATCHPAD_CONFIG   4
+#define DS18B20_CONFIG(bits)        ((((bits) - 9) << 5) | 0x1F)
+#define DS18B20_CONFIG_BITS(config) ((((config) >> 5) & 3) + 9)
+
+// Maximum conversion time at each resolution: 93.75, 187.5, 375 or 750 mSec for 9 to 12 bits
+#define DS18B20_CONVERSION_US(bits) (750000 >> (12 - (bits)))
+
+// Until its first conversion, a sensor's scratchpad reads 85 C (0x0550), and a genuine DS18B20 has
+// 0x0C in byte 6. After a conversion, byte 6 holds 0x10 minus the low 4 bits of the reading.
+#define DS18B20_SCRATCHPAD_COUNT_REMAIN 6
+#define DS18B20_POWER_ON_LSB            0x50
+#define DS18B20_POWER_ON_MSB            0x05
+#define DS18B20_POWER_ON_COUNT_REMAIN   0x0C
+
+// The family code (the low byte of the ROM code) of the DS18B20, and of the parts that take the same
+// function commands: the DS1822 is a DS18B20 with looser accuracy, and the older DS18S20 has a fixed
+// 9-bit resolution. See DeviceFamily.h.
+#define DS18S20_FAMILY              0x10
+#define DS1822_FAMILY               0x22
+#define DS18B20_FAMILY              0x28
+
+// A DS18S20's temperature register holds half degrees, and 85 C (0x00AA) until its first conversion.
+// It has no configuration register: WRITE_SCRATCHPAD only takes TH and TL, and byte 4 always reads 0xFF.
+// Bytes 6 and 7 (COUNT_REMAIN and COUNT_PER_C) make up the rest of a 1/16 C reading.
+#define DS18S20_POWER_ON_LSB        0xAA
+#define DS18S20_POWER_ON_MSB        0x00
+#define DS18S20_COUNT_PER_C         16
@@ -1,11 +1,36 @@
 #include "pico/stdlib.h"
 #include "hardware/gpio.h"
-#include "hardware/pll.h"
 
+#include <inttypes.h>
 #include <stdio.h>
-#include <math.h>
+#include <stdlib.h>
+
+#include <atomic>
 
 #include "Onewire.h"
+#include "AcquisitionScheduler.h"
+#include "Bench.h"
+#include "BusManager.h"
+#include "ClockGovernor.h"
+#include "Crc8.h"
+#include "CycleCounter.h"
+#include "DeviceFamily.h"
+#include "FlashLog.h"
+#include "HotPath.h"
+#include "RomStore.h"
+#include "RomTable.h"
+#include "SampleRing.h"
+#include "SensorRegistry.h"
+#include "SensorStats.h"
+#include "StaticTasks.h"
+#include "TaskStats.h"
+#include "TicklessIdle.h"
+#include "Trace.h"
+#include "XipCache.h"
+#include "LatencyHistogram.h"
+#include "Telemetry.h"
+#include "Temperature.h"
+#include "TemperatureBench.h"
 #include "ds18b20.h"
 #include "ow_rom.h"
 
@@ -16,11 +41,11 @@
     #include "pico/cyw43_arch.h"
 #endif
 
-Onewire onewire;
+// Each Onewire bus is driven by its own PIO state machine
+BusManager buses;
 
-// We will be using a PIO object to perform the hardware Onewire signaling
-PIO pio = pio0;
-uint32_t pio_offset;
+// The devices found on each bus are remembered in flash from one boot to the next
+RomStore romStore;
 
 // Use GPIO21/GPOUT0 to drive CLKOUT. This GPIO/GPOUTx combo works for both RP2040 and RP2350.
 const uint32_t clkout_gpio          = 21;       // Pico board pin 27
@@ -31,29 +56,285 @@ const uint32_t clkout_gpio          = 21;       // Pico board pin 27
 const uint32_t onewire_power_gpio   = 15;       // The temp sensor power is pico board pin 19
                                                 // The temp sensor ground is pico board pin 18
 const uint32_t onewire_bus_gpio     = 14;       // The temp sensor Onewire bus is pico board pin 17
+
+// One Onewire bus gets created for every GPIO in this list, up to BusManager::MAX_BUSES.
+// Every bus gets scanned in parallel by its own task. For example, to run 4 buses:
+//   -DONEWIRE_BUS_GPIOS=14,2,3,4
+#ifndef ONEWIRE_BUS_GPIOS
+    #define ONEWIRE_BUS_GPIOS onewire_bus_gpio
+#endif
+const uint32_t onewire_bus_gpios[] = {ONEWIRE_BUS_GPIOS};
+const uint32_t onewire_bus_gpio_count = sizeof(onewire_bus_gpios) / sizeof(onewire_bus_gpios[0]);
 const uint32_t trigger_gpio         = 0;
 const uint32_t button_gpio          = 9;
 
-#define ILLEGAL_TEMP -300.0f            // below absolute zero (-273.15C)
+// We will look for a maximum of this many sensors when we scan each onewire bus.
+// The static allocation build has no 128 KB heap to reserve, so it can afford a bigger table.
+#ifndef MAX_SENSOR_COUNT
+    #if configSUPPORT_STATIC_ALLOCATION
+        #define MAX_SENSOR_COUNT 256
+    #else
+        #define MAX_SENSOR_COUNT 64
+    #endif
+#endif
+
+typedef SensorRegistry<MAX_SENSOR_COUNT> sensor_table_t;
+typedef RomTable<MAX_SENSOR_COUNT> rom_table_t;
+typedef AcquisitionScheduler<MAX_SENSOR_COUNT> scheduler_t;
+
+typedef struct {
+    uint32_t bus;
+    sensor_table_t sensors;
+    RomTablePublisher<MAX_SENSOR_COUNT> published;  // a new version every time a sensor arrives or departs
+
+    // Written by the bus task only, read by the report task when it prints the stats
+    LatencyHistogram conversion_latency;    // from starting a conversion until every sensor is done
+    LatencyHistogram scan_jitter;           // how far each wakeup was from when it was due
+    LatencyHistogram acquisition_latency;   // from waking up until the readings got handed over
+    std::atomic<uint32_t> missed_deadlines; // readings taken after their sensor's next one was due
+    std::atomic<uint32_t> broadcasts;       // conversions started with SKIP_ROM, on every sensor at once
+    std::atomic<uint32_t> addressed;        // conversions started with MATCH_ROM, one sensor each
+    std::atomic<uint32_t> busy_ms;          // time spent using the bus
+    std::atomic<uint32_t> committed_us;     // when the latest batch of readings got handed over
+    std::atomic<uint32_t> xip_kaccesses;    // XIP cache accesses by either core while the bus task was awake, in thousands
+    std::atomic<uint32_t> xip_misses;       // and how many of them missed
+
+    // The report task's own: its copy of the sensor table, and by the slots in that copy, the last reading
+    // of each sensor that got reported and that went into the flash log, and its rolling statistics.
+    // Then how many readings were worth reporting.
+    rom_table_t table;
+    int32_t last_reported[MAX_SENSOR_COUNT];
+    int32_t last_logged[MAX_SENSOR_COUNT];
+    SensorStats<MAX_SENSOR_COUNT> stats;
+    uint32_t readings;
+    uint32_t reported;
+    LatencyHistogram handoff_latency;       // from handing a batch over until the report task picked it up
+    LatencyHistogram processing_latency;    // the report task's time spent on each batch
+} sensor_bus_t;
+
+sensor_bus_t sensor_buses[onewire_bus_gpio_count];
+
+// The sensor tasks only take measurements. Every reading goes into its bus's sample ring as a
+// fixed-size record, and the report task does the conversion and output at its own pace.
+// A slow RTT connection then cannot stretch the scan period.
+// Each scan's readings get written straight into the ring and handed over as one batch.
+typedef struct {
+    uint32_t timestamp_ms;              // when the reading was taken
+    uint16_t sensor;                    // slot in the bus's sensor table
+    Temperature::raw_t rawtemp;
+    uint32_t table_version;             // the version of the sensor table that 'sensor' is a slot in
+} sample_t;
+
+// Each ring holds a few scans worth of readings before the report task is considered to have fallen behind
+#if configSUPPORT_STATIC_ALLOCATION
+    #define SAMPLE_RING_SIZE 512
+#else
+    #define SAMPLE_RING_SIZE 128
+#endif
+
+// The work is split between the cores as a pipeline. The acquisition core runs nothing but the bus tasks
+// (and the DMA interrupt that wakes them), so their timing does not depend on how much output there is.
+// The processing core runs the report task, which does the statistics and output, and everything else.
+// The batches of readings in the sample rings are the only thing passed between the two.
+#define ACQUISITION_CORE    (configNUMBER_OF_CORES - 1)
+#define PROCESSING_CORE     0
+
+SampleRing<sample_t, SAMPLE_RING_SIZE> sample_rings[onewire_bus_gpio_count];
+TaskHandle_t reportTask;
+TaskHandle_t logTask;
+
+// Set to 1 to time the bus primitives, a whole scan, the math and a context switch in clk_sys cycles,
+// once bus 0 has found its sensors. See runBenchmarks(). The 'bench' target builds the firmware this way.
+#ifndef BENCHMARK
+    #define BENCHMARK 0
+#endif
+
+// The task table: the stack size of every task, and how many of each there are.
+// In the static allocation build this is all of the RAM that the tasks will ever use.
+TaskGroup<512> blinkTaskMemory;
+TaskGroup<1024> reportTaskMemory;
+TaskGroup<512> logTaskMemory;
+TaskGroup<1024, onewire_bus_gpio_count> sensorTaskMemory;
+TaskGroup<256, BENCHMARK ? 1 : 0> benchTaskMemory;
+
+const size_t task_ram_bytes = taskRamBytes<decltype(blinkTaskMemory), decltype(reportTaskMemory), decltype(logTaskMemory),
+                                           decltype(sensorTaskMemory), decltype(benchTaskMemory)>();
+
+// Set to 1 to send the readings as binary telemetry on RTT up-buffer 1 instead of as text on the console.
+// See Telemetry.h for the format, and the host build's ptwd-decode tool to read it.
+#ifndef BINARY_TELEMETRY
+    #define BINARY_TELEMETRY 0
+#endif
+
+// Every so often, the telemetry repeats the ROM tables and sends absolute readings,
+// so that a decoder that starts late (or lost some frames) can catch up
+#define TELEMETRY_REFRESH_MS 10000
+
+Telemetry telemetry;
+
+// Where TRACE() sends its records with BINARY_TRACE (see Trace.h)
+Trace trace;
+
+// Task CPU usage, stack high-water marks, bus latencies and missed deadlines get printed this often.
+// Typing 's' in the RTT console prints them right away. Set this to 0 to only print them on demand.
+#ifndef STATS_PERIOD_MS
+    #define STATS_PERIOD_MS 60000
+#endif
+
+TaskStats taskStats;
+
+// Every LOG_PERIOD_MS, each sensor's filtered reading goes into the flash log if it changed since the last time
+// (see FlashLog.h). Typing 'l' in the RTT console sends the whole log on RTT up-buffer 2, for the host build's
+// ptwd-log tool to read. A page that is only partly filled gets written anyway after LOG_FLUSH_MS, which is
+// the most that a power failure can lose. Set LOG_PERIOD_MS to 0 to turn the log off.
+#ifndef LOG_PERIOD_MS
+    #define LOG_PERIOD_MS 60000
+#endif
+#ifndef LOG_FLUSH_MS
+    #define LOG_FLUSH_MS (15 * 60000)
+#endif
+
+FlashLog flashLog;
+
+// Written by the report task, to ask the log task for a dump
+std::atomic<uint32_t> log_dump_requests;
+
+// The clock governor drops clk_sys to IDLE_CLOCK whenever nothing needs it to run faster.
+// The bus tasks ask for BUS_CLOCK while they use their bus, and the report task asks for REPORT_CLOCK
+// while it processes readings. Set CLOCK_GOVERNOR to 0 to stay at full speed all the time.
+#ifndef CLOCK_GOVERNOR
+    #define CLOCK_GOVERNOR 1
+#endif
+#ifndef IDLE_CLOCK
+    #define IDLE_CLOCK ClockGovernor::SPEED_XOSC
+#endif
+#ifndef BUS_CLOCK
+    #define BUS_CLOCK ClockGovernor::SPEED_USB_PLL
+#endif
+#ifndef REPORT_CLOCK
+    #define REPORT_CLOCK ClockGovernor::SPEED_FULL
+#endif
+
+ClockGovernor governor;
+
+// Stops the tick while nothing is due (see vApplicationSleep() and TICKLESS_IDLE in FreeRTOSConfig.h)
+TicklessIdle ticklessIdle;
+
+// The XIP cache counters (see XipCache.h). The bus tasks sample them every time they wake up, which is
+// often enough to keep them from saturating. With RAM_HOT_PATH, their misses should all but disappear.
+XipCache xipCache;
+
+static_assert(MAX_SENSOR_COUNT <= UINT16_MAX, "sample_t cannot hold every sensor index");
+
+// Every sensor gets set to this resolution unless it is listed in sensor_settings[] below.
+// Lower resolutions convert faster: 9 bits takes 94 mSec, 10 bits 188, 11 bits 375, and 12 bits 750.
+#ifndef SENSOR_RESOLUTION
+    #define SENSOR_RESOLUTION 12
+#endif
+
+// Every sensor gets read this often unless it is listed in sensor_settings[] below.
+// A bus of 9-bit sensors can be scanned at about 10 Hz: -DSENSOR_RESOLUTION=9 -DSCAN_PERIOD_MS=100
+#ifndef SCAN_PERIOD_MS
+    #define SCAN_PERIOD_MS 1000
+#endif
+
+// Sensors whose releases fall within this long of each other share a conversion cycle.
+// Sensors with the same period are always released together.
+#define SCHEDULE_WINDOW_MS 20
+
+// Some knock-off DS18B20's take longer than the datasheet conversion time.
+// Once the nominal time is up, we keep asking the bus if they are done yet this often.
+#define CONVERSION_POLL_MS 5
+
+// Exception-only reads: every sensor's TH/TL alarm thresholds get set to a band of +/- ALARM_BAND_C
+// around its last reading. After a conversion, an alarm search finds just the sensors that left their
+// band, and only those get read and have their band re-centered. Bus traffic then scales with the
+// number of sensors that changed instead of the number of sensors.
+// Temperature changes smaller than the band go unreported. Set this to 0 to read every sensor on every scan.
+#ifndef ALARM_BAND_C
+    #define ALARM_BAND_C 0
+#endif
+
+// In exception-only mode, every sensor still gets read on every Nth scan anyway. A sensor that lost
+// power comes back with the TH/TL thresholds from its EEPROM, which might never raise an alarm.
+#define ALARM_REFRESH_SCANS 60
+
+// A reading only gets reported when it differs from the last reported reading of its sensor by at least
+// this many hundredths of a degree C. Set this to 0 to report every change, down to the sensor's resolution.
+#ifndef REPORT_CHANGE_CENTI_C
+    #define REPORT_CHANGE_CENTI_C 0
+#endif
+
+// The same threshold in sensor units, worked out at compile time
+const int32_t report_change_raw = Temperature::CentiCToRaw::apply(REPORT_CHANGE_CENTI_C);
 
+// Set to 1 to report each sensor's filtered reading (see SensorStats.h) instead of its raw reading.
+// A sensor sitting right between two 1/16 C steps then stops getting reported on nearly every scan.
+#ifndef REPORT_FILTERED
+    #define REPORT_FILTERED 1
+#endif
+
+// Set to 1 to read all 9 bytes of each sensor's scratchpad and check its CRC, instead of only the
+// 2 temperature bytes. It costs 56 more read slots (about 4 mSec of bus time) per reading, but a bit
+// error on a long cable no longer turns into a wrong temperature, and a sensor that lost power
+// during its conversion can be told apart from one that is really at 85 C.
+#ifndef SCRATCHPAD_CRC
+    #define SCRATCHPAD_CRC 0
+#endif
+
+// A scratchpad read that fails its CRC check gets tried this many more times. The scratchpad
+// holds the same reading until the next conversion, so a read that got hit by noise can just be repeated.
+#define SCRATCHPAD_RETRIES 2
+
+// Set to 1 to time the integer temperature math against the float math it replaced, once at boot
+#ifndef TEMPERATURE_BENCHMARK
+    #define TEMPERATURE_BENCHMARK 0
+#endif
+
+// Set to 1 to time each of the CRC8 methods in Crc8.h on a scratchpad, once at boot
+#ifndef CRC_BENCHMARK
+    #define CRC_BENCHMARK 0
+#endif
+
+// Each run of the scan benchmark takes a whole conversion time
+#define BENCHMARK_SCAN_RUNS 5
+
+// Sensors that need a resolution other than SENSOR_RESOLUTION, or a period other than SCAN_PERIOD_MS,
+// by ROM code. A 0 keeps the default. The period must be longer than the conversion time at that resolution.
+// For example, a fast process sensor and a slow ambient one:
+//   -DSENSOR_SETTINGS="{0x1234567890abcd28,9,100},{0x0123456789abcd28,0,60000},"
 typedef struct {
-    uint64_t onewire_address;
-    uint16_t rawtemp;
-    float curr_temp_C;
-    float prev_temp_C;
-} sensor_info_t;
+    uint64_t rom;
+    uint8_t resolution;
+    uint32_t period_ms;
+} sensor_setting_t;
 
-// We will look for a maximum of this many sensors when we scan the onewire bus
-#define MAX_SENSOR_COUNT 20
+#ifndef SENSOR_SETTINGS
+    #define SENSOR_SETTINGS
+#endif
 
-sensor_info_t sensors[MAX_SENSOR_COUNT];
+const sensor_setting_t sensor_settings[] = {
+    SENSOR_SETTINGS
+    {0, 0, 0}                           // end of list
+};
 
-int actual_sensor_count;
+// The background search for sensors being plugged in or unplugged takes one step this often,
+// no matter how fast the buses are being scanned
+#define SEARCH_PERIOD_MS 1000
+
+// A known device that does not show up in this many complete background search rounds in a row is considered gone
+#define SEARCH_FAILURE_LIMIT 3
+
+// All the bus tasks wake up on the same schedule, so that the conversions on every bus run at the same time
+TickType_t scan_epoch;
 
 // --------------------------------------------------------------------------------------------
 void _panic(const char* msg)
 {
-    printf("%s: %s\n", __FUNCTION__, msg);
+    TRACE("%s: %s\n", __FUNCTION__, msg);
+    if (BINARY_TRACE) {
+        trace.drain();
+    }
     __breakpoint();
 }
 
@@ -100,15 +381,29 @@ void hello()
 // --------------------------------------------------------------------------------------------
 void init_pio()
 {
-    // Add the onewire program to the PIO shared address space
-    if (!pio_can_add_program (pio, &onewire_program)) {
-        _panic("Unable to add PIO program");
+    // Claim a state machine and initialize a driver instance for every bus.
+    // The onewire program gets added to each PIO block's shared address space as needed.
+    if (buses.init(onewire_bus_gpios, onewire_bus_gpio_count) == 0) {
+        _panic("Onewire init() failed");
     }
-    pio_offset = pio_add_program (pio, &onewire_program);
+}
 
-    // claim a state machine and initialize a driver instance
-    if (!onewire.init(pio, pio_offset, onewire_bus_gpio)) {
-        _panic("Onewire init() failed");
+// --------------------------------------------------------------------------------------------
+// The clock governor calls this every time clk_sys changes, with interrupts off
+void clockChanged()
+{
+    buses.clockChanged();
+}
+
+// And this around every change, so that it only happens between transactions. The bus tasks only
+// ask the governor for a speed while they are not in the middle of a transaction.
+void holdBuses(bool hold)
+{
+    if (hold) {
+        buses.lock();
+    }
+    else {
+        buses.unlock();
     }
 }
 
@@ -130,7 +425,9 @@ void sensorPower(bool powerOn)
         // Mostly, this serves to guarantee proper detection of the situation where there are
         // no devices on the bus.
         // We do not need to set the GPIO direction for this pin because the PIO unit controls it.
-        gpio_set_pulls(onewire_bus_gpio, true, false);
+        for (uint32_t i=0; i<onewire_bus_gpio_count; i++) {
+            gpio_set_pulls(onewire_bus_gpios[i], true, false);
+        }
     }
     else {
         // Turn off power to the sensors by driving the GPIO low
@@ -139,122 +436,1310 @@ void sensorPower(bool powerOn)
         gpio_put(onewire_power_gpio, 0);
 
         // Turn on a weak pulldown so that we do not backpower the device through its data pin
-        gpio_set_pulls(onewire_bus_gpio, false, true);
+        for (uint32_t i=0; i<onewire_bus_gpio_count; i++) {
+            gpio_set_pulls(onewire_bus_gpios[i], false, true);
+        }
     }
 }
 
 // --------------------------------------------------------------------------------------------
-// All temp sensors get read once per second.
-// New temperatures only get displayed if they have changed since the last time they were measured.
-void vTempSensorTask(void* arg)
+// Fill in the first 9 bytes of a transaction: MATCH_ROM followed by the device address
+void HOT_PATH(addressSensor)(uint8_t* cmd, uint64_t rom)
 {
-    uint64_t deviceAddr[MAX_SENSOR_COUNT];
-    static TickType_t lastWakeTime;
-    static uint64_t unexpected_address;
+    cmd[0] = OW_MATCH_ROM;
+    for (int b = 0; b < 8; b += 1) {
+        cmd[1 + b] = rom >> (8 * b);
+    }
+}
 
-    printf("Hello from the TempSensorTask, running on core %d\n", get_core_num());
+// --------------------------------------------------------------------------------------------
+// Read a sensor's entire scratchpad. A read that fails the CRC check gets retried, and each failure
+// gets counted in 'crc_errors'.
+// If the sensor is not there, nobody answers the reset, and there is no point trying again.
+bool HOT_PATH(readScratchpad)(Onewire& onewire, uint64_t rom, uint8_t* scratchpad, uint16_t& crc_errors)
+{
+    uint8_t cmd[10];
+    addressSensor(cmd, rom);
+    cmd[9] = DS18B20_READ_SCRATCHPAD;
 
-    init_pio();
+    for (uint32_t attempt = 0; attempt <= SCRATCHPAD_RETRIES; attempt++) {
+        if (!onewire.transact(cmd, sizeof(cmd), scratchpad, 9)) {
+            return false;
+        }
 
-    sensorPower(false);
-    vTaskDelay(pdMS_TO_TICKS(10));
-    sensorPower(true);
+        // A bus stuck low reads back as all 0's, which would pass the CRC check
+        bool all_zero = true;
+        for (uint32_t i=0; i<9; i++) {
+            all_zero &= (scratchpad[i] == 0);
+        }
+        if (!all_zero && (Onewire::crc8(scratchpad, 9) == 0)) {
+            return true;
+        }
+        crc_errors++;
+    }
+    return false;
+}
+
+// --------------------------------------------------------------------------------------------
+const sensor_setting_t* settingsFor(uint64_t rom)
+{
+    const sensor_setting_t* s = sensor_settings;
+    while ((s->rom != 0) && (s->rom != rom)) {
+        s++;
+    }
+    return s;
+}
 
+// --------------------------------------------------------------------------------------------
+// Make sure that a sensor is really there, and that it is set to the resolution we want.
+// A new resolution also gets copied to the sensor's EEPROM so that it survives a power cycle.
+// The EEPROM is only written when the resolution actually changes, since it wears out.
+// A family without a configuration register runs at its own fixed resolution, and has nothing to set.
+template <typename DRIVER>
+bool configureFamily(Onewire& onewire, sensor_table_t& sensors, int i, uint8_t resolution)
+{
+    uint64_t rom = sensors.rom(i);
+    sensors.resolution[i] = DRIVER::resolution(resolution);
 
-    // Set up a scope trigger output. The line will be driven high during the temperature conversion cycle.
-    gpio_init(trigger_gpio);
-    gpio_set_dir(trigger_gpio, true);
-    gpio_put(trigger_gpio, 0);
+    uint8_t scratchpad[9];
+    if (!readScratchpad(onewire, rom, scratchpad, sensors.crc_errors[i])) {
+        return false;
+    }
 
+    sensors.alarm_high[i] = scratchpad[2];
+    sensors.alarm_low[i] = scratchpad[3];
+    if constexpr (DRIVER::CONFIGURABLE) {
+        uint8_t config = DS18B20_CONFIG(sensors.resolution[i]);
+        if (scratchpad[DS18B20_SCRATCHPAD_CONFIG] != config) {
+            // The alarm thresholds TH and TL get written back unchanged
+            uint8_t cmd[13];
+            addressSensor(cmd, rom);
+            cmd[9] = DS18B20_WRITE_SCRATCHPAD;
+            cmd[10] = scratchpad[2];
+            cmd[11] = scratchpad[3];
+            cmd[12] = config;
+            onewire.transact(cmd, sizeof(cmd));
+
+            addressSensor(cmd, rom);
+            cmd[9] = DS18B20_COPY_SCRATCHPAD;
+            onewire.transact(cmd, 10);
+
+            // The copy to EEPROM takes up to 10 mSec
+            vTaskDelay(pdMS_TO_TICKS(10) + 1);
+            TRACE("%s: %s %016" PRIx64 " resolution changed from %d to %d bits\n", __FUNCTION__, DRIVER::NAME,
+                   rom, DS18B20_CONFIG_BITS(scratchpad[DS18B20_SCRATCHPAD_CONFIG]), sensors.resolution[i]);
+        }
+    }
+    return true;
+}
+
+// The configureFamily() of each family, by DeviceFamily index
+typedef bool (*configure_family_t)(Onewire& onewire, sensor_table_t& sensors, int i, uint8_t resolution);
+const configure_family_t configure_families[] = {
+    configureFamily<DeviceFamily::driver_t<0>>,
+    configureFamily<DeviceFamily::driver_t<1>>,
+    configureFamily<DeviceFamily::driver_t<2>>,
+};
+static_assert(sizeof(configure_families) / sizeof(configure_families[0]) == DeviceFamily::COUNT,
+              "configure_families[] needs an entry for every DeviceFamily");
+
+// --------------------------------------------------------------------------------------------
+// Whether a device is a sensor that we have a driver for. Nothing else goes into the sensor table.
+bool isSensor(uint64_t rom)
+{
+    return DeviceFamily::of(rom) != DeviceFamily::UNSUPPORTED;
+}
+
+// --------------------------------------------------------------------------------------------
+// Set up a new sensor's schedule, then configure it with its family's driver.
+// The sensor's first reading is due right away.
+bool configureSensor(Onewire& onewire, sensor_table_t& sensors, int i)
+{
+    uint64_t rom = sensors.rom(i);
+    const sensor_setting_t* settings = settingsFor(rom);
+    sensors.family[i] = DeviceFamily::of(rom);
+    sensors.period[i] = pdMS_TO_TICKS(settings->period_ms ? settings->period_ms : SCAN_PERIOD_MS);
+    sensors.release[i] = scheduler_t::firstRelease(sensors.period[i], scan_epoch, xTaskGetTickCount());
+    sensors.converting[i] = false;
+    sensors.crc_errors[i] = 0;
+    sensors.power_on_readings[i] = 0;
+
+    uint8_t resolution = settings->resolution ? settings->resolution : SENSOR_RESOLUTION;
+    return configure_families[sensors.family[i]](onewire, sensors, i, resolution);
+}
+
+// --------------------------------------------------------------------------------------------
+// The ticks from starting a conversion until it is sure to be done. The tick count only says
+// that the current tick has started, so that takes one more tick than the conversion time.
+TickType_t HOT_PATH(conversionTicks)(uint8_t resolution)
+{
+    return pdMS_TO_TICKS((DS18B20_CONVERSION_US(resolution) + 999) / 1000) + 1;
+}
+
+// --------------------------------------------------------------------------------------------
+// Start the conversions of the sensors that are due, in 'due' order: all of them with one broadcast,
+// or one at a time if the scheduler says so. Returns the tick by which every sensor that got
+// started (including ones that were not due) is done.
+TickType_t HOT_PATH(startConversions)(sensor_bus_t* sb, const uint16_t* due, int count, TickType_t busDone)
+{
+    Onewire& onewire = buses.bus(sb->bus);
+    sensor_table_t& sensors = sb->sensors;
+
+    if (scheduler_t::broadcast(sensors, count)) {
+        static const uint8_t convert[] = {OW_SKIP_ROM, DS18B20_CONVERT_T};
+        onewire.transact(convert, sizeof(convert));
+        TickType_t now = xTaskGetTickCount();
+        for (int i = 0; i < sensors.count(); i++) {
+            TickType_t done = now + conversionTicks(sensors.resolution[i]);
+            if (scheduler_t::before(busDone, done)) {
+                busDone = done;
+            }
+        }
+        for (int c = 0; c < count; c++) {
+            int i = due[c];
+            sensors.ready[i] = now + conversionTicks(sensors.resolution[i]);
+            sensors.converting[i] = true;
+        }
+        sb->broadcasts.store(sb->broadcasts.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return busDone;
+    }
+
+    for (int c = 0; c < count; c++) {
+        int i = due[c];
+        uint8_t cmd[10];
+        addressSensor(cmd, sensors.rom(i));
+        cmd[9] = DS18B20_CONVERT_T;
+        if (!onewire.transact(cmd, sizeof(cmd))) {
+            // Nobody answered: the sensor misses this reading, and the background search finds out if it has gone
+            scheduler_t::complete(sensors, i, xTaskGetTickCount());
+            continue;
+        }
+        sensors.ready[i] = xTaskGetTickCount() + conversionTicks(sensors.resolution[i]);
+        sensors.converting[i] = true;
+        if (scheduler_t::before(busDone, sensors.ready[i])) {
+            busDone = sensors.ready[i];
+        }
+    }
+    sb->addressed.store(sb->addressed.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    return busDone;
+}
+
+// --------------------------------------------------------------------------------------------
+// Get a new temperature reading from a sensor, with its family's driver.
+// Each reading is a single transaction: reset, MATCH_ROM plus the sensor's address, READ_SCRATCHPAD,
+// then the bytes that the driver needs for a reading, or with SCRATCHPAD_CRC, all 9 bytes.
+// We sleep while the bus does the work.
+template <typename DRIVER>
+__force_inline bool readSensor(Onewire& onewire, sensor_table_t& sensors, int i)
+{
+    uint8_t scratchpad[9];
+    if (SCRATCHPAD_CRC) {
+        if (!readScratchpad(onewire, sensors.rom(i), scratchpad, sensors.crc_errors[i])) {
+            // Nobody answered, or every try was damaged: keep the previous reading
+            return false;
+        }
+        if (DRIVER::powerOn(scratchpad)) {
+            sensors.power_on_readings[i]++;
+            return false;
+        }
+    }
+    else {
+        uint8_t cmd[10];
+        addressSensor(cmd, sensors.rom(i));
+        cmd[9] = DS18B20_READ_SCRATCHPAD;
+        if (!onewire.transact(cmd, sizeof(cmd), scratchpad, DRIVER::READ_BYTES)) {
+            // Nobody answered: keep the previous reading
+            return false;
+        }
+    }
+    sensors.raw[i] = DRIVER::normalize(scratchpad, sensors.resolution[i]);
+
+    return true;
+}
+
+// --------------------------------------------------------------------------------------------
+// Move a sensor's alarm band so that it is centered on its latest reading.
+// The sensor compares the whole degrees of each new reading against TH and TL: it raises its alarm
+// flag when the reading is >= TH or <= TL. The thresholds only live in the scratchpad. They are not
+// copied to EEPROM, which would wear it out. A family with a configuration register needs it
+// written along with them.
+template <typename DRIVER>
+__force_inline void recenterAlarm(Onewire& onewire, sensor_table_t& sensors, int i)
+{
+    int32_t whole = Temperature::wholeC(sensors.raw[i]);
+    int8_t high = (whole + ALARM_BAND_C > 127) ? 127 : whole + ALARM_BAND_C;
+    int8_t low = (whole - ALARM_BAND_C < -128) ? -128 : whole - ALARM_BAND_C;
+    if ((high == sensors.alarm_high[i]) && (low == sensors.alarm_low[i])) {
+        return;
+    }
+
+    uint8_t cmd[13];
+    addressSensor(cmd, sensors.rom(i));
+    cmd[9] = DS18B20_WRITE_SCRATCHPAD;
+    cmd[10] = high;
+    cmd[11] = low;
+    cmd[12] = DS18B20_CONFIG(sensors.resolution[i]);
+    if (onewire.transact(cmd, DRIVER::CONFIGURABLE ? 13 : 12)) {
+        sensors.alarm_high[i] = high;
+        sensors.alarm_low[i] = low;
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+// Read the group of sensors of family F (see DeviceFamily::group()), then each group after it.
+// Every family gets its own copy of the loop, with its driver built in, so nothing in the loop
+// depends on the family at run time. The slots of the sensors that got a reading get packed at
+// the front of 'grouped', from 'got' on. Returns how many of them there were, across the groups.
+// It is all inlined into its caller: GCC ignores the section attribute of a function template,
+// so HOT_PATH would not work on these.
+template <int F>
+__force_inline int readGroups(Onewire& onewire, sensor_table_t& sensors, uint16_t* grouped, const int* first, int got)
+{
+    if constexpr (F == DeviceFamily::COUNT) {
+        return 0;
+    }
+    else {
+        typedef DeviceFamily::driver_t<F> driver_t;
+        int n = 0;
+        for (int c = first[F]; c < first[F + 1]; c++) {
+            int i = grouped[c];
+            if (!readSensor<driver_t>(onewire, sensors, i)) {
+                continue;
+            }
+            if (ALARM_BAND_C != 0) {
+                recenterAlarm<driver_t>(onewire, sensors, i);
+            }
+            grouped[got + n++] = i;
+        }
+        return n + readGroups<F + 1>(onewire, sensors, grouped, first, got + n);
+    }
+}
+
+// Read every sensor in 'slots', family by family. Returns how many got a reading, and leaves their
+// slots at the front of 'got', which has room for 'count'.
+int HOT_PATH(readFamilies)(Onewire& onewire, sensor_table_t& sensors, const uint16_t* slots, int count, uint16_t* got)
+{
+    int first[DeviceFamily::COUNT + 1];
+    DeviceFamily::group(sensors.family, slots, count, got, first);
+    return readGroups<0>(onewire, sensors, got, first, 0);
+}
+
+// --------------------------------------------------------------------------------------------
+// Exception-only reads: find the sensors whose latest conversion left their alarm band.
+// Fills 'changed' with their slots and returns how many there were.
+// Each device that the alarm search turns up gets looked up in the sorted ROM index as it is found.
+int HOT_PATH(findAlarms)(sensor_bus_t* sb, uint16_t* changed)
+{
+    Onewire& onewire = buses.bus(sb->bus);
+    Onewire::search_t search = {};
+    int found = 0;
+    int count = 0;
+
+    // Nobody in alarm shows up as a failed search.
+    // Sensors we do not know about yet get picked up by the background search.
+    do {
+        if (!onewire.searchNext(search, OW_ALARM_SEARCH)) {
+            break;
+        }
+        int i = sb->sensors.find(search.rom);
+        if (i != sensor_table_t::NOT_FOUND) {
+            changed[count++] = i;
+        }
+    } while (!search.done && (++found < MAX_SENSOR_COUNT));
+
+    return count;
+}
+
+// --------------------------------------------------------------------------------------------
+// The table of sensors on a bus changed: remember it in flash, and hand the report task the new version
+void sensorsChanged(sensor_bus_t* sb)
+{
+    sb->published.publish(sb->sensors);
+    romStore.save(buses.gpio(sb->bus), sb->sensors.romTable(), sb->sensors.count());
+}
+
+// --------------------------------------------------------------------------------------------
+// Get the table of devices for a bus as quickly as possible after booting.
+// If flash remembers what was on this bus last time, each of those devices gets verified individually.
+// Otherwise, the bus gets a full ROM search.
+void findSensors(sensor_bus_t* sb)
+{
+    Onewire& onewire = buses.bus(sb->bus);
+    sensor_table_t& sensors = sb->sensors;
+    uint32_t gpio = buses.gpio(sb->bus);
 
-    // Find each device on the onewire bus, adding its device address to the deviceAddr array.
     uint32_t t0_us = time_us_32();
-    actual_sensor_count = onewire.romsearch(deviceAddr, MAX_SENSOR_COUNT, OW_SEARCH_ROM);
-    uint32_t elapsed_us = time_us_32() - t0_us;
-    printf("%s: Detected %d Onewire devices in %d uSec\n", __FUNCTION__, actual_sensor_count, elapsed_us);
+    uint64_t known_roms[RomStore::MAX_ROMS_PER_BUS];
+    int known = romStore.load(gpio, known_roms, RomStore::MAX_ROMS_PER_BUS);
+    for (int k = 0; k < known; k++) {
+        if (!Onewire::validRom(known_roms[k]) || !isSensor(known_roms[k])) {
+            // Flash does not remember this bus properly: search it instead
+            TRACE("%s: Bus %d: ROM code %016" PRIx64 " from flash fails its CRC check, or is not a sensor\n",
+                   __FUNCTION__, sb->bus, known_roms[k]);
+            known = 0;
+        }
+    }
 
-    for (uint32_t i=0; i<MAX_SENSOR_COUNT; i++) {
-        // Flush any previous temperature history by setting prev to an invalid value
-        sensors[i].prev_temp_C = ILLEGAL_TEMP;
+    // The sensor table can be bigger than what flash remembers. If flash is full, there might be more.
+    bool complete = (MAX_SENSOR_COUNT <= RomStore::MAX_ROMS_PER_BUS) || (known < (int)RomStore::MAX_ROMS_PER_BUS);
+    if ((known > 0) && complete) {
+        for (int k = 0; k < known; k++) {
+            int i = sensors.add(known_roms[k]);
+            if ((i != sensor_table_t::NOT_FOUND) && !configureSensor(onewire, sensors, i)) {
+                TRACE("%s: Bus %d: sensor %016" PRIx64 " has departed\n", __FUNCTION__, sb->bus, known_roms[k]);
+                sensors.remove(i);
+            }
+        }
+        uint32_t elapsed_us = time_us_32() - t0_us;
+        TRACE("%s: Verified %d of %d known Onewire devices on bus %d in %d uSec\n",
+               __FUNCTION__, sensors.count(), known, sb->bus, elapsed_us);
+    }
+    else {
+        // Find each device on the onewire bus, adding each sensor to the sensor table as it is found
+        Onewire::search_t search = {};
+        do {
+            if (!onewire.searchNext(search, OW_SEARCH_ROM)) {
+                break;
+            }
+            if (!isSensor(search.rom)) {
+                TRACE("%s: Bus %d: device %016" PRIx64 " is not a sensor we have a driver for\n", __FUNCTION__, sb->bus, search.rom);
+                continue;
+            }
+            if (sensors.add(search.rom) == sensor_table_t::NOT_FOUND) {
+                break;
+            }
+        } while (!search.done);
+        uint32_t elapsed_us = time_us_32() - t0_us;
+        TRACE("%s: Detected %d Onewire devices on bus %d in %d uSec\n", __FUNCTION__, sensors.count(), sb->bus, elapsed_us);
+
+        for (int i = 0; i < sensors.count(); i++) {
+            configureSensor(onewire, sensors, i);
+        }
     }
 
-    lastWakeTime = xTaskGetTickCount();
+    sensorsChanged(sb);
+}
 
+// --------------------------------------------------------------------------------------------
+// Hot-plug detection: every scan cycle, the background ROM search takes one more step and finds
+// one more device. Devices we did not know about get added as they are found. Once a search round
+// has covered the whole bus, any known device that it did not find has departed.
+void HOT_PATH(backgroundSearch)(sensor_bus_t* sb, Onewire::search_t& search, uint32_t& failures)
+{
+    Onewire& onewire = buses.bus(sb->bus);
+    sensor_table_t& sensors = sb->sensors;
+    bool changed = false;
+
+    if (!onewire.searchNext(search, OW_SEARCH_ROM)) {
+        // The round got cut short (or the bus is empty). Start over, but if nothing can be
+        // found several times in a row, everything we know about has gone.
+        for (int i = 0; i < sensors.count(); i++) {
+            sensors.seen[i] = false;
+        }
+        if ((++failures >= SEARCH_FAILURE_LIMIT) && (sensors.count() > 0)) {
+            while (sensors.count() > 0) {
+                TRACE("%s: Bus %d: sensor %016" PRIx64 " has departed\n", __FUNCTION__, sb->bus, sensors.rom(0));
+                sensors.remove(0);
+            }
+            changed = true;
+        }
+    }
+    else {
+        failures = 0;
+
+        // A device that has no driver never goes into the table: it just gets passed over every round
+        int i = sensors.find(search.rom);
+        if ((i == sensor_table_t::NOT_FOUND) && !sensors.full() && isSensor(search.rom)) {
+            TRACE("%s: Bus %d: sensor %016" PRIx64 " has arrived\n", __FUNCTION__, sb->bus, search.rom);
+            i = sensors.add(search.rom);
+            configureSensor(onewire, sensors, i);
+            changed = true;
+        }
+        if (i != sensor_table_t::NOT_FOUND) {
+            sensors.seen[i] = true;
+        }
+
+        if (search.done) {
+            // The round is complete
+            for (i = sensors.count() - 1; i >= 0; i--) {
+                if (!sensors.seen[i]) {
+                    TRACE("%s: Bus %d: sensor %016" PRIx64 " has departed\n", __FUNCTION__, sb->bus, sensors.rom(i));
+                    sensors.remove(i);
+                    changed = true;
+                }
+            }
+            for (i = 0; i < sensors.count(); i++) {
+                sensors.seen[i] = false;
+            }
+            search = {};
+        }
+    }
+
+    if (changed) {
+        sensorsChanged(sb);
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+// Read the sensors whose conversions are done, in 'ready' order, and hand the readings over as one batch.
+// In exception-only mode, only the ones whose temperature left their alarm band get read, except on
+// every ALARM_REFRESH_SCANS'th batch. Every sensor in 'ready' has its reading done either way.
+void HOT_PATH(readSensors)(sensor_bus_t* sb, const uint16_t* ready, int count, uint32_t& scan_count)
+{
+    Onewire& onewire = buses.bus(sb->bus);
+    sensor_table_t& sensors = sb->sensors;
+
+    const uint16_t* read = ready;
+    int read_count = count;
+    uint16_t changed[MAX_SENSOR_COUNT];
+    if ((ALARM_BAND_C != 0) && ((scan_count % ALARM_REFRESH_SCANS) != 0)) {
+        // The alarm search also turns up sensors whose flag is left over from an earlier conversion
+        TickType_t now = xTaskGetTickCount();
+        int found = findAlarms(sb, changed);
+        read_count = 0;
+        for (int c = 0; c < found; c++) {
+            int i = changed[c];
+            if (sensors.converting[i] && !scheduler_t::before(now, sensors.ready[i])) {
+                changed[read_count++] = i;
+            }
+        }
+        scheduler_t::sortByDeadline(sensors, changed, read_count);
+        read = changed;
+    }
+    scan_count++;
+
+    // Each family's sensors get read as a group (see DeviceFamily.h)
+    uint16_t got[MAX_SENSOR_COUNT];
+    int got_count = readFamilies(onewire, sensors, read, read_count, got);
+
+    SampleRing<sample_t, SAMPLE_RING_SIZE>& ring = sample_rings[sb->bus];
+    uint32_t version = sb->published.version();
+    for (int c = 0; c < got_count; c += 1) {
+        int i = got[c];
+
+        // The reading goes straight into the ring. A full ring drops it, and counts the overflow.
+        sample_t* sample = ring.reserve();
+        if (sample) {
+            *sample = {(uint32_t)(time_us_64() / 1000), (uint16_t)i, sensors.raw[i], version};
+        }
+    }
+
+    TickType_t now = xTaskGetTickCount();
+    uint32_t missed = 0;
+    for (int c = 0; c < count; c++) {
+        missed += scheduler_t::complete(sensors, ready[c], now);
+    }
+    if (missed) {
+        sb->missed_deadlines.store(sb->missed_deadlines.load(std::memory_order_relaxed) + missed, std::memory_order_relaxed);
+    }
+
+    // Hand the whole batch over at once
+    ring.commit();
+    sb->committed_us.store(time_us_32(), std::memory_order_relaxed);
+    xTaskNotifyGive(reportTask);
+}
+
+// --------------------------------------------------------------------------------------------
+// Restrict a task (NULL for the calling task) to one core. Pinning the calling task to another core moves it there right away.
+void pinTask(TaskHandle_t task, UBaseType_t core)
+{
+    #if (configNUMBER_OF_CORES > 1) && (configUSE_CORE_AFFINITY == 1)
+        vTaskCoreAffinitySet(task, 1 << core);
+    #endif
+}
+
+// --------------------------------------------------------------------------------------------
+// The other half of the context switch benchmark: hands every notification straight back
+void vBenchPartner(void* arg)
+{
+    TaskHandle_t caller = (TaskHandle_t)arg;
     while (1) {
-        if (actual_sensor_count > 0) {
-            // Start a temperature conversion in parallel on all devices on the bus
-            //printf("%s: Starting temperature conversion\n", __FUNCTION__);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        xTaskNotifyGive(caller);
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+// Time the things that a scan is made of, in clk_sys cycles at full speed, and print a 'bench,' line
+// for each (see Bench.h). Bus 0's task runs this once, before its sensors' schedules start, so nothing
+// else is going on with its bus. Every result is the cost of one of:
+//   context switch         a task notification over to a higher priority task on the same core, or back
+//   temperature conversion the report task's math on one reading
+//   scratchpad crc         checking a 9-byte scratchpad with the CRC8_METHOD in use
+//   onewire send byte      the blocking byte primitives that the ROM search and the conversion poll use
+//   onewire read byte
+//   match rom read         a DS18B20 reading's transaction: reset, MATCH_ROM, READ_SCRATCHPAD, then the reading
+//   rom search pass        a searchNext() call, which finds one device
+//   scan cycle             a broadcast conversion, the wait until it is done, and reading every sensor
+void runBenchmarks(sensor_bus_t* sb)
+{
+    Onewire& onewire = buses.bus(sb->bus);
+    sensor_table_t& sensors = sb->sensors;
+    int count = sensors.count();
+    CycleCounter::snapshot_t t;
+
+    governor.request(REPORT_CLOCK);
+    CycleCounter::init();
+
+    // Each round trip is two switches. The partner stays blocked for good afterwards.
+    {
+        Bench bench(CycleCounter::PLATFORM, "context switch", "cycles", 2);
+        TaskHandle_t partner = benchTaskMemory.create(0, vBenchPartner, "Bench", xTaskGetCurrentTaskHandle(), 3);
+        if (!partner) {
+            panic("Bench task creation failed!");
+        }
+        pinTask(partner, ACQUISITION_CORE);
+        while (!bench.full()) {
+            t = CycleCounter::now();
+            xTaskNotifyGive(partner);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            bench.add(CycleCounter::since(t));
+        }
+        bench.print();
+    }
+
+    {
+        const uint32_t readings = 64;
+        static Temperature::raw_t raw[readings];
+        static volatile int32_t sink;
+        TemperatureBench::makeReadings(raw, readings);
+        Bench bench(CycleCounter::PLATFORM, "temperature conversion", "cycles", readings);
+        while (!bench.full()) {
+            t = CycleCounter::now();
+            TemperatureBench::integerPipeline(raw, readings, &sink);
+            bench.add(CycleCounter::since(t));
+        }
+        bench.print();
+    }
+
+    {
+        static uint8_t scratchpad[9] = {0x50, 0x01, 0x4B, 0x46, 0x7F, 0xFF, 0x10, 0x10};
+        static volatile uint8_t sink;
+        scratchpad[8] = crc8_bitwise(scratchpad, 8);
+        Bench bench(CycleCounter::PLATFORM, "scratchpad crc", "cycles");
+        while (!bench.full()) {
+            t = CycleCounter::now();
+            sink = Onewire::crc8(scratchpad, sizeof(scratchpad));
+            bench.add(CycleCounter::since(t));
+        }
+        (void)sink;
+        bench.print();
+    }
+
+    if (count == 0) {
+        TRACE("%s: No sensors on bus %d to time the bus with\n", __FUNCTION__, sb->bus);
+        governor.release(REPORT_CLOCK);
+        return;
+    }
+
+    uint8_t cmd[10];
+    addressSensor(cmd, sensors.rom(0));
+    cmd[9] = DS18B20_READ_SCRATCHPAD;
+    uint8_t scratchpad[9];
+    uint32_t read_bytes = SCRATCHPAD_CRC ? 9 : 2;
+
+    {
+        Bench send(CycleCounter::PLATFORM, "onewire send byte", "cycles");
+        Bench read(CycleCounter::PLATFORM, "onewire read byte", "cycles");
+        while (!read.full()) {
             onewire.reset();
-            onewire.send(OW_SKIP_ROM);
-            onewire.send(DS18B20_CONVERT_T);
-
-            gpio_put(trigger_gpio, 1);
-            // Wait for the conversions to finish
-            // Note: some knock-off DS18B220's malfunction if you try to talk to them too soon after a start conversion command.
-            // The work-around is to delay before initially asking them if they are done yet.
-            // The entire conversion time is approx 750 mSec, so there is no harm in delaying before asking the first time.
-            do {
-                vTaskDelay(pdMS_TO_TICKS(50));
-            } while (onewire.read() == 0);
-            gpio_put(trigger_gpio, 0);
-
-            // Gather temperature readings from all the devices we know about
-            for (int i = 0; i < actual_sensor_count; i += 1) {
-                // Make sure the Onewire bus is in a known state
-                onewire.reset();
-
-                // Send out the address of the sensor we want to talk to
-                onewire.send(OW_MATCH_ROM);
-                for (int b = 0; b < 64; b += 8) {
-                    onewire.send(deviceAddr[i] >> b);
+            for (uint32_t b = 0; b < sizeof(cmd); b++) {
+                t = CycleCounter::now();
+                onewire.send(cmd[b]);
+                send.add(CycleCounter::since(t));
+            }
+            for (uint32_t b = 0; b < read_bytes; b++) {
+                t = CycleCounter::now();
+                scratchpad[b] = onewire.read();
+                read.add(CycleCounter::since(t));
+            }
+        }
+        send.print();
+        read.print();
+    }
+
+    {
+        Bench bench(CycleCounter::PLATFORM, "match rom read", "cycles");
+        while (!bench.full()) {
+            t = CycleCounter::now();
+            onewire.transact(cmd, sizeof(cmd), scratchpad, read_bytes);
+            bench.add(CycleCounter::since(t));
+        }
+        bench.print();
+    }
+
+    {
+        // A search that fails (a device going away) starts over, but does not count
+        Bench bench(CycleCounter::PLATFORM, "rom search pass", "cycles");
+        Onewire::search_t search = {};
+        for (uint32_t tries = 0; (tries < 2 * Bench::MAX_RUNS) && !bench.full(); tries++) {
+            t = CycleCounter::now();
+            if (onewire.searchNext(search, OW_SEARCH_ROM)) {
+                bench.add(CycleCounter::since(t));
+            }
+        }
+        bench.print();
+    }
+
+    {
+        // Just like the scan loop in vTempSensorTask(): the datasheet time, then poll until done
+        static const uint8_t convert[] = {OW_SKIP_ROM, DS18B20_CONVERT_T};
+        TickType_t conversion = 0;
+        for (int i = 0; i < count; i++) {
+            if (conversionTicks(sensors.resolution[i]) > conversion) {
+                conversion = conversionTicks(sensors.resolution[i]);
+            }
+        }
+        static uint16_t all[MAX_SENSOR_COUNT];
+        static uint16_t got[MAX_SENSOR_COUNT];
+        for (int i = 0; i < count; i++) {
+            all[i] = i;
+        }
+        Bench bench(CycleCounter::PLATFORM, "scan cycle", "cycles");
+        for (uint32_t r = 0; r < BENCHMARK_SCAN_RUNS; r++) {
+            t = CycleCounter::now();
+            onewire.transact(convert, sizeof(convert));
+            vTaskDelay(conversion);
+            while (onewire.read() == 0) {
+                vTaskDelay(pdMS_TO_TICKS(CONVERSION_POLL_MS));
+            }
+            readFamilies(onewire, sensors, all, count, got);
+            bench.add(CycleCounter::since(t));
+        }
+        bench.print();
+    }
+
+    governor.release(REPORT_CLOCK);
+}
+
+// --------------------------------------------------------------------------------------------
+// There is one of these tasks for every Onewire bus. Each sensor gets read at its own period
+// (see sensor_settings[] and AcquisitionScheduler.h). Every time the task wakes up, it reads the
+// sensors whose conversions are done, takes a step of the background search if one is due, starts
+// the conversions that are due, then sleeps until the next conversion is done or the next one is due.
+void HOT_PATH(vTempSensorTask)(void* arg)
+{
+    sensor_bus_t* sb = (sensor_bus_t*)arg;
+    Onewire& onewire = buses.bus(sb->bus);
+    sensor_table_t& sensors = sb->sensors;
+    TickType_t lastWakeTime;
+
+    Onewire::search_t search = {};
+    uint32_t search_failures = 0;
+    TickType_t lastSearchTime;
+    uint32_t scan_count = 0;
+
+    TRACE("Hello from the TempSensorTask for bus %d (GPIO %d), running on core %d\n",
+           sb->bus, buses.gpio(sb->bus), get_core_num());
+
+    governor.request(BUS_CLOCK);
+    findSensors(sb);
+    governor.release(BUS_CLOCK);
+
+    if (BENCHMARK && (sb->bus == 0)) {
+        runBenchmarks(sb);
+    }
+
+    // Finding the sensors takes a while: they start their schedules from here, still in step with the other buses
+    for (int i = 0; i < sensors.count(); i++) {
+        sensors.release[i] = scheduler_t::firstRelease(sensors.period[i], scan_epoch, xTaskGetTickCount());
+    }
+
+    lastWakeTime = scan_epoch;
+    lastSearchTime = scan_epoch;
+
+    // When every conversion started so far is done, and whether the bus has been left alone since the last one started
+    TickType_t busDone = scan_epoch;
+    bool quiet = false;
+    uint32_t convert_us = 0;
+    uint64_t busy_us = 0;
+    uint64_t xip_accesses = 0;
+    uint64_t xip_misses = 0;
+
+    uint32_t wake_us = time_us_32();
+    bool on_time = false;
+    while (1) {
+        governor.request(BUS_CLOCK);
+        XipCache::counts_t xip_wake = xipCache.sample();
+        uint16_t slots[MAX_SENSOR_COUNT];
+
+        int count = scheduler_t::ready(sensors, xTaskGetTickCount(), slots);
+        if ((count > 0) && quiet && !scheduler_t::before(xTaskGetTickCount(), busDone)) {
+            // Note: some knock-off DS18B220's malfunction if you try to talk to them too soon after a start conversion command,
+            // so we do not ask them if they are done until the datasheet conversion time has gone by.
+            // After that, each read slot returns '1's once every sensor that the last CONVERT_T went to is done.
+            // Once anything else has used the bus, the read slots cannot tell, and the datasheet time has to do.
+            while (onewire.read() == 0) {
+                vTaskDelay(pdMS_TO_TICKS(CONVERSION_POLL_MS));
+            }
+            sb->conversion_latency.record(time_us_32() - convert_us);
+        }
+        uint32_t t0_us = time_us_32();
+
+        if (count > 0) {
+            if ((sb->bus == 0) && !scheduler_t::before(xTaskGetTickCount(), busDone)) {
+                gpio_put(trigger_gpio, 0);
+            }
+            readSensors(sb, slots, count, scan_count);
+            sb->acquisition_latency.record(time_us_32() - wake_us);
+            quiet = false;
+        }
+
+        if ((xTaskGetTickCount() - lastSearchTime) >= pdMS_TO_TICKS(SEARCH_PERIOD_MS)) {
+            lastSearchTime += pdMS_TO_TICKS(SEARCH_PERIOD_MS);
+            backgroundSearch(sb, search, search_failures);
+            quiet = false;
+        }
+
+        count = scheduler_t::due(sensors, xTaskGetTickCount(), pdMS_TO_TICKS(SCHEDULE_WINDOW_MS), slots);
+        if (count > 0) {
+            convert_us = time_us_32();
+            busDone = startConversions(sb, slots, count, busDone);
+            quiet = true;
+            if (sb->bus == 0) {
+                gpio_put(trigger_gpio, 1);
+            }
+        }
+
+        busy_us += time_us_32() - t0_us;
+        sb->busy_ms.store(busy_us / 1000, std::memory_order_relaxed);
+
+        XipCache::counts_t xip_done = xipCache.sample();
+        XipCache::counts_t xip = {xip_done.accesses - xip_wake.accesses, xip_done.hits - xip_wake.hits};
+        xip_accesses += xip.accesses;
+        xip_misses += XipCache::misses(xip);
+        sb->xip_kaccesses.store(xip_accesses / 1000, std::memory_order_relaxed);
+        sb->xip_misses.store(xip_misses, std::memory_order_relaxed);
+        governor.release(BUS_CLOCK);
+
+        // Sleep until the next thing to do, counting from the last time we woke up, so that the schedule
+        // does not drift by the amount of time to do the sensor processing. If that time has already
+        // come, there is no sleep at all. Nothing needs the clock while the sensors convert.
+        // The jitter is how far the time between two wakeups was from what was asked for, either way.
+        TickType_t next = scheduler_t::nextEvent(sensors, lastSearchTime + pdMS_TO_TICKS(SEARCH_PERIOD_MS));
+        if (scheduler_t::before(next, xTaskGetTickCount())) {
+            next = xTaskGetTickCount();
+        }
+        TickType_t increment = next - lastWakeTime;
+        bool prev_on_time = on_time;
+        on_time = xTaskDelayUntil(&lastWakeTime, increment);
+        uint32_t prev_wake_us = wake_us;
+        wake_us = time_us_32();
+        if (on_time && prev_on_time) {
+            int32_t jitter_us = (int32_t)(wake_us - prev_wake_us) - (int32_t)(increment * portTICK_PERIOD_MS * 1000);
+            sb->scan_jitter.record((jitter_us < 0) ? -jitter_us : jitter_us);
+        }
+    }
+}
+
+
+// --------------------------------------------------------------------------------------------
+// Display one reading on the console
+void printSample(uint32_t b, const sample_t& sample)
+{
+    // Convert the internal temperature format to hundredths of a degree, then to text
+    char t_C[16], t_F[16];
+    Temperature::formatCenti(t_C, sizeof(t_C), Temperature::RawToCentiC::apply(sample.rawtemp));
+    Temperature::formatCenti(t_F, sizeof(t_F), Temperature::RawToCentiF::apply(sample.rawtemp));
+    TRACE("%s[%d]: Bus %d sensor %d temp is %sC [%sF], raw:%04X\n",
+           __FUNCTION__,
+           get_core_num(),
+           b,
+           sample.sensor,
+           t_C,
+           t_F,
+           (uint16_t)sample.rawtemp
+    );
+}
+
+// --------------------------------------------------------------------------------------------
+// Decide if a reading has changed enough since its sensor was last reported
+bool reportable(int32_t rawtemp, int32_t prev)
+{
+    if (prev == Telemetry::NO_PREVIOUS) {
+        return true;
+    }
+    int32_t diff = abs(rawtemp - prev);
+    return (diff != 0) && (diff >= report_change_raw);
+}
+
+// --------------------------------------------------------------------------------------------
+// Send the ROM codes of every sensor on a bus as telemetry
+bool sendRoms(uint32_t b)
+{
+    sensor_bus_t* sb = &sensor_buses[b];
+    return telemetry.sendRoms(b, sb->table.romTable(), sb->table.count());
+}
+
+// --------------------------------------------------------------------------------------------
+// Display the rolling statistics of every sensor on a bus.
+// The error counts are the bus task's, by the slots of its own table, so they only get shown
+// while that table is still the version that the report task has a copy of.
+void printSensorStats(uint32_t b)
+{
+    sensor_bus_t* sb = &sensor_buses[b];
+    bool current = !sb->published.changed(sb->table);
+    TRACE("%s: Bus %d reported %u of %u readings\n", __FUNCTION__, b, sb->reported, sb->readings);
+    TRACE("  %-16s %8s %8s %8s %8s %8s %8s %8s\n", "sensor", "avg C", "min C", "max C", "C/min", "noise C", "crc err", "power on");
+    for (int i = 0; i < sb->table.count(); i++) {
+        if (sb->stats.count(i) == 0) {
+            continue;
+        }
+        uint32_t crc_errors = current ? sb->sensors.crc_errors[i] : 0;
+        uint32_t power_on_readings = current ? sb->sensors.power_on_readings[i] : 0;
+        char avg[16], lo[16], hi[16], rate[16], noise[16];
+        Temperature::formatCenti(avg, sizeof(avg), sb->stats.average_centi(i));
+        Temperature::formatCenti(lo, sizeof(lo), sb->stats.min_centi(i));
+        Temperature::formatCenti(hi, sizeof(hi), sb->stats.max_centi(i));
+        Temperature::formatCenti(rate, sizeof(rate), sb->stats.rate_centi_per_min(i));
+        Temperature::formatCenti(noise, sizeof(noise), sb->stats.noise_centi(i));
+        TRACE("  %016" PRIx64 " %8s %8s %8s %8s %8s %8u %8u\n", sb->table.rom(i), avg, lo, hi, rate, noise,
+               crc_errors, power_on_readings);
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+// Display how long the system clock spent at each speed, and what the energy per reading came to
+void printClocks()
+{
+    static const char* names[ClockGovernor::SPEED_COUNT] = {"xosc", "usb pll", "full"};
+    uint64_t total_us = 0;
+    uint64_t spent_us[ClockGovernor::SPEED_COUNT];
+    for (int s = 0; s < ClockGovernor::SPEED_COUNT; s++) {
+        spent_us[s] = governor.time_us((ClockGovernor::speed_t)s);
+        total_us += spent_us[s];
+    }
+    TRACE("%s: %u clock changes, time at", __FUNCTION__, governor.changes());
+    for (int s = 0; s < ClockGovernor::SPEED_COUNT; s++) {
+        TRACE(" %s %u%%", names[s], total_us ? (uint32_t)(spent_us[s] * 100 / total_us) : 0);
+    }
+    TRACE("\n");
+
+    uint32_t readings = 0;
+    for (uint32_t b=0; b<buses.count(); b++) {
+        readings += sensor_buses[b].readings;
+    }
+    uint64_t uJ = governor.energy_uJ();
+    TRACE("%s: %" PRIu64 " mJ in total, %" PRIu64 " uJ per reading\n", __FUNCTION__, uJ / 1000, readings ? uJ / readings : 0);
+}
+
+// --------------------------------------------------------------------------------------------
+// Display how often the tick core woke up since boot, and how long it spent in tickless sleeps
+void printSleep()
+{
+    uint64_t ms = (uint64_t)xTaskGetTickCount() * portTICK_PERIOD_MS;
+    if (ms == 0) {
+        return;
+    }
+    TRACE("%s: %u wakeups per second: %u tick interrupts, %u tickless sleeps (%u ended by the alarm)\n",
+           __FUNCTION__, (uint32_t)(ticklessIdle.wakeups() * 1000ULL / ms), ticklessIdle.tickInterrupts(),
+           ticklessIdle.sleeps(), ticklessIdle.alarmWakeups());
+    TRACE("%s: asleep %u%% of the time, %u ticks suppressed\n",
+           __FUNCTION__, (uint32_t)(ticklessIdle.asleep_ms() * 100ULL / ms), ticklessIdle.suppressedTicks());
+}
+
+// --------------------------------------------------------------------------------------------
+// Display the XIP cache counters since boot: for the whole chip, and while each bus task was awake.
+// Comparing these, and the bus latencies, between a build with RAM_HOT_PATH and one without shows what the misses cost.
+void printXip()
+{
+    XipCache::counts_t c = xipCache.sample();
+    uint64_t misses = XipCache::misses(c);
+    TRACE("%s: %" PRIu64 " flash accesses, %" PRIu64 " XIP cache misses (%u.%02u%%)\n", __FUNCTION__, c.accesses, misses,
+           c.accesses ? (uint32_t)(misses * 100 / c.accesses) : 0, c.accesses ? (uint32_t)(misses * 10000 / c.accesses % 100) : 0);
+    for (uint32_t b=0; b<buses.count(); b++) {
+        TRACE("%s: Bus %d awake: %uk flash accesses, %u XIP cache misses\n", __FUNCTION__, b,
+               sensor_buses[b].xip_kaccesses.load(std::memory_order_relaxed), sensor_buses[b].xip_misses.load(std::memory_order_relaxed));
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+// Display how much of the flash log this boot has used, and how long the whole log lasts at that rate
+void printLog()
+{
+    if (LOG_PERIOD_MS == 0) {
+        return;
+    }
+    uint32_t bytes = flashLog.bytesUsed();
+    uint64_t ms = (uint64_t)xTaskGetTickCount() * portTICK_PERIOD_MS;
+    TRACE("%s: %u bytes logged, %u pages written, %u sectors erased, %u pages dropped, %u write errors\n",
+           __FUNCTION__, bytes, flashLog.pagesWritten(), flashLog.sectorsErased(), flashLog.droppedPages(),
+           flashLog.writeErrors());
+    if ((bytes > 0) && (ms > 0)) {
+        uint64_t bytes_per_day = (uint64_t)bytes * 86400000 / ms;
+        TRACE("%s: %" PRIu64 " bytes per day, so the %u KB log holds %" PRIu64 " days\n",
+               __FUNCTION__, bytes_per_day, FlashLog::SIZE / 1024, FlashLog::SIZE / bytes_per_day);
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+void printLatency(const char* name, const LatencyHistogram& h)
+{
+    TRACE("  %-16s %8u %8u %8u %8u\n", name, h.count(), h.percentile_us(50), h.percentile_us(99), h.max_us());
+}
+
+// --------------------------------------------------------------------------------------------
+// Everything we know about how the system is performing. The latency percentiles are upper bounds:
+// the histograms only know which power of 2 each latency falls under.
+void printStats()
+{
+    taskStats.print();
+
+    for (uint32_t b=0; b<buses.count(); b++) {
+        Onewire& onewire = buses.bus(b);
+        sensor_bus_t* sb = &sensor_buses[b];
+        uint64_t ms = (uint64_t)xTaskGetTickCount() * portTICK_PERIOD_MS;
+        uint32_t busy_ms = sb->busy_ms.load(std::memory_order_relaxed);
+        TRACE("%s: Bus %d: %u broadcast and %u addressed conversions, bus in use %u.%u%% of the time\n",
+               __FUNCTION__, b, sb->broadcasts.load(std::memory_order_relaxed), sb->addressed.load(std::memory_order_relaxed),
+               ms ? (uint32_t)(busy_ms * 100ULL / ms) : 0, ms ? (uint32_t)(busy_ms * 1000ULL / ms % 10) : 0);
+        TRACE("%s: Bus %d latency (uSec), %u missed deadlines\n",
+               __FUNCTION__, b, sb->missed_deadlines.load(std::memory_order_relaxed));
+        TRACE("  %-16s %8s %8s %8s %8s\n", "", "count", "p50", "p99", "max");
+        printLatency("reset", onewire.latency(Onewire::LATENCY_RESET));
+        printLatency("match rom", onewire.latency(Onewire::LATENCY_MATCH_ROM));
+        printLatency("scratchpad read", onewire.latency(Onewire::LATENCY_READ));
+        printLatency("conversion", sb->conversion_latency);
+        printLatency("scan jitter", sb->scan_jitter);
+        printLatency("acquisition", sb->acquisition_latency);
+        printLatency("handoff", sb->handoff_latency);
+        printLatency("processing", sb->processing_latency);
+        printSensorStats(b);
+
+        // A bus with a lot of sensors makes a lot of trace records
+        if (BINARY_TRACE) {
+            trace.drain();
+        }
+    }
+    printClocks();
+    printSleep();
+    printXip();
+    printLog();
+}
+
+// --------------------------------------------------------------------------------------------
+// Forget what was last reported for every sensor on a bus, so each one's next reading goes out in full
+void forgetReported(uint32_t b)
+{
+    for (uint32_t i=0; i<MAX_SENSOR_COUNT; i++) {
+        sensor_buses[b].last_reported[i] = Telemetry::NO_PREVIOUS;
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+// Take a copy of a bus's sensor table if the bus task has published a newer version of it.
+// The sensors that are still there keep what was last reported and logged for them, in their
+// new slots. Returns true if the table changed.
+bool followTable(uint32_t b)
+{
+    sensor_bus_t* sb = &sensor_buses[b];
+    if (!sb->published.changed(sb->table)) {
+        return false;
+    }
+
+    // The report task's own, and too big for its stack
+    static rom_table_t old_table;
+    static int32_t old_reported[MAX_SENSOR_COUNT];
+    static int32_t old_logged[MAX_SENSOR_COUNT];
+    old_table = sb->table;
+    memcpy(old_reported, sb->last_reported, sizeof(old_reported));
+    memcpy(old_logged, sb->last_logged, sizeof(old_logged));
+
+    sb->published.copy(sb->table);
+    for (int i = 0; i < sb->table.count(); i++) {
+        int j = old_table.find(sb->table.rom(i));
+        sb->last_reported[i] = (j != rom_table_t::NOT_FOUND) ? old_reported[j] : Telemetry::NO_PREVIOUS;
+        sb->last_logged[i] = (j != rom_table_t::NOT_FOUND) ? old_logged[j] : LogFormat::NO_READING;
+    }
+    return true;
+}
+
+// --------------------------------------------------------------------------------------------
+// Put each sensor's filtered reading in the flash log: the whole table of sensors in a keyframe,
+// or only the readings that changed since they were last logged.
+void logReadings(uint32_t b, uint32_t time_ms, bool keyframe)
+{
+    sensor_bus_t* sb = &sensor_buses[b];
+    rom_table_t& table = sb->table;
+
+    if (keyframe) {
+        flashLog.beginKeyframe(b, time_ms);
+        for (int i = 0; i < table.count(); i++) {
+            sb->last_logged[i] = (sb->stats.count(i) > 0) ? sb->stats.filtered(i) : LogFormat::NO_READING;
+            flashLog.addKey(table.rom(i), sb->last_logged[i]);
+        }
+    }
+    else {
+        flashLog.beginChanges(b, time_ms);
+        for (int i = 0; i < table.count(); i++) {
+            if (sb->stats.count(i) == 0) {
+                continue;
+            }
+            int32_t raw = sb->stats.filtered(i);
+            if (raw != sb->last_logged[i]) {
+                flashLog.addChange(i, raw - sb->last_logged[i]);
+                sb->last_logged[i] = raw;
+            }
+        }
+    }
+    flashLog.end();
+}
+
+// --------------------------------------------------------------------------------------------
+// The log task does the flash log's erasing and programming, and its dumps, at a low priority on
+// the processing core. The report task wakes it up after each batch of log records, which is right
+// after a scan: the bus tasks then have nothing to do until the next one.
+void vLogTask(void* arg)
+{
+    uint32_t dumps = 0;
+
+    TRACE("Hello from the LogTask, running on core %d\n", get_core_num());
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // The report task hands over what it has before it asks for a dump
+        uint32_t requested = log_dump_requests.load(std::memory_order_acquire);
+        flashLog.write();
+        if (requested != dumps) {
+            dumps = requested;
+            TRACE("%s: Sending the flash log on RTT buffer %u\n", __FUNCTION__, FlashLog::RTT_BUFFER);
+            flashLog.dump();
+            TRACE("%s: Done\n", __FUNCTION__);
+        }
+    }
+}
+
+// --------------------------------------------------------------------------------------------
+// The report task empties the sample rings of all the buses. Every reading goes into its sensor's
+// rolling statistics first. Readings that have changed since they were last reported either get
+// converted to degrees and displayed, or get sent as binary telemetry.
+// It also reports when a sensor task had to drop readings because this task fell behind,
+// and prints the performance stats. With BINARY_TRACE, it sends everything traced so far on to the host.
+void vReportTask(void* arg)
+{
+    // Nothing has been reported yet
+    for (uint32_t b=0; b<buses.count(); b++) {
+        forgetReported(b);
+    }
+    uint32_t prev_overflows[BusManager::MAX_BUSES] = {};
+    uint32_t sent_table_version[BusManager::MAX_BUSES] = {};
+    bool log_keyframe[BusManager::MAX_BUSES] = {};
+    TickType_t lastRefreshTime = xTaskGetTickCount();
+    TickType_t lastStatsTime = xTaskGetTickCount();
+    TickType_t lastLogTime = xTaskGetTickCount();
+    TickType_t lastFlushTime = xTaskGetTickCount();
+
+    TRACE("Hello from the ReportTask, running on core %d\n", get_core_num());
+
+    if (BINARY_TELEMETRY && !telemetry.init()) {
+        panic("Telemetry RTT buffer setup failed!");
+    }
+
+    while (1) {
+        // The sensor tasks give us a poke after every scan
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+        governor.request(REPORT_CLOCK);
+
+        int c = getchar_timeout_us(0);
+        if (((STATS_PERIOD_MS != 0) && ((xTaskGetTickCount() - lastStatsTime) >= pdMS_TO_TICKS(STATS_PERIOD_MS))) ||
+            (c == 's')) {
+            lastStatsTime = xTaskGetTickCount();
+            printStats();
+        }
+
+        bool refresh = false;
+        if (BINARY_TELEMETRY && ((xTaskGetTickCount() - lastRefreshTime) >= pdMS_TO_TICKS(TELEMETRY_REFRESH_MS))) {
+            lastRefreshTime = xTaskGetTickCount();
+            refresh = true;
+        }
+
+        for (uint32_t b=0; b<buses.count(); b++) {
+            sensor_bus_t* sb = &sensor_buses[b];
+            bool send_roms = refresh;
+
+            // The readings get processed where they lie in the ring, a contiguous run at a time
+            const sample_t* batch;
+            uint32_t count = sample_rings[b].peek(batch);
+            uint32_t t0_us = time_us_32();
+            if (count > 0) {
+                sb->handoff_latency.record(t0_us - sb->committed_us.load(std::memory_order_relaxed));
+            }
+
+            // Each pass takes the readings up to the first one from a newer version of the sensor table
+            bool newer = true;
+            while (newer) {
+                newer = false;
+
+                // When sensors arrive or depart, the others can move to new slots in the table
+                if (followTable(b)) {
+                    // The statistics no longer belong to the right sensors
+                    sb->stats.resetAll();
+                    log_keyframe[b] = true;
+                }
+                if (BINARY_TELEMETRY && (send_roms || (sb->table.version() != sent_table_version[b]))) {
+                    if (sendRoms(b)) {
+                        sent_table_version[b] = sb->table.version();
+                    }
+                    send_roms = false;
+
+                    // The decoder knows the last reading in each slot, not of each sensor,
+                    // so every reading has to go out as an absolute value again
+                    forgetReported(b);
                 }
 
-                // Read its most recent temperature conversion result
-                onewire.send(DS18B20_READ_SCRATCHPAD);
-                sensors[i].rawtemp = onewire.read () | (onewire.read() << 8);
+                bool started = false;
+                for (; !newer && (count > 0); count = sample_rings[b].peek(batch)) {
+                    uint32_t n;
+                    for (n = 0; n < count; n++) {
+                        sample_t sample = batch[n];
+                        if (sample.table_version != sb->table.version()) {
+                            // A reading from an older version: by now, its slot could hold another sensor
+                            if ((int32_t)(sample.table_version - sb->table.version()) < 0) {
+                                continue;
+                            }
+                            // A reading from a newer version: the copy of the table has to catch up first
+                            newer = true;
+                            break;
+                        }
+
+                        Temperature::raw_t filtered = sb->stats.update(sample.sensor, sample.rawtemp, sample.timestamp_ms);
+                        if (REPORT_FILTERED) {
+                            sample.rawtemp = filtered;
+                        }
+                        sb->readings++;
+
+                        int32_t& reported = sb->last_reported[sample.sensor];
+                        int32_t prev = reported;
+                        if (!reportable(sample.rawtemp, prev)) {
+                            continue;
+                        }
+                        reported = sample.rawtemp;
+                        sb->reported++;
+
+                        if (!BINARY_TELEMETRY) {
+                            printSample(b, sample);
+                            continue;
+                        }
+                        if (!started) {
+                            telemetry.beginSamples(b, sample.timestamp_ms);
+                            started = true;
+                        }
+                        telemetry.addSample(sample.sensor, sample.rawtemp, prev);
+                    }
+                    sample_rings[b].release(n);
+                    sb->processing_latency.record(time_us_32() - t0_us);
+                }
+
+                if (started && !telemetry.endSamples()) {
+                    // The decoder missed some readings, so the next ones cannot be sent as differences
+                    forgetReported(b);
+                }
+            }
 
-                // Convert the internal temperature format to degrees C
-                float t_C = (float)sensors[i].rawtemp / 16.0f;
-                sensors[i].curr_temp_C = t_C;
+            uint32_t overflows = sample_rings[b].overflowCount();
+            if (overflows != prev_overflows[b]) {
+                TRACE("%s: Bus %d dropped %u readings (%u in total)\n",
+                       __FUNCTION__, b, overflows - prev_overflows[b], overflows);
+                if (BINARY_TELEMETRY) {
+                    telemetry.sendOverflow(b, overflows);
+                }
+                prev_overflows[b] = overflows;
             }
+        }
 
-            // Only update the temperatures that have changed since they were last displayed
-            bool missing_sensors = false;
-            for (uint32_t i=0; i<actual_sensor_count; i++) {
-                if (sensors[i].curr_temp_C != sensors[i].prev_temp_C) {
-                    // The temperature has changed: we need to display it
-                    printf("%s[%d]: Sensor %d temp is %.1fC [%.1fF], raw:%04X\n",
-                           __FUNCTION__,
-                           get_core_num(),
-                           i,
-                           sensors[i].curr_temp_C,
-                           ((sensors[i].curr_temp_C * 9.0f)/5.0f)+32.0f,
-                           sensors[i].rawtemp
-                    );
-                    sensors[i].prev_temp_C = sensors[i].curr_temp_C;
+        if (LOG_PERIOD_MS != 0) {
+            bool logged = false;
+            if ((xTaskGetTickCount() - lastLogTime) >= pdMS_TO_TICKS(LOG_PERIOD_MS)) {
+                lastLogTime += pdMS_TO_TICKS(LOG_PERIOD_MS);
+                uint32_t time_ms = time_us_64() / 1000;
+                for (uint32_t b=0; b<buses.count(); b++) {
+                    logReadings(b, time_ms, log_keyframe[b] || flashLog.keyframeDue(b));
+                    log_keyframe[b] = false;
                 }
+                logged = true;
+            }
+            if ((c == 'l') || ((xTaskGetTickCount() - lastFlushTime) >= pdMS_TO_TICKS(LOG_FLUSH_MS))) {
+                lastFlushTime = xTaskGetTickCount();
+                flashLog.flush();
+                logged = true;
+            }
+            if (c == 'l') {
+                log_dump_requests.store(log_dump_requests.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+            if (logged) {
+                xTaskNotifyGive(logTask);
             }
         }
 
-        // Delay 1 second from the last time we woke up so that our 1 second scan period
-        // does not drift by the amount of time to do the sensor processing
-        vTaskDelayUntil(&lastWakeTime, pdMS_TO_TICKS(1000));
+        if (BINARY_TRACE) {
+            trace.drain();
+        }
+        governor.release(REPORT_CLOCK);
     }
 }
 
-
 // --------------------------------------------------------------------------------------------
 // The RTOS is running when we get here.
 // We can use any FreeRTOS mechanisms that we want to.
 void bootSystem()
 {
-    BaseType_t err;
+    // The DMA interrupt gets enabled on whichever core sets the buses up, so do that on the acquisition core
+    pinTask(NULL, ACQUISITION_CORE);
+    init_pio();
+
+    // The alarm that ends a tickless sleep has to interrupt the tick core
+    pinTask(NULL, configTICK_CORE);
+    ticklessIdle.init();
+    pinTask(NULL, PROCESSING_CORE);
+    governor.init(IDLE_CLOCK, CLOCK_GOVERNOR, clockChanged, holdBuses);
+    romStore.init();
+
+    // The flash log picks up where it left off before this boot
+    if ((LOG_PERIOD_MS != 0) && !flashLog.init()) {
+        panic("Flash log RTT buffer setup failed!");
+    }
+
+    sensorPower(false);
+    vTaskDelay(pdMS_TO_TICKS(10));
+    sensorPower(true);
+
+    // Set up a scope trigger output. The line will be driven high during the temperature conversion cycle on bus 0.
+    gpio_init(trigger_gpio);
+    gpio_set_dir(trigger_gpio, true);
+    gpio_put(trigger_gpio, 0);
 
     // Start the rest of the tasks we want to get going:
 
-    err = xTaskCreate(vTempSensorTask, "TempSensors", 1024, NULL, 1, NULL);
-    if (err != pdPASS) {
-        panic("TempSensor task creation failed!");
+    // The log task writes the flash at the same low priority as the report task below, on the same core
+    if (LOG_PERIOD_MS != 0) {
+        logTask = logTaskMemory.create(0, vLogTask, "Log", NULL, 1);
+        if (!logTask) {
+            panic("Log task creation failed!");
+        }
+        pinTask(logTask, PROCESSING_CORE);
+    }
+
+    // The report task runs at a lower priority than the sensor tasks, on the processing core
+    reportTask = reportTaskMemory.create(0, vReportTask, "Report", NULL, 1);
+    if (!reportTask) {
+        panic("Report task creation failed!");
+    }
+    pinTask(reportTask, PROCESSING_CORE);
+
+    // Every bus gets its own sensor task, and they all share the acquisition core. They spend
+    // nearly all of their time asleep while the DMA and the PIO do the work.
+    // Each one gets its own name so that they can be told apart in the stats.
+    static char names[BusManager::MAX_BUSES][8];
+    scan_epoch = xTaskGetTickCount();
+    for (uint32_t b=0; b<buses.count(); b++) {
+        sensor_buses[b].bus = b;
+        snprintf(names[b], sizeof(names[b]), "Bus%u", b);
+        TaskHandle_t task = sensorTaskMemory.create(b, vTempSensorTask, names[b], &sensor_buses[b], 2);
+        if (!task) {
+            panic("TempSensor task creation failed!");
+        }
+        pinTask(task, ACQUISITION_CORE);
     }
 }
 
@@ -277,6 +1762,7 @@ void vBlink(void* arg)
 // --------------------------------------------------------------------------------------------
 // Add an idle task where we sleep, unless the pushbutton is pressed.
 // Measuring the VSYS supply current with button pressed or not will indicated power savings.
+// With tickless idle, the tick core does its sleeping in vApplicationSleep() instead.
 void vApplicationIdleHook( void )
 {
     static bool inited = false;
@@ -286,8 +1772,12 @@ void vApplicationIdleHook( void )
         gpio_init(button_gpio);
         gpio_set_dir(button_gpio, false);
         gpio_set_pulls(button_gpio, true, false);
+        inited = true;
     }
 
+    if (configUSE_TICKLESS_IDLE && (get_core_num() == configTICK_CORE)) {
+        return;
+    }
     if (gpio_get(button_gpio)) {
         // Button is not pressed: sleep until next interrupt
         __wfi();
@@ -295,65 +1785,45 @@ void vApplicationIdleHook( void )
 }
 
 // --------------------------------------------------------------------------------------------
-// Some approximate average VSYS current consumption numbers while running this demo:
-// Pico  200 MHz    33 mA
-// Pico  125 Mhz    23 mA
-// Pico2 150 Mhz    16 mA   (sysPLL and usbPLL running)
-// Pico2  48 MHz     7 mA   (no sysPLL; usbPLL is source of 48 MHz clock)
-// Pico2  12 MHz     3 mA   (no sysPLL or usbPLL; XOSC is source of 12 MHz clock)
-//
-// The Pico2 is far more power efficient probably because it generates its 1.1V core voltage
-// via a switch-mode voltage regulator instead of the RP2040's linear regulator.
-void clockConfig()
-{
-    // Enable one of these blocks to change the processor clock speed from its default.
-    // The point of running at 12 MHz or 48 MHz is to reduce current consumption by shutting
-    // down one or more of the PLL circuits.
-    // Merely changing the PLL frequency does not necessarily change power (current x time) consumption.
-
-    #if 0
-    // To lower the current consumption, configure the sysclk and peripheral clock to
-    // run off the 12MHz xtal, with PLL disabled.
-    clock_configure(
-        clk_sys,
-        CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX,
-    	CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_XOSC_CLKSRC,
-        12 * MHZ,
-        12 * MHZ
-    );
-
-    // Turning off the sysclk PLL saves 0.9 mA on a Pico2
-    pll_deinit(pll_sys);
-
-    // Turning off the USB PLL saves 0.9 mA on a Pico2
-    pll_deinit(pll_usb);
-
-    clock_configure(
-        clk_peri,
-        0,
-        CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS,
-        12 * MHZ,
-        12 * MHZ);
+// True if every other core is running one of the idle tasks
+bool otherCoresIdle()
+{
+    #if (configNUMBER_OF_CORES > 1)
+        for (BaseType_t core = 0; core < configNUMBER_OF_CORES; core++) {
+            if (core == (BaseType_t)get_core_num()) {
+                continue;
+            }
+            TaskHandle_t task = xTaskGetCurrentTaskHandleForCore(core);
+            bool idle = false;
+            for (BaseType_t i = 0; i < configNUMBER_OF_CORES; i++) {
+                idle |= (task == xTaskGetIdleTaskHandleForCore(i));
+            }
+            if (!idle) {
+                return false;
+            }
+        }
     #endif
+    return true;
+}
 
-    #if 0
-    // Change clk_sys to be 48MHz by setting clksrc to use the PLL_USB
-    // which always runs at 48MHz
-    clock_configure(clk_sys,
-        CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX,
-        CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB,
-        48 * MHZ,
-        48 * MHZ);
-
-    // Shut down the sys PLL, but leave the USB PLL running because that's where our 48 MHz clock is coming from
-    pll_deinit(pll_sys);
-
-    clock_configure(clk_peri,
-            0,
-            CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS,
-            48 * MHZ,
-            48 * MHZ);
-    #endif
+// --------------------------------------------------------------------------------------------
+// The kernel calls this from the idle task (portSUPPRESS_TICKS_AND_SLEEP) once no task is due for
+// at least 'expected' ticks. Only the tick core can stop the tick, and only while the other core
+// is idle and no bus has a transaction in flight: the DMA interrupt that ends a transaction goes
+// to the acquisition core, and would not wake this one up. That leaves the conversion waits and
+// the time between scans. The rest of the time, it waits for the next interrupt as usual.
+extern "C" void vApplicationSleep(uint32_t expected)
+{
+    if (!gpio_get(button_gpio)) {
+        // Button is pressed: no sleeping at all
+        return;
+    }
+    if ((get_core_num() == configTICK_CORE) && otherCoresIdle() && !buses.busy()) {
+        ticklessIdle.sleep(expected);
+    }
+    else {
+        __wfi();
+    }
 }
 
 // --------------------------------------------------------------------------------------------
@@ -364,30 +1834,94 @@ void clockDriveOut()
     clock_gpio_init(clkout_gpio, CLOCKS_CLK_GPOUT0_CTRL_AUXSRC_VALUE_XOSC_CLKSRC, 12);
 }
 
+// --------------------------------------------------------------------------------------------
+// Print the cost per reading of the report task's temperature math, old and new.
+// This has to run before the scheduler starts: no task may use floats, since the FPU context is not saved.
+void benchmarkTemperatures(uint32_t f_clk_sys_khz)
+{
+    const uint32_t count = 256;
+    const uint32_t rounds = 100;
+    static Temperature::raw_t raw[count];
+    static volatile float sink_f;
+    static volatile int32_t sink_i;
+
+    TemperatureBench::makeReadings(raw, count);
+
+    uint32_t t0_us = time_us_32();
+    for (uint32_t r=0; r<rounds; r++) {
+        TemperatureBench::floatPipeline(raw, count, &sink_f);
+    }
+    uint32_t t1_us = time_us_32();
+    for (uint32_t r=0; r<rounds; r++) {
+        TemperatureBench::integerPipeline(raw, count, &sink_i);
+    }
+    uint32_t t2_us = time_us_32();
+
+    uint64_t samples = (uint64_t)count * rounds;
+    TRACE("%s: float %" PRIu64 " cycles/sample, integer %" PRIu64 " cycles/sample\n", __FUNCTION__,
+           (uint64_t)(t1_us - t0_us) * f_clk_sys_khz / 1000 / samples,
+           (uint64_t)(t2_us - t1_us) * f_clk_sys_khz / 1000 / samples);
+}
+
+// --------------------------------------------------------------------------------------------
+// Print what checking a scratchpad's CRC costs with each of the CRC8 methods.
+// The bus time of the 7 extra bytes that SCRATCHPAD_CRC reads is far more than any of them.
+void benchmarkCrc(uint32_t f_clk_sys_khz)
+{
+    static const char* names[] = {"bitwise", "nibble", "table"};
+    static uint8_t (* const methods[])(const uint8_t*, uint32_t) = {crc8_bitwise, crc8_nibble, crc8_table};
+    const uint32_t rounds = 10000;
+    static uint8_t scratchpad[9] = {0x50, 0x01, 0x4B, 0x46, 0x7F, 0xFF, 0x10, 0x10};
+    static volatile uint8_t sink;
+
+    scratchpad[8] = crc8_bitwise(scratchpad, 8);
+    for (uint32_t m=0; m<3; m++) {
+        uint32_t t0_us = time_us_32();
+        for (uint32_t r=0; r<rounds; r++) {
+            sink = methods[m](scratchpad, sizeof(scratchpad));
+        }
+        (void)sink;
+        uint32_t t1_us = time_us_32();
+        TRACE("%s: %s %" PRIu64 " cycles/scratchpad%s\n", __FUNCTION__, names[m],
+               (uint64_t)(t1_us - t0_us) * f_clk_sys_khz / 1000 / rounds, (m == CRC8_METHOD) ? " (in use)" : "");
+    }
+}
+
 // --------------------------------------------------------------------------------------------
 int main()
  {
     hello();
 
-    // Configuring the system clock to run at a different rate is completely optional.
-    // It can reduce current consumption, if that is a concern for a particular project.
-    clockConfig();
+    // Boot runs at full speed. Once the RTOS is up, the clock governor takes over the system clock.
     clockDriveOut();
 
     stdio_init_all();
+    if (BINARY_TRACE && !trace.init()) {
+        panic("Trace RTT buffer setup failed!");
+    }
 
-    // Demonstrate that we have printf sends output to the debugger terminal window
-    printf("\"Hello, World!\" via RTT running on core %d\n", get_core_num());
+    // Demonstrate that our output gets to the debugger terminal window
+    TRACE("\"Hello, World!\" via RTT running on core %d\n", get_core_num());
 
     // Just for fun, display what freq we are running at:
     uint32_t f_clk_sys = frequency_count_khz(CLOCKS_FC0_SRC_VALUE_CLK_SYS);
-    printf("System clock: %.1f MHz\n", f_clk_sys / 1000.0);
+    TRACE("System clock: %u.%u MHz\n", f_clk_sys / 1000, (f_clk_sys % 1000) / 100);
+
+    if (TEMPERATURE_BENCHMARK) {
+        benchmarkTemperatures(f_clk_sys);
+    }
+    if (CRC_BENCHMARK) {
+        benchmarkCrc(f_clk_sys);
+    }
 
     // Create the first task: one of its responsibilities will be to start the rest of the tasks.
     // No FreeRTOS mechanisms will work until the scheduler runs, so the FreeRTOS world should not
     // get booted until FreeRTOS is running.
-    BaseType_t err = xTaskCreate(vBlink, "Blink", 512, NULL, 1, NULL);
-    if (err != pdPASS) {
+    if (configSUPPORT_STATIC_ALLOCATION) {
+        TRACE("Task memory: %u bytes for the application, %u for the kernel, no heap\n",
+               (uint32_t)task_ram_bytes, (uint32_t)kernelTaskRamBytes());
+    }
+    if (!blinkTaskMemory.create(0, vBlink, "Blink", NULL, 1)) {
         panic("Blink task creation failed!");
     }
 